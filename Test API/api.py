@@ -1,6 +1,13 @@
-from fastapi import FastAPI
-from fastapi.responses import PlainTextResponse
+from fastapi import FastAPI, HTTPException, Request
+from fastapi.responses import JSONResponse, PlainTextResponse, Response, StreamingResponse
+import asyncio
+import gzip
+import hashlib
+import os
+import random
 import ssl
+import time
+import zlib
 
 # creating API
 app = FastAPI()
@@ -8,6 +15,266 @@ app = FastAPI()
 ssl_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
 ssl_context.load_cert_chain('./cert.pem', keyfile='./key.pem')
 
-@app.get("/api/test", response_class=PlainTextResponse)
-async def getNumber():
-    return "123|*456|789"
+PAYLOAD = "123|*456|789"
+
+# Conditions /api/test can reproduce. Pick one at startup with T93_SCENARIO=<name> (and T93_SEED=<n>), switch with
+# POST /scenario/<name>?seed=<n>, or try one for a single request with /api/test?scenario=<name>. Every fault is drawn from a
+# seeded generator so a run can be repeated exactly. Fields left out take the values in "baseline".
+SCENARIOS = {
+    "baseline": {
+        "latency_ms": 0,            # Delay before the response headers are sent.
+        "jitter_ms": 0,             # Added to latency_ms, uniformly in +/- jitter_ms.
+        "drip_bytes": 0,            # When non-zero the body is sent chunked, drip_bytes at a time...
+        "drip_interval_ms": 0,      # ...with this long between chunks.
+        "oversized_bytes": 0,       # Pad the payload out to this many bytes with extra values (RESPONSE_BUFFER_SIZE is 512).
+        "malformed_rate": 0.0,      # Fraction of responses with a payload the firmware should reject.
+        "error_rate": 0.0,          # Fraction of responses that are a 500, 502 or 503.
+        "reset_rate": 0.0,          # Fraction of connections dropped after sending headers and part of the body.
+        "close_rate": 0.0,          # Fraction of responses sent with Connection: close, forcing a new connection and TLS handshake.
+        "value_count": 3,           # Values in the payload.
+        "churn_per_minute": 0.0,    # How often each value ticks up. 0 serves the fixed PAYLOAD.
+    },
+    "slow": {"latency_ms": 800, "jitter_ms": 400},
+    "drip": {"drip_bytes": 4, "drip_interval_ms": 200},
+    "oversized": {"oversized_bytes": 2048},
+    "malformed": {"malformed_rate": 0.5},
+    "flaky": {"error_rate": 0.2, "reset_rate": 0.1},
+    "reconnect": {"close_rate": 1.0},
+    "churn": {"value_count": 8, "churn_per_minute": 30},
+    "production": {"latency_ms": 300, "jitter_ms": 250, "error_rate": 0.02, "reset_rate": 0.01, "close_rate": 0.1, "churn_per_minute": 2},
+    "stress": {"latency_ms": 1500, "jitter_ms": 1500, "drip_bytes": 8, "drip_interval_ms": 100, "malformed_rate": 0.1,
+               "error_rate": 0.1, "reset_rate": 0.1, "close_rate": 0.5, "value_count": 16, "churn_per_minute": 60},
+}
+
+class Scenario:
+    def __init__(self, name, seed):
+        if name not in SCENARIOS:
+            raise KeyError(name)
+        self.name = name
+        self.seed = seed
+        self.settings = dict(SCENARIOS["baseline"], **SCENARIOS[name])
+        self.random = random.Random(seed)
+        self.started = time.monotonic()
+
+    def __getattr__(self, field):
+        try:
+            return self.settings[field]
+        except KeyError:
+            raise AttributeError(field)
+
+    def chance(self, rate):
+        return rate > 0 and self.random.random() < rate
+
+    def delay(self):
+        return max(0, self.latency_ms + self.random.uniform(-self.jitter_ms, self.jitter_ms)) / 1000
+
+    def values(self):
+        # Each value climbs at churn_per_minute from its own base, so whether it changed between polls depends on the polling interval.
+        if self.churn_per_minute <= 0 and self.value_count == 3:
+            return PAYLOAD
+        ticks = int((time.monotonic() - self.started) * self.churn_per_minute / 60)
+        values = [str(123 + 333 * i + ticks) for i in range(self.value_count)]
+        if len(values) > 1:
+            values[1] = "*" + values[1]
+        return "|".join(values)
+
+    def payload(self):
+        payload = self.values()
+        extra = 0
+        while len(payload) < self.oversized_bytes:
+            payload += "|%d" % (1000 + extra)
+            extra += 1
+        return payload
+
+    def malformed(self):
+        return self.random.choice([
+            b"",                                    # No values at all.
+            b"|||",                                 # Delimiters only.
+            bytes(self.random.getrandbits(8) for _ in range(64)),  # Binary garbage.
+            b"<html><body>502 Bad Gateway</body></html>",            # A proxy's error page served as a 200.
+        ])
+
+scenario = Scenario(os.environ.get("T93_SCENARIO", "baseline"), int(os.environ.get("T93_SEED", "93")))
+
+# Scenarios tried per request with ?scenario=, kept by name so their generators (and churn) carry on from one request to the next.
+# Cleared when the active scenario is switched, so they restart with its seed.
+trial_scenarios = {}
+
+# Timing collected per client address, so the firmware's polling behaviour can be compared across scenarios and builds.
+# Connections are counted by client port, as each new TCP connection (and so TLS handshake) comes from a new one.
+stats = {}
+
+def record(request, started, status, sent, fault):
+    host, port = request.client.host, request.client.port
+    client = stats.setdefault(host, {"requests": 0, "statuses": {}, "faults": {}, "ports": set(), "arrivals": [], "handling_ms": [], "bytes": 0})
+    client["requests"] += 1
+    client["statuses"][status] = client["statuses"].get(status, 0) + 1
+    if fault:
+        client["faults"][fault] = client["faults"].get(fault, 0) + 1
+    client["ports"].add(port)
+    client["arrivals"].append(started)
+    client["handling_ms"].append((time.monotonic() - started) * 1000)
+    client["bytes"] += sent
+
+def summarise(values):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return {"min": round(ordered[0], 1), "mean": round(sum(ordered) / len(ordered), 1), "max": round(ordered[-1], 1),
+            "p95": round(ordered[min(len(ordered) - 1, len(ordered) * 95 // 100)], 1)}
+
+def encode(body, request, encoding=""):
+    if not encoding:
+        accepted = request.headers.get("accept-encoding", "")
+        encoding = "gzip" if "gzip" in accepted else "deflate" if "deflate" in accepted else "identity"
+    if encoding == "gzip":
+        return gzip.compress(body), encoding
+    if encoding == "deflate":
+        return zlib.compress(body), encoding
+    if encoding == "raw-deflate":
+        compressor = zlib.compressobj(wbits=-15)
+        return compressor.compress(body) + compressor.flush(), "deflate"
+    return body, "identity"
+
+# The endpoint the counters poll. Serves PAYLOAD unless the active scenario (or ?scenario=) says otherwise, compressed per Accept-Encoding.
+@app.get("/api/test")
+async def getNumber(request: Request):
+    started = time.monotonic()
+    active = scenario
+    scenario_name = request.query_params.get("scenario", "")
+    if scenario_name:
+        if scenario_name not in trial_scenarios:
+            try:
+                trial_scenarios[scenario_name] = Scenario(scenario_name, scenario.seed)
+            except KeyError:
+                raise HTTPException(404, "Unknown scenario")
+        active = trial_scenarios[scenario_name]
+
+    await asyncio.sleep(active.delay())
+
+    headers = {"Vary": "Accept-Encoding"}
+    if active.chance(active.close_rate):
+        headers["Connection"] = "close"
+
+    if active.chance(active.error_rate):
+        status = active.random.choice([500, 502, 503])
+        record(request, started, status, 0, "error")
+        return PlainTextResponse("Injected failure", status_code=status, headers=headers)
+
+    fault = None
+    if active.chance(active.malformed_rate):
+        body, fault = active.malformed(), "malformed"
+    else:
+        body = active.payload().encode()
+    body, encoding = encode(body, request)
+    if encoding != "identity":
+        headers["Content-Encoding"] = encoding
+
+    reset = active.chance(active.reset_rate)
+    if not reset and active.drip_bytes <= 0:
+        record(request, started, 200, len(body), fault)
+        return Response(body, media_type="text/plain", headers=headers)
+
+    # Chunked from here. A reset sends half the body then fails the stream, which drops the connection without finishing the response.
+    # Without dripping the body goes in two chunks, so there is a first half to send before the reset.
+    chunk = active.drip_bytes if active.drip_bytes > 0 else (len(body) + 1) // 2
+    interval = active.drip_interval_ms / 1000
+
+    async def drip():
+        for i in range(0, len(body), max(chunk, 1)):
+            if reset and i >= len(body) // 2:
+                record(request, started, 200, i, "reset")
+                raise ConnectionResetError("Injected reset")
+            yield body[i:i + chunk]
+            if interval:
+                await asyncio.sleep(interval)
+        record(request, started, 200, len(body), fault)
+
+    return StreamingResponse(drip(), media_type="text/plain", headers=headers)
+
+@app.get("/scenario")
+async def getScenario():
+    return {"active": scenario.name, "seed": scenario.seed, "settings": scenario.settings, "available": sorted(SCENARIOS)}
+
+# Switches scenario and restarts its generator, so the same seed reproduces the same sequence of faults.
+@app.post("/scenario/{name}")
+async def setScenario(name: str, seed: int = 93):
+    global scenario
+    try:
+        scenario = Scenario(name, seed)
+    except KeyError:
+        raise HTTPException(404, "Unknown scenario")
+    trial_scenarios.clear()
+    print("Scenario now %s (seed %d)" % (name, seed))
+    return await getScenario()
+
+# Per client: requests and connections (and so requests per connection), status and fault counts, the spacing of requests
+# (the client's effective polling interval), time spent handling each request including injected delays, and bytes sent.
+@app.get("/stats")
+async def getStats():
+    report = {"scenario": scenario.name, "seed": scenario.seed, "clients": {}}
+    for host, client in stats.items():
+        arrivals = client["arrivals"]
+        spacing = [(later - earlier) * 1000 for earlier, later in zip(arrivals, arrivals[1:])]
+        elapsed = arrivals[-1] - arrivals[0] if len(arrivals) > 1 else 0
+        report["clients"][host] = {
+            "requests": client["requests"],
+            "connections": len(client["ports"]),
+            "requests_per_connection": round(client["requests"] / len(client["ports"]), 2),
+            "statuses": client["statuses"],
+            "faults": client["faults"],
+            "spacing_ms": summarise(spacing),
+            "handling_ms": summarise(client["handling_ms"]),
+            "bytes": client["bytes"],
+            "requests_per_minute": round((len(arrivals) - 1) * 60 / elapsed, 2) if elapsed else None,
+        }
+    return JSONResponse(report)
+
+@app.post("/stats/reset")
+async def resetStats():
+    stats.clear()
+    return {"reset": True}
+
+# Compresses the payload per the request's Accept-Encoding, or per ?encoding=gzip|deflate|raw-deflate to force one.
+# ?chunk=N drips the compressed body out N bytes at a time so headers, blocks and trailers get split across reads.
+@app.get("/api/test/compressed")
+async def getCompressedNumber(request: Request, encoding: str = "", chunk: int = 0):
+    body, encoding = encode(PAYLOAD.encode(), request, encoding)
+
+    headers = {"Vary": "Accept-Encoding"}
+    if encoding != "identity":
+        headers["Content-Encoding"] = encoding
+
+    if chunk <= 0:
+        return Response(body, media_type="text/plain", headers=headers)
+
+    async def drip():
+        for i in range(0, len(body), chunk):
+            yield body[i:i + chunk]
+            await asyncio.sleep(0.05)
+
+    return StreamingResponse(drip(), media_type="text/plain", headers=headers)
+
+FIRMWARE_PATH = "../.pio/build/esp32doit-devkit-v1/firmware.bin"
+
+# Serves the last built firmware for OTA updates, point SECRET_OTA_URL at https://<host>:8000/firmware.
+# The ETag is the SHA-256 esptool appends to the image, which is what the counter reports for its running firmware, so counters already
+# running this build get a 304. X-Image-SHA256 covers the whole file, as written to flash. ?encoding=identity sends it uncompressed for comparison.
+@app.get("/firmware")
+async def getFirmware(request: Request, encoding: str = ""):
+    with open(FIRMWARE_PATH, "rb") as firmware:
+        image = firmware.read()
+
+    etag = '"%s"' % image[-32:].hex()
+    headers = {"ETag": etag, "X-Image-SHA256": hashlib.sha256(image).hexdigest(), "Vary": "Accept-Encoding"}
+    if request.headers.get("if-none-match") == etag:
+        return Response(status_code=304, headers=headers)
+
+    if not encoding:
+        encoding = "gzip" if "gzip" in request.headers.get("accept-encoding", "") else "identity"
+    body = image
+    if encoding == "gzip":
+        body = gzip.compress(image, compresslevel=9)
+        headers["Content-Encoding"] = "gzip"
+    print("Serving %d byte firmware as %d bytes (%s, %d%%)" % (len(image), len(body), encoding, len(body) * 100 // len(image)))
+    return Response(body, media_type="application/octet-stream", headers=headers)
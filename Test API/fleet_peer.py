@@ -0,0 +1,109 @@
+# Joins the counters' fleet multicast group from a PC, for testing fleet mode without a second counter.
+# Prints every packet seen (flagging any with a bad tag or replayed sequence number) and can act as a peer:
+#   python fleet_peer.py                                   listen only
+#   python fleet_peer.py --mac 00:00:00:00:00:01           join as a peer, with a MAC low enough to be elected poller
+#   python fleet_peer.py --mac 00:00:00:00:00:01 --values "123|456|789"
+#                                                          ...and share these values after each poll interval, as the poller would
+# Stopping a peer that is the poller exercises failover, the counters should take over once FLEET_LEASE_MS passes.
+# Run two instances with --loopback to exercise the protocol on a single Linux machine without any counters. This is a reimplementation,
+# the firmware's own signing, parsing and replay checks are run over loopback multicast by test/test_fleet (pio test -e native).
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import struct
+import time
+
+GROUP = "239.255.93.1"   # Must match FLEET_GROUP, FLEET_PORT, FLEET_TAG_LENGTH and SECRET_FLEET_KEY in the firmware.
+PORT = 49393
+TAG_LENGTH = 16
+MAGIC = b"T93F"
+HEARTBEAT, VALUES = 1, 2
+STALE = 0x01
+
+def sign(key, data):
+    return hmac.new(key, data, hashlib.sha256).digest()[:TAG_LENGTH]
+
+def build(key, packet_type, mac, nonce, sequence, values=None):
+    packet = MAGIC + bytes([packet_type]) + mac + struct.pack(">II", nonce, sequence)
+    if packet_type == VALUES:
+        packet += bytes([len(values)])
+        for value in values:
+            encoded = value.encode()
+            packet += bytes([0, len(encoded)]) + encoded
+    return packet + sign(key, packet)
+
+def describe(key, packet, last_seen):
+    if len(packet) < 19 + TAG_LENGTH or packet[:4] != MAGIC:
+        return None
+    body, tag = packet[:-TAG_LENGTH], packet[-TAG_LENGTH:]
+    mac = ":".join("%02X" % b for b in packet[5:11])
+    nonce, sequence = struct.unpack(">II", packet[11:19])
+    if not hmac.compare_digest(sign(key, body), tag):
+        return "%s  BAD TAG" % mac
+    previous = last_seen.get(mac)
+    replayed = previous is not None and previous[0] == nonce and sequence <= previous[1]
+    last_seen[mac] = (nonce, sequence)
+    text = "%s  nonce %08X  seq %-6d %s" % (mac, nonce, sequence, "REPLAYED " if replayed else "")
+    if packet[4] == HEARTBEAT:
+        return text + "heartbeat"
+    values, position = [], 20
+    for _ in range(body[19]):
+        flags, length = body[position], body[position + 1]
+        value = body[position + 2:position + 2 + length].decode(errors="replace")
+        values.append(value + ("~" if flags & STALE else ""))
+        position += 2 + length
+    return text + "values " + "|".join(values)
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--key", default="Fleet Key Here")
+    parser.add_argument("--mac", help="Join the fleet as a peer with this MAC, e.g. 00:00:00:00:00:01")
+    parser.add_argument("--values", help="Pipe delimited values to share every --interval seconds")
+    parser.add_argument("--heartbeat", type=float, default=5.0)
+    parser.add_argument("--interval", type=float, default=30.0)
+    parser.add_argument("--loopback", action="store_true", help="Send and receive on the loopback interface")
+    args = parser.parse_args()
+    key = args.key.encode()
+    interface = "127.0.0.1" if args.loopback else "0.0.0.0"
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind(("", PORT))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, socket.inet_aton(GROUP) + socket.inet_aton(interface))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    if args.loopback:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(interface))
+    sock.settimeout(0.2)
+
+    mac = bytes(int(part, 16) for part in args.mac.split(":")) if args.mac else None
+    nonce = struct.unpack(">I", os.urandom(4))[0]
+    sequence = 0
+    next_heartbeat = next_values = time.monotonic()
+    last_seen = {}
+
+    while True:
+        now = time.monotonic()
+        if mac and now >= next_heartbeat:
+            sequence += 1
+            sock.sendto(build(key, HEARTBEAT, mac, nonce, sequence), (GROUP, PORT))
+            next_heartbeat = now + args.heartbeat
+        if mac and args.values and now >= next_values:
+            sequence += 1
+            sock.sendto(build(key, VALUES, mac, nonce, sequence, args.values.split("|")), (GROUP, PORT))
+            next_values = now + args.interval
+        try:
+            packet, sender = sock.recvfrom(1500)
+        except socket.timeout:
+            continue
+        if mac and packet[5:11] == mac:
+            continue
+        text = describe(key, packet, last_seen)
+        if text:
+            print("%s  %-15s %s" % (time.strftime("%H:%M:%S"), sender[0], text))
+
+if __name__ == "__main__":
+    main()
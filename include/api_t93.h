@@ -4,8 +4,9 @@
 #include <HTTPClient.h>
 
 void ProcessAPIPolling();
-void UpdateValueFromAPI();
-void RemoveAsteriskNotation(char*);
-bool ValidatePayloadFormat(char*);
+void RequestRefresh();
+void ProcessRefreshRequest();
+void CompleteRefresh();
+bool UpdateValueFromAPI();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef _T93_LCD_COUNTER_BENCH_h
+#define _T93_LCD_COUNTER_BENCH_h
+
+#include <Arduino.h>
+
+#include "enums_t93.h"
+#include "series_t93.h"
+
+// A generated series encoded as the series store would, see EncodeBenchSeries().
+struct BenchSeries {
+  SeriesChunk* chunks;
+  int* fileEnds;                                    // For each file the store would have written, the number of chunks written by its end.
+  int maxChunks;                                    // Room allocated in chunks and fileEnds.
+  int chunkCount;
+  int fileCount;
+  uint32_t encodedBits;                             // Bits of the chunks used, including headers.
+  uint64_t encodeCycles;
+};
+
+typedef int (*PayloadPipeline)(char*, char**, int);   // Transforms a payload in place, storing a pointer to each value located. Returns the number of values, or -1 if the payload was rejected.
+
+void RunPayloadBenchmark();
+void BenchmarkPipeline(const char*, PayloadPipeline);
+int GenerateBenchPayload(char*, int, int, BenchAsteriskPosition);
+int BaselinePayloadPipeline(char*, char**, int);
+
+void RunSeriesEncodingBenchmark();
+void BenchmarkSeriesEncoding(BenchSeriesPattern);
+void RunSeriesBenchmark();
+void BenchmarkSeriesFlash(BenchSeriesPattern);
+bool EncodeBenchSeries(BenchSeriesPattern, BenchSeries&);
+bool SealBenchChunk(BenchSeries&, SeriesEncoder&);
+void FreeBenchSeries(BenchSeries&);
+void GenerateBenchSample(BenchSeriesPattern, uint32_t&, uint32_t&, int32_t&);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,9 @@
+#ifndef _T93_LCD_COUNTER_CACHE_h
+#define _T93_LCD_COUNTER_CACHE_h
+
+void StoreFetchedValue(int, const char*);
+void MarkValueFetchFailed(int);
+void MarkAllValuesFetchFailed();
+bool IsValueStale(int);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef _T93_LCD_COUNTER_DEADLINE_h
+#define _T93_LCD_COUNTER_DEADLINE_h
+
+#include <Arduino.h>
+
+#include "enums_t93.h"
+
+void StartDeadline();
+void BeginPhase(DeadlinePhase);
+void EndDeadline();
+unsigned long GetPhaseDeadline();
+unsigned long GetPhaseRemaining();
+bool IsPhaseOverrun();
+void RecordPhaseOverrun();
+uint32_t GetPhaseOverruns(DeadlinePhase);
+const char* GetPhaseName(DeadlinePhase);
+unsigned long GetPhaseBudget(DeadlinePhase);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef _T93_LCD_COUNTER_DECODE_h
+#define _T93_LCD_COUNTER_DECODE_h
+
+#include <Arduino.h>
+#include "rom/miniz.h"
+
+#include "enums_t93.h"
+
+#define GZIP_FLAG_HCRC        0x02  // Header flag bits indicating which optional fields follow the fixed gzip header.
+#define GZIP_FLAG_EXTRA       0x04
+#define GZIP_FLAG_NAME        0x08
+#define GZIP_FLAG_COMMENT     0x10
+
+// Receives an HTTP response body (via HTTPClient::writeToStream()) and decodes it into a fixed size, null terminated buffer.
+// Compressed bodies are inflated with the ESP32 ROM's tinfl as each chunk arrives. The output buffer itself acts as the inflate
+// window, so no 32 KB dictionary is needed and anything that would inflate beyond the buffer is rejected as too large.
+// Alternatively, bodies of any size can be streamed through to a sink. This needs a TINFL_LZ_DICT_SIZE window for compressed bodies.
+class PayloadDecoder : public Stream {
+  public:
+    PayloadDecoder(char*, size_t);
+    PayloadDecoder(uint8_t*, size_t, Print*);
+    ~PayloadDecoder();
+
+    bool begin(ContentEncoding, int = -1);
+    size_t write(uint8_t) override;
+    size_t write(const uint8_t*, size_t) override;
+    int available() override { return 0; }    // Write only. Stream (rather than Print) is only inherited as that is what writeToStream() accepts.
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    bool finish();
+    bool overflowed();
+    size_t length();
+
+  private:
+    size_t inflate(const uint8_t*, size_t);
+    void nextGzipHeaderState();
+
+    char* _buffer;                  // Where the decoded body is written. The circular inflate window when streaming to a sink.
+    size_t _capacity;               // Size of _buffer, including space for the null terminator when not streaming.
+    size_t _length;                 // Decoded bytes written so far.
+    size_t _received;               // Body bytes consumed so far, as sent.
+    int _expected;                  // The body's Content-Length, or -1 if unknown.
+    Print* _sink;                   // Where decoded bytes are streamed to, or nullptr to decode into _buffer.
+    ContentEncoding _encoding;
+    DecoderState _state;
+    tinfl_decompressor* _inflater;  // Only allocated for compressed bodies, roughly 11 KB.
+    uint32_t _inflateFlags;
+    uint8_t _header[10];            // Collects fixed size header fields that may be split across writes.
+    int _headerCount;
+    uint16_t _extraRemaining;       // Bytes of the gzip extra field still to be skipped.
+    uint8_t _gzipFlags;             // Optional gzip header fields still to be skipped.
+    bool _overflowed;
+};
+
+ContentEncoding ParseContentEncoding(const char*);
+
+#endif
\ No newline at end of file
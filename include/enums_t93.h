@@ -14,4 +14,116 @@ enum ButtonActionResult {
   HoldPress = 3     // The button was released after being held
 };
 
+enum BenchAsteriskPosition {
+  AsteriskAbsent = 0, // The generated payload contains no asterisk notation.
+  AsteriskFirst = 1,  // The asterisk precedes the first value, the worst case for the shifting strip as the whole payload is shifted.
+  AsteriskLast = 2    // The asterisk precedes the last value, leaving little of the buffer to shift.
+};
+
+enum BenchSeriesPattern {
+  SeriesFlat = 0,       // A value that never changes, polled on schedule. The best case.
+  SeriesSteady = 1,     // A counter rising at a near constant rate, sampled a second or so either side of schedule.
+  SeriesNoisy = 2,      // A counter rising by a random amount each sample, so its changes don't compress.
+  SeriesIrregular = 3   // Occasional jumps in value and hours long gaps in time, as an outage leaves.
+};
+
+enum ProfiledSection {
+  SectionAPIPolling = 0,          // ProcessAPIPolling(), including any blocking HTTPS request.
+  SectionDisplayValueUpdate = 1,  // ProcessDisplayValueUpdate().
+  SectionButtons = 2,             // ProcessButtons(), including the post-press feedback delay.
+  SectionLDR = 3,                 // ProcessLDR().
+  SectionMarquee = 4,             // ProcessMarquee(), stepping scrolling text.
+  SectionFleet = 5,               // ProcessFleet(), sending and receiving fleet packets.
+  SectionOTA = 6,                 // ProcessOTA(), including any blocking firmware download.
+  SectionHealth = 7,              // ProcessHealth(), including any recovery step it takes.
+  SectionPanels = 8,              // ProcessPanels(), composing and flushing the additional LCDs.
+  SectionWriteToLCD = 9,          // WriteToLCD(), called from within the sections above. This and those after it are helpers, not blamed for stalls.
+  SectionLCDAnimation = 10,       // PerformLCDAnimation(), called from within WriteToLCD().
+  SectionPanelDelay = 11,         // DelayServicingPanels(), including the wait, called from within effects on the main LCD.
+  SectionCount = 12               // Not a section, the number of sections being profiled.
+};
+
+enum ContentEncoding {
+  EncodingIdentity = 0,     // Response body is not compressed.
+  EncodingGzip = 1,         // Deflate stream wrapped in a gzip header and trailer.
+  EncodingDeflate = 2,      // Deflate stream, either zlib wrapped (per the HTTP spec) or raw (as some servers send it).
+  EncodingUnsupported = 3   // Any other Content-Encoding, which can't be decoded.
+};
+
+enum DecoderState {
+  DecoderIdentity = 0,        // Copying an uncompressed body straight into the buffer.
+  DecoderGzipHeader = 1,      // Reading the fixed 10 byte gzip header.
+  DecoderGzipExtraLength = 2, // Reading the length of the optional gzip extra field.
+  DecoderGzipExtra = 3,       // Skipping the optional gzip extra field.
+  DecoderGzipName = 4,        // Skipping the optional null terminated file name.
+  DecoderGzipComment = 5,     // Skipping the optional null terminated comment.
+  DecoderGzipHeaderCrc = 6,   // Skipping the optional header CRC.
+  DecoderDeflateProbe = 7,    // Reading the first two bytes of a deflate body to determine whether it is zlib wrapped.
+  DecoderInflate = 8,         // Inflating compressed data into the buffer.
+  DecoderGzipTrailer = 9,     // Reading the gzip CRC and size trailer.
+  DecoderDone = 10,           // The compressed stream ended cleanly.
+  DecoderFailed = 11          // The body was malformed or too large for the buffer.
+};
+
+enum FleetPacketType {
+  FleetHeartbeat = 1, // Announces the sender is alive and part of the fleet.
+  FleetValues = 2     // Carries the poller's current values, each flagged stale or fresh.
+};
+
+enum LogLevel {
+  LogNone = 0,      // Nothing is logged.
+  LogError = 1,     // Failures that lose functionality, e.g. the API being unreachable.
+  LogWarning = 2,   // Unexpected conditions that are recovered from.
+  LogInfo = 3,      // Notable events, e.g. a new value arriving or a connection being made.
+  LogDebug = 4      // Step by step tracing, including from hot paths. Rate limited.
+};
+
+enum ValueViewMode {
+  ViewValue = 0,      // The selected value on the lower row, under its label.
+  ViewTrend = 1,      // The selected value followed by its rate of change, e.g. +123/h.
+  ViewSparkline = 2,  // The rate of change beside the label, with a sparkline of recent values on the lower row.
+  ViewBigDigits = 3,  // The value in digits two rows high, readable across a room. Values that don't fit are shown as in ViewValue.
+  ViewModeCount = 4   // Not a view, the number of views to cycle through.
+};
+
+enum HealthHeartbeat {
+  HeartbeatLoop = 0,    // Reported every pass of loop(), and from within the blocking WiFi connection loops.
+  HeartbeatPoller = 1,  // Reported each time a scheduled poll completes, successfully or not.
+  HeartbeatCount = 2    // Not a heartbeat, the number of heartbeats tracked.
+};
+
+enum HealthFault {
+  FaultNone = 0,          // Nothing wrong.
+  FaultAPIFailures = 1,   // HEALTH_API_FAILURE_LIMIT or more polls in a row have failed.
+  FaultPollerStalled = 2, // No poll has completed in HEALTH_POLLER_STALL_SECONDS.
+  FaultHeapLow = 3,       // Free heap, or the largest block of it, is below its minimum.
+  FaultHeapLeak = 4,      // Free heap is falling steadily enough to run out within HEALTH_LEAK_HORIZON_HOURS.
+  FaultLoopStalled = 5    // loop() hasn't made progress in HEALTH_LOOP_STALL_SECONDS.
+};
+
+enum RecoveryLevel {
+  RecoveryNone = 0,       // Healthy, nothing has been done.
+  RecoveryHTTPClient = 1, // The API connection is closed and its cached DNS answer dropped.
+  RecoveryWiFi = 2,       // WiFi is disconnected and reconnected.
+  RecoveryPoller = 3,     // The API connection, poll schedule and fleet membership are set up afresh.
+  RecoveryRestart = 4     // The ESP is restarted, keeping the values shown and the reason (see HealthRetained).
+};
+
+enum GlyphSet {
+  GlyphSetAnimation = 1,  // The characters of the sine-wave animation (see animationCustomChars).
+  GlyphSetSparkline = 2,  // The sparkline bars, indexed by height.
+  GlyphSetBigDigit = 3,   // The segments big digits are built from (see bigDigitSegments).
+  GlyphSetScratch = 4     // Slots rewritten frame by frame, e.g. by the rolling digit effect. Indexed by slot, never shared.
+};
+
+enum DeadlinePhase {
+  PhaseNone = 0,      // Outside a poll, nothing is cut short.
+  PhaseDNS = 1,       // Resolving the API host, when the cached answer has expired.
+  PhaseConnect = 2,   // Waiting for the TCP connection to be accepted.
+  PhaseTLS = 3,       // The TLS handshake.
+  PhaseHeaders = 4,   // Sending the request and reading the response headers.
+  PhaseBody = 5,      // Reading and decoding the response body.
+  PhaseCount = 6      // Not a phase, the number of phases tracked.
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef _T93_LCD_COUNTER_FLEET_h
+#define _T93_LCD_COUNTER_FLEET_h
+
+#include <Arduino.h>
+
+#include "enums_t93.h"
+
+#define FLEET_MAGIC           "T93F" // Leads every fleet packet, so stray traffic on the port is discarded before checking its tag.
+#define FLEET_HEADER_LENGTH   19     // Magic (4), type (1), MAC (6), boot nonce (4), sequence number (4).
+#define FLEET_VALUE_STALE     0x01   // Flag set on a shared value the poller is serving from its cache.
+
+void InitializeFleet();
+void ProcessFleet();
+bool IsFleetPoller();
+bool HasRecentFleetValues();
+void ShareFleetValues();
+
+bool JoinFleetGroup();
+void SendFleetPacket(FleetPacketType);
+void HandleFleetPacket(uint8_t*, int);
+void ApplyFleetValues(const uint8_t*, int);
+int FindFleetPeer(const uint8_t*, bool);
+bool IsFleetReplay(int, uint32_t, uint32_t);
+bool IsLowestFleetPeer(int);
+void ExpireFleetPeers();
+void SignFleetPacket(const uint8_t*, int, uint8_t*);
+void PutFleetUint32(uint8_t*, uint32_t);
+uint32_t GetFleetUint32(const uint8_t*);
+
+#endif
\ No newline at end of file
@@ -6,25 +6,76 @@
 #include <hd44780ioClass/hd44780_I2Cexp.h>
 
 #include "enums_t93.h"
+#include "lcdbus_t93.h"
 
 // Debugging configuration
-#define DEBUG                 true    // Optional printing of debug messages to serial.
+#define DEBUG                 true    // Optional printing of debug messages to serial. When false all logging is compiled out.
+#define LOG_BAUD              9600    // The serial baud rate log messages are written at.
+#define LOG_RING_SIZE         64      // The number of log records buffered for the drain task, must be a power of 2. Records logged while it is full are dropped and counted.
+#define LOG_DRAIN_INTERVAL_MS 20      // How often the drain task formats and writes out buffered log records.
+#define LOG_RATE_LIMIT        5       // The most times a single log statement is recorded per LOG_RATE_WINDOW_MS. Further repeats are counted and reported with the next one recorded.
+#define LOG_RATE_WINDOW_MS    1000
+#define LOG_LEVEL_API         LogInfo // Per module log levels (see LogLevel). Statements more verbose than their module's level are compiled out.
+#define LOG_LEVEL_BENCH       LogInfo
+#define LOG_LEVEL_BUTTONS     LogInfo
+#define LOG_LEVEL_CACHE       LogInfo
+#define LOG_LEVEL_DEADLINE    LogInfo
+#define LOG_LEVEL_DECODE      LogInfo
+#define LOG_LEVEL_EEPROM      LogInfo
+#define LOG_LEVEL_FLEET       LogInfo
+#define LOG_LEVEL_GLYPH       LogInfo
+#define LOG_LEVEL_HEALTH      LogInfo
+#define LOG_LEVEL_IMAGE       LogInfo
+#define LOG_LEVEL_LCD         LogInfo
+#define LOG_LEVEL_LDR         LogInfo
+#define LOG_LEVEL_MAIN        LogInfo
+#define LOG_LEVEL_NET         LogInfo
+#define LOG_LEVEL_OTA         LogInfo
+#define LOG_LEVEL_PANELS      LogInfo
+#define LOG_LEVEL_PAYLOAD     LogInfo
+#define LOG_LEVEL_PROFILER    LogInfo
+#define LOG_LEVEL_SCHEDULE    LogInfo
+#define LOG_LEVEL_SERIES      LogInfo
+#define LOG_LEVEL_SLOTS       LogInfo
+#define LOG_LEVEL_TLS         LogInfo
+#define LOG_LEVEL_WIFI        LogInfo
 
 // Helper methods
 #define LEN(arr)              ((int) (sizeof (arr) / sizeof (arr)[0]))
-#define DEBUG_SERIAL          if (DEBUG) Serial
 
 // EEPROM
 #define EEPROM_INIT           false // When set to true, EEPROM is written over with 0's. Perform once per ESP32 unit.
-#define EEPROM_SIZE           100   // The size of the EEPROM to save information in. 100 is overkill as currently there are only two ints in play.
+#define EEPROM_SIZE           100   // The size of the EEPROM to save information in. 100 is overkill as currently there are only three ints in play.
 #define SV_INDEX              10    // The location in EEPROM of the _selectedValueIndex variable.
 #define DM_INDEX              20    // The location in EEPROM of the _selectedDisplayMode variable.
+#define VM_INDEX              30    // The location in EEPROM of the _selectedViewMode variable.
 
 // LCD
 #define ANIM_FRAME_COUNT      8     // The number of frames in the LCD animation sequence.
 #define LCD_COLUMNS           16    // Number of columns in the LCD.
 #define LCD_ROWS              2     // Number of rows in the LCD.
+#define LCD_DDRAM_COLUMNS     40    // Number of characters per row held in the HD44780's display RAM. Text longer than LCD_COLUMNS is written here in full and scrolled into view.
+#define MARQUEE_GAP           4     // The minimum number of blank columns between the end of scrolling text and its start coming back around.
+#define MARQUEE_STEP_MS       350   // How long each position of scrolling text is held for.
+#define MARQUEE_PAUSE_MS      2000  // How long scrolling text is held at its start position before each pass.
 #define LCD_ADDRESS           0x27  // The I2C address the LCD lives at. Can be found using an I2C scanning sketch.
+#define I2C_CLOCK_HZ          100000 // The I2C bus speed shared by every LCD. PCF8574 backpacks are rated to 100 kHz.
+#define ODOMETER_UPDATES      true  // When true, a changed value rolls only the characters that differ into place rather than animating and redrawing the whole display.
+#define ODOMETER_FRAME_MS     40    // How long each frame of the rolling digit effect is held for.
+#define ODOMETER_ROLL_STEP    2     // How many pixel rows the digits move per frame. Characters are 8 rows high.
+#define SPARKLINE_LEVELS      8     // The bar heights a sparkline column can take, one CGRAM slot each when on display.
+#define BIG_DIGIT_WIDTH       3     // Columns per digit in the big digit view. Up to 4 digits fit spaced apart, 5 touching.
+#define BIG_DIGIT_MINUS       4     // The big digit segment drawn for a minus sign.
+#define CGRAM_SLOTS           8     // Custom characters the HD44780 holds at once. Shared between the animation, sparklines, big digits and rolling digits (see glyph_t93).
+
+// Additional LCDs
+#define MULTI_LCD             false // When set to true, the LCDs listed in EXTRA_LCDS are driven alongside the main one, on the same I2C bus.
+#define EXTRA_LCDS            { { 0x26, 1 }, { 0x25, -1 } } // The I2C address of each additional LCD and the value slot it shows, or -1 to page through every value. Each needs its PCF8574 address jumpers set differently.
+#define LCD_PAGE_SECONDS      5     // How long each value is shown for by LCDs paging through every value.
+#define LCD_BUS_BUDGET        24    // The most bytes sent to the additional LCDs per loop(), roughly 11 ms of bus time at 100 kHz. The main LCD writes directly and isn't budgeted, so its effects can still hold the bus for longer.
+#define LCD_BUS_RUN_MAX       8     // The most characters one LCD may send per turn before the next LCD is served.
+#define LCD_BUS_BITS_PER_TRANSFER 47 // Bus bit times per byte sent to an LCD: address and 4 expander writes (two strobed nibbles) of 9 bits each, plus start and stop.
+#define LCD_BUS_REPORT_SECONDS 60   // How often bus utilisation is logged, per LCD. Also logged for the main LCD alone when MULTI_LCD is false.
 
 // Buttons
 #define BTN_1_PIN             34    // The input pin the first button is connected to.
@@ -36,18 +87,95 @@
 
 // WiFi / API
 #define WIFI_RECONN_TIMEOUT   10    // How long to attempt WiFi connection with saved credentials before invoking portal. Also how often it will wait between re-attempts when portal is running.
-#define POLL_INTERVAL_SECONDS 30    // How often to poll the endpoint.
-#define API_VALUE_COUNT       3     // The number of values this version of code expects from the API, values in excess will be discarded. There should be a _valueLabel entry for each of these in secrets file.
+#define POLL_INTERVAL_SECONDS 30    // How often to poll the endpoint. Each counter polls at its own offset into the interval (see schedule_t93).
+#define NTP_SERVER            "pool.ntp.org" // Where the clock is set from, so poll offsets line up across the fleet.
+#define NTP_VALID_AFTER       1609459200 // The clock is considered set once past this Unix time (2021-01-01).
+#define PREWARM_LEAD_MS       3000  // How long before a poll is due to resolve the API host and complete the TLS handshake, so the request itself goes out on time.
+#define REFRESH_COALESCE_MS   5000  // Refreshes requested (button 2) within this long of the last or next scheduled poll are served by that poll rather than one of their own.
+#define DNS_MIN_TTL_SECONDS   30    // Bounds applied to the TTL of a cached DNS answer.
+#define DNS_MAX_TTL_SECONDS   3600
+#define TLS_CONNECT_TIMEOUT_MS 5000 // How long to wait for the TCP connection to the API to be accepted.
+#define TLS_HANDSHAKE_TIMEOUT_MS 8000 // How long the TLS handshake with the API may take before the connection attempt is abandoned.
+#define TLS_MAX_FRAGMENT_CODE 2     // The Max Fragment Length requested from the API server, as the RFC 6066 code: 1 = 512, 2 = 1024, 3 = 2048, 4 = 4096 bytes. 0 to not request it.
+#define POLL_BUDGET_MS        12000 // The most a poll may take, from resolving the API host to the last of the body. Opening the connection ahead of a poll gets a budget of its own.
+#define DNS_BUDGET_MS         2000  // The most each phase of a poll may take (see DeadlinePhase), cut short where POLL_BUDGET_MS would otherwise be exceeded.
+#define CONNECT_BUDGET_MS     3000  // A phase that overruns abandons the poll, leaving the values held on display.
+#define TLS_BUDGET_MS         5000
+#define HEADERS_BUDGET_MS     3000
+#define BODY_BUDGET_MS        3000
+#define MAX_VALUE_SLOTS       32    // The most values accepted from the API, values in excess will be discarded. Values without a _valueLabel entry in the secrets file are given a generated label.
+#define SLOT_ARENA_SIZE       1024  // Bytes shared by the labels and values of every slot. Values that don't fit are truncated.
+#define VALUE_COUNT_POLLS     2     // Payloads in a row that must agree on a new number of values before the slots are resized to it. Those before are rejected.
 #define RESPONSE_BUFFER_SIZE 512    // The size of the buffer to read the API response string into. Must be at least as large as the length of the returned payload.
-#define MAX_VALUE_LENGTH      16    // The maximum length of each return value including termination character. Note only allowing up to 15 chars (plus termination) because the 16th column is used for the folling indicator.
+#define VALUE_MAX_AGE_SECONDS 300   // How long the last good value keeps being shown while polls fail. After this it is replaced with "Unknown".
+#define STALE_INDICATOR       '~'   // Shown in place of the polling indicator while the selected value is being served from cache after a failed poll.
+#define MAX_VALUE_LENGTH      (LCD_DDRAM_COLUMNS - MARQUEE_GAP + 1) // The maximum length of each return value including termination character. Values longer than 15 chars scroll as the 16th column is used for the polling indicator.
+
+// History
+#define HISTORY_SAMPLES       (LCD_COLUMNS - 1) // Numeric samples kept per value slot, one per sparkline column. Uses MAX_VALUE_SLOTS * HISTORY_SAMPLES * 8 bytes (3840).
+#define HISTORY_SAMPLE_SECONDS 60   // The minimum spacing of samples. Values fetched sooner replace the newest sample, so the ring spans at least HISTORY_SAMPLES - 1 of these.
+#define HISTORY_RATE_SCALE    100   // Rates are held as fixed point multiples of 1 / HISTORY_RATE_SCALE per hour.
+
+// Series store
+#define SERIES_STORE          true  // When set to true, numeric values are kept for days on the LittleFS partition (labelled spiffs in the partition table), compressed (see series_t93). Formats the partition if it doesn't hold LittleFS already.
+#define SERIES_PATH           "/series" // The directory the files of samples are kept in, numbered in the order they were written.
+#define SERIES_MAX_SLOTS      8     // How many value slots (the first) have their history stored. Each holds a SERIES_CHUNK_SIZE chunk in RAM while it fills.
+#define SERIES_SAMPLE_SECONDS 60    // The spacing of stored samples. Polls in between aren't stored.
+#define SERIES_CHUNK_SIZE     512   // Bytes per chunk, the unit samples are encoded in. A multiple of the LittleFS page size, so writes program whole pages.
+#define SERIES_SEGMENT_CHUNKS 8     // Chunks per file. Full chunks of every slot are held in RAM (4 KB) until there are this many, then written as a new file in one go, so LittleFS never copies a partly filled block to append to it. 8 of 512 bytes fill a 4 KB LittleFS block, the unit the oldest history is deleted in.
+#define SERIES_SEAL_MINUTES   360   // The longest a sample is held in RAM before being written. Everything held is then written as a file, full or not. Bounds the history lost to a power cut.
+#define SERIES_RESERVE_BYTES  8192  // Free space kept on the filesystem. The oldest files are deleted to keep it.
+#define SERIES_CHUNK_MAGIC    0x93  // Marks the start of a chunk written by this firmware.
+
+// Fleet
+#define FLEET_MODE            false // When set to true, counters on the same LAN elect one of themselves (the lowest MAC) to poll the API and share the values with the rest over UDP multicast. Requires SECRET_FLEET_KEY.
+#define FLEET_GROUP           239, 255, 93, 1 // The multicast group the fleet communicates on. Administratively scoped, so it stays within the LAN.
+#define FLEET_PORT            49393
+#define FLEET_HEARTBEAT_MS    5000  // How often each counter announces itself to the rest of the fleet.
+#define FLEET_LEASE_MS        16000 // How long a counter is considered part of the fleet after last being heard from. A poller that goes quiet for this long is replaced.
+#define FLEET_MAX_PEERS       32    // The number of other counters tracked. Any beyond this are ignored until a slot frees up.
+#define FLEET_RETIRED_NONCES  3     // Previous boots remembered per peer, so packets captured before a peer restarted are still rejected as replays.
+#define FLEET_TAG_LENGTH      16    // Bytes of HMAC-SHA256 appended to each packet to authenticate it.
+#define FLEET_PACKET_SIZE     (24 + SLOT_ARENA_SIZE + MAX_VALUE_SLOTS * 2 + FLEET_TAG_LENGTH)
+
+// Firmware updates
+#define OTA_CHECK_MINUTES     60    // How often SECRET_OTA_URL is checked for new firmware.
+#define OTA_HEALTH_CHECK_SECONDS 600 // How long newly installed firmware has to fetch a value before it is rolled back to the previous firmware.
+#define OTA_HASH_HEADER       "X-Image-SHA256" // Response header carrying the SHA-256 of the (uncompressed) firmware image, which must match before it is booted.
+
+// Benchmarking
+#define PAYLOAD_BENCHMARK     false // When set to true, the API payload pipeline is benchmarked against generated payloads at boot and the results logged, so DEBUG must be true. Also run on the host by test/test_bench.
+#define BENCH_ITERATIONS      200   // The number of times each generated payload is run through a pipeline when benchmarking.
+#define BENCH_MAX_PAYLOAD     1024  // The size of the largest payload generated when benchmarking. Deliberately larger than RESPONSE_BUFFER_SIZE to exercise the oversized path.
+#define SERIES_BENCHMARK      false // When set to true, generated series are written to and read back from the LittleFS partition at boot, as the series store would, and the timings logged, so DEBUG must be true. The encoding itself is benchmarked on the host by test/test_bench.
+#define SERIES_BENCH_SAMPLES  4000  // Samples in each generated series, a little under 3 days at SERIES_SAMPLE_SECONDS.
+#define SERIES_BENCH_START    1700000000 // The Unix time generated series start from.
+#define SERIES_BENCH_PATH     "/bench-series" // Prefix of the files the series benchmark writes, numbered from 0 and deleted afterwards.
+
+// Profiling
+#define LOOP_PROFILING        false // When set to true, subsystem calls within loop() are timed and a stall report is logged whenever an iteration exceeds LOOP_BUDGET_MS. Compiled out entirely when false.
+#define LOOP_BUDGET_MS        250   // The longest a single loop() iteration may take before it is reported as a stall.
+#define PROFILE_RING_SIZE     64    // The number of recent samples kept per profiled section for calculating min/mean/max/p99.
+#define PROFILE_REPORT_SECONDS 60   // How often the per-section timing summary is logged.
 
-#define RESTART_INTERVAL      86,400,000  // The number of milliseconds in 24 hours, used for periodic reboots to keep memory fresh.
+// Health monitoring
+#define HEALTH_TREND_SAMPLES  30    // Heap samples the trend is measured across. One is taken as each poll completes, when the connection is in the same state each time.
+#define HEALTH_MIN_FREE_HEAP  24576 // Free heap below this is a fault.
+#define HEALTH_MIN_HEAP_BLOCK 12288 // A largest free block below this is a fault. The TLS handshake needs blocks of several KB, so fragmentation shows here first.
+#define HEALTH_LEAK_HORIZON_HOURS 12 // Free heap falling fast enough across the trend to drop below HEALTH_MIN_FREE_HEAP within this long is a fault.
+#define HEALTH_API_FAILURE_LIMIT 5  // Consecutive failed polls before recovery starts.
+#define HEALTH_POLLER_STALL_SECONDS (POLL_INTERVAL_SECONDS * 4) // How long without a poll completing before the poller is considered stalled.
+#define HEALTH_LOOP_STALL_SECONDS 180 // How long loop() may go without a heartbeat before the ESP is restarted. Allows for a slow firmware download.
+#define HEALTH_RECOVERY_GRACE_SECONDS (POLL_INTERVAL_SECONDS * 3) // How long each recovery step is given to work before the next, more disruptive one. Doubled before a restart for each restart since the last successful poll.
+#define HEALTH_RETAINED_MAGIC 0x54393348UL // Marks HealthRetained as written by this firmware rather than left over from power on.
 
-extern hd44780_I2Cexp _lcd;
-extern char _currentValue[API_VALUE_COUNT][MAX_VALUE_LENGTH];       // The current values available to be rendered on the display. One for each API value. Length (incl termination char) is up to the number of columns on the LCD as the last column is reserved for API polling indicator.
-extern bool _currentValueUpdated[API_VALUE_COUNT];                  // Whether the latest value received from the API differs from what is currently being rendered. One for each API value.
+extern MeteredLCD _lcd;
+extern bool _currentValueUpdated[MAX_VALUE_SLOTS];                  // Whether the latest value received from the API differs from what is currently being rendered. One for each value slot (see slots_t93).
+extern unsigned long _currentValueFetchedAt[MAX_VALUE_SLOTS];       // The millis() at which each value was last successfully fetched. 0 if never fetched.
+extern bool _currentValueStale[MAX_VALUE_SLOTS];                    // Whether the latest attempt to fetch each value failed, meaning the value shown is from cache.
 extern int _selectedValueIndex;                                     // The statistic chosen to be displayed. API returns multiple, pipe delimited ints. The one selected here is what is rendered on the display.
 extern DisplayDimmingMode _selectedDisplayMode;                     // How the display backlight should behave when the device is in a dark room.
+extern ValueViewMode _selectedViewMode;                             // How the selected value is presented, cycled by holding button 2.
 extern bool _lcdBacklightOn;                                        // Whether the LCD backlight is on.
 
 #endif
\ No newline at end of file
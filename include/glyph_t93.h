@@ -0,0 +1,26 @@
+#ifndef _T93_LCD_COUNTER_GLYPH_h
+#define _T93_LCD_COUNTER_GLYPH_h
+
+#include <Arduino.h>
+
+#include "enums_t93.h"
+
+#define GLYPH_ID(set, index)  ((uint16_t) (((set) << 8) | (index)))    // Identifies a logical glyph (see GlyphSet). Never 0, which marks an empty slot.
+
+// What a CGRAM slot holds.
+struct GlyphSlot {
+  uint16_t id;                                      // The logical glyph uploaded to the slot, 0 if none.
+  uint8_t users;                                    // Characters on display showing the slot. It can't be rewritten until this is 0.
+  uint32_t lastUsed;                                // When the glyph was last acquired, in acquisitions. The least recent is evicted first.
+};
+
+void InitializeGlyphs();
+int AcquireGlyph(uint16_t, const byte*);
+int AcquireScratchGlyph();
+void UpdateScratchGlyph(int, const byte*);
+void ReleaseGlyph(int);
+void ReleaseAllGlyphs();
+int FindEvictableGlyphSlot();
+uint32_t GetGlyphUploads();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef _T93_LCD_COUNTER_HEALTH_h
+#define _T93_LCD_COUNTER_HEALTH_h
+
+#include <Arduino.h>
+
+#include "globals_t93.h"
+
+// Kept in RTC memory, which survives a software restart, so a restart made to recover is explained and values shown again straight away.
+struct HealthRetained {
+  uint32_t magic;                                   // HEALTH_RETAINED_MAGIC when the rest has been written since power on.
+  uint16_t restarts;                                // Restarts made to recover since the last successful poll.
+  uint8_t fault;                                    // The HealthFault behind the last of them, FaultNone once reported.
+  uint8_t slotCount;                                // Values held below, 0 once restored.
+  uint32_t valueAges[MAX_VALUE_SLOTS];              // How long before the restart each value was fetched in milliseconds, UINT32_MAX if never.
+  char values[SLOT_ARENA_SIZE];                     // Each value null terminated, packed end to end.
+  uint32_t checksum;                                // FNV-1a of everything above, as RTC memory holds garbage after power on.
+};
+
+void InitializeHealth();
+void ProcessHealth();
+void ReportHeartbeat(HealthHeartbeat);
+void ReportPollResult(bool);
+HealthFault DiagnoseHealth();
+void PerformRecovery(RecoveryLevel, HealthFault);
+void SampleHeap();
+void ClearHeapTrend();
+bool GetHeapTrend(int32_t*, int32_t*);
+void HealthMonitorTask(void*);
+void SaveWarmStart(HealthFault);
+bool RestoreWarmStart();
+uint32_t ChecksumRetained();
+const char* GetHealthFaultName(HealthFault);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef _T93_LCD_COUNTER_HISTORY_h
+#define _T93_LCD_COUNTER_HISTORY_h
+
+#include <Arduino.h>
+
+// A numeric value as it was when fetched.
+struct HistorySample {
+  uint32_t time;    // The millis() it was fetched at.
+  int32_t value;
+};
+
+void ClearHistory(int);
+bool RecordHistorySample(int, const char*);
+int GetHistoryCount(int);
+HistorySample GetHistorySample(int, int);
+int32_t GetHistoryDelta(int);
+bool GetHistoryRate(int, int64_t*);
+bool FormatHistoryTrend(int, char*, int);
+int GetSparklineLevels(int, uint8_t*, int);
+bool ParseHistoryValue(const char*, int32_t*);
+
+#endif
\ No newline at end of file
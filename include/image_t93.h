@@ -0,0 +1,30 @@
+#ifndef _T93_LCD_COUNTER_IMAGE_h
+#define _T93_LCD_COUNTER_IMAGE_h
+
+#include <Arduino.h>
+#include "mbedtls/sha256.h"
+
+#include "decode_t93.h"
+
+// Receives the decoded firmware image, hashing it as it is written to the inactive app partition.
+class FirmwareWriter : public Print {
+  public:
+    FirmwareWriter();
+    ~FirmwareWriter();
+
+    size_t write(uint8_t) override;
+    size_t write(const uint8_t*, size_t) override;
+    void digest(uint8_t*);
+    size_t length();
+
+  private:
+    mbedtls_sha256_context _sha;
+    size_t _length;
+};
+
+bool FinishFirmwareImage(PayloadDecoder&, FirmwareWriter&, const uint8_t*);
+bool ParseImageHash(const char*, uint8_t*);
+void FormatImageHash(const uint8_t*, char*);
+void FormatImageTag(const uint8_t*, char*);
+
+#endif
\ No newline at end of file
@@ -82,9 +82,62 @@ const int animationSequence[ANIM_FRAME_COUNT][LCD_ROWS] =
   { 5, 2 },
 };
 
+// The ROM font's digits 0-9 followed by a blank, used to build the frames of the rolling digit effect.
+const byte odometerGlyphs[][8] =
+{
+  { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, 0x00 },
+  { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00 },
+  { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, 0x00 },
+  { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E, 0x00 },
+  { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, 0x00 },
+  { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, 0x00 },
+  { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, 0x00 },
+  { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08, 0x00 },
+  { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x00 },
+  { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, 0x00 },
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
+};
+
+// The segments big digits are built from, each a corner or bar of a digit two characters high.
+const byte bigDigitSegments[][8] =
+{
+  { 0x07, 0x0F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },   // Upper left corner.
+  { 0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00 },   // Upper bar.
+  { 0x1C, 0x1E, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F },   // Upper right corner.
+  { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x0F, 0x07 },   // Lower left corner.
+  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F },   // Lower bar, also the minus sign.
+  { 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1E, 0x1C },   // Lower right corner.
+  { 0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x1F, 0x1F },   // Upper bar and the top of the middle bar.
+  { 0x1F, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F }    // The bottom of the middle bar and lower bar.
+};
+
+// Each digit's upper and lower row, 3 columns wide. Values index bigDigitSegments, anything larger is a ROM character (0xFF being a full block).
+const uint8_t bigDigitFont[10][LCD_ROWS][BIG_DIGIT_WIDTH] =
+{
+  { { 0, 1, 2 },          { 3, 4, 5 } },
+  { { 1, 2, ' ' },        { 4, 0xFF, 4 } },
+  { { 6, 6, 2 },          { 3, 7, 7 } },
+  { { 6, 6, 2 },          { 7, 7, 5 } },
+  { { 3, 4, 0xFF },       { ' ', ' ', 0xFF } },
+  { { 0xFF, 6, 6 },       { 7, 7, 5 } },
+  { { 0, 6, 6 },          { 3, 7, 5 } },
+  { { 1, 1, 2 },          { ' ', ' ', 0xFF } },
+  { { 0, 6, 2 },          { 3, 7, 5 } },
+  { { 0, 6, 2 },          { ' ', ' ', 0xFF } }
+};
+
 void InitializeLCD();
 void ProcessDisplayValueUpdate(bool = false);
+void WriteValueView();
+bool WriteBigDigits(const char*);
+bool LayoutBigDigits(const char*, uint16_t[LCD_ROWS][LCD_COLUMNS - 1]);
+void ClearLCD();
 void WriteToLCD(const char*, const char* = "", bool = false);
 void PerformLCDAnimation();
+void PerformOdometerUpdate(const char*, const char*);
+void ResetMarquee(bool);
+void ProcessMarquee();
+void DrawPollIndicator(bool);
+int OdometerGlyphIndex(char);
 
 #endif
\ No newline at end of file
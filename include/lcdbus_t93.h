@@ -0,0 +1,32 @@
+#ifndef _T93_LCD_COUNTER_LCDBUS_h
+#define _T93_LCD_COUNTER_LCDBUS_h
+
+#include <Wire.h>
+#include <hd44780.h>
+#include <hd44780ioClass/hd44780_I2Cexp.h>
+
+// An LCD that counts the bytes it sends over I2C, so the load every LCD puts on the shared bus can be reported.
+// Only the calls made by this firmware are counted, each byte being one transfer (see LCD_BUS_BITS_PER_TRANSFER).
+class MeteredLCD : public hd44780_I2Cexp {
+  public:
+    MeteredLCD(uint8_t, int, int);
+
+    size_t write(uint8_t) override;
+    using Print::write;
+    int clear();
+    int home();
+    int setCursor(uint8_t, uint8_t);
+    int createChar(uint8_t, const uint8_t*);
+    int scrollDisplayLeft();
+    int backlight();
+    int noBacklight();
+    uint32_t transfers();
+
+  private:
+    uint32_t _transfers;
+};
+
+void CountBusTransfers(uint32_t);
+uint32_t GetBusTransfers();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef _T93_LCD_COUNTER_LOG_h
+#define _T93_LCD_COUNTER_LOG_h
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+
+#define LOG_MAX_ARGS          8     // 32 bit argument slots per log record. 64 bit arguments take two.
+#define LOG_TEXT_SIZE         48    // Bytes per log record for copies of string arguments. Strings are truncated to fit.
+#define LOG_LINE_SIZE         192   // The longest formatted log line, longer lines are truncated.
+
+// Each source file defines LOG_MODULE (e.g. API) before logging, selecting its LOG_LEVEL_<module> from globals_t93.h.
+// Arguments are recorded raw and only formatted once the drain task picks the record up, so logging from the loop is a copy into
+// the ring rather than a wait on the serial port. String arguments are copied into the record, as they may not outlive the call.
+#define LOG_ERROR(...)        LOG_AT(LogError, __VA_ARGS__)
+#define LOG_WARNING(...)      LOG_AT(LogWarning, __VA_ARGS__)
+#define LOG_INFO(...)         LOG_AT(LogInfo, __VA_ARGS__)
+#define LOG_DEBUG(...)        LOG_AT(LogDebug, __VA_ARGS__)
+#define LOG_REPORT(...)       LOG_AT_RATE(LogInfo, false, __VA_ARGS__)    // For the lines of multi-line reports, which would otherwise be rate limited.
+
+#define LOG_MODULE_LEVEL(module)  LOG_MODULE_LEVEL_(module)
+#define LOG_MODULE_LEVEL_(module) LOG_LEVEL_##module
+#define LOG_MODULE_NAME(module)   LOG_MODULE_NAME_(module)
+#define LOG_MODULE_NAME_(module)  #module
+
+#define LOG_AT(level, ...)     LOG_AT_RATE(level, true, __VA_ARGS__)
+
+#define LOG_AT_RATE(level, limited, format, ...) do {                                           \
+  if (DEBUG && level <= LOG_MODULE_LEVEL(LOG_MODULE)) {                                         \
+    static LogSite _logSite = { format, level, LOG_MODULE_NAME(LOG_MODULE), limited, {0}, {0}, {0} }; \
+    LogWrite(&_logSite, ##__VA_ARGS__);                                                         \
+  }                                                                                             \
+} while (0)
+
+// A single log statement. The format string's address identifies it, and it carries the statement's rate limiting state.
+// That state is atomic as a statement may be reached from more than one task, e.g. in a function the health monitor task shares.
+struct LogSite {
+  const char* format;
+  LogLevel level;
+  const char* module;
+  bool limited;                               // Whether LOG_RATE_LIMIT applies.
+  std::atomic<uint32_t> windowStart;          // The millis() the current LOG_RATE_WINDOW_MS began at.
+  std::atomic<uint32_t> windowCount;          // Records made, or attempted once over the limit, in the current window.
+  std::atomic<uint32_t> suppressed;           // Repeats not recorded since the last record was made.
+};
+
+// What is buffered for each log statement made, to be formatted later by the drain task.
+struct LogRecord {
+  const LogSite* site;
+  uint32_t timestamp;
+  uint32_t args[LOG_MAX_ARGS];      // Integers, float bits, or offsets into text for strings.
+  uint16_t suppressed;
+  uint8_t argCount;
+  uint8_t textUsed;
+  char text[LOG_TEXT_SIZE];
+};
+
+void InitializeLogging();
+void FlushLog(unsigned long);
+bool AdmitLogSite(LogSite*, uint16_t*);
+void EnqueueLogRecord(const LogRecord&);
+bool DequeueLogRecord(LogRecord&);
+void LogDrainTask(void*);
+int FormatLogRecord(const LogRecord&, char*, int);
+void PushLogArg(LogRecord&, uint32_t);
+void CaptureLogArg(LogRecord&, const char*);
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type CaptureLogArg(LogRecord& record, T value) {
+  uint64_t bits = (uint64_t) static_cast<int64_t>(value);
+  PushLogArg(record, (uint32_t) bits);
+  if (sizeof(T) > 4) {
+    PushLogArg(record, (uint32_t) (bits >> 32));
+  }
+}
+
+inline void CaptureLogArg(LogRecord& record, double value) {
+  float narrowed = value;                                   // Floats are plenty for log output and fit a single slot.
+  uint32_t bits;
+  memcpy(&bits, &narrowed, sizeof(bits));
+  PushLogArg(record, bits);
+}
+
+inline void CaptureLogArg(LogRecord& record, const void* value) {
+  PushLogArg(record, (uint32_t) (uintptr_t) value);
+}
+
+inline void CaptureLogArgs(LogRecord&) {}
+
+template<typename T, typename... Rest>
+inline void CaptureLogArgs(LogRecord& record, T value, Rest... rest) {
+  CaptureLogArg(record, value);
+  CaptureLogArgs(record, rest...);
+}
+
+/*
+* Records a log statement and its arguments in the ring for the drain task, unless the statement is being rate limited.
+*/
+template<typename... Args>
+void LogWrite(LogSite* site, Args... args) {
+  uint16_t suppressed;
+  if (!AdmitLogSite(site, &suppressed)) {
+    return;
+  }
+
+  LogRecord record;
+  record.site = site;
+  record.timestamp = millis();
+  record.suppressed = suppressed;
+  record.argCount = 0;
+  record.textUsed = 0;
+  CaptureLogArgs(record, args...);
+  EnqueueLogRecord(record);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef _T93_LCD_COUNTER_NET_h
+#define _T93_LCD_COUNTER_NET_h
+
+#include <WiFi.h>
+
+#include "enums_t93.h"
+#include "tls_t93.h"
+
+void InitializeAPIConnection();
+bool PrewarmAPIConnection();
+void BeginAPIPhase(DeadlinePhase);
+void EndAPIDeadline();
+void CloseAPIConnection();
+LeanTLSClient& GetAPIClient();
+const char* GetAPIHost();
+uint16_t GetAPIPort();
+const char* GetAPIPath();
+
+bool ResolveAPIHost(IPAddress&);
+void InvalidateDNSCache();
+bool QueryDNS(const char*, IPAddress&, uint32_t&, unsigned long);
+int SkipDNSName(const uint8_t*, int, int);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef _T93_LCD_COUNTER_OTA_h
+#define _T93_LCD_COUNTER_OTA_h
+
+#include <Arduino.h>
+
+void InitializeOTA();
+void ProcessOTA();
+void ProcessOTAHealthCheck();
+bool CheckForFirmwareUpdate();
+bool HasFreshValue();
+
+#endif
\ No newline at end of file
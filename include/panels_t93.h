@@ -0,0 +1,34 @@
+#ifndef _T93_LCD_COUNTER_PANELS_h
+#define _T93_LCD_COUNTER_PANELS_h
+
+#include <Arduino.h>
+
+#include "globals_t93.h"
+
+// An additional LCD showing one value (or paging through them all) on the same I2C bus as the main LCD.
+// What it should show is composed into shadow, and sent to the LCD in runs of changed characters by ProcessLCDBus().
+struct LCDPanel {
+  LCDPanel(uint8_t address, int slot) : lcd(address, LCD_COLUMNS, LCD_ROWS), address(address), slot(slot) {}
+
+  MeteredLCD lcd;
+  uint8_t address;
+  int slot;                                         // The value slot shown, or -1 to page through every value.
+  bool present = false;                             // Whether the LCD answered at its address when initialized.
+  bool backlightOn = true;
+  int pageIndex = 0;                                // The value slot shown while paging.
+  unsigned long pageShownAt = 0;
+  char shadow[LCD_ROWS][LCD_COLUMNS];               // What the LCD should show.
+  char shown[LCD_ROWS][LCD_COLUMNS];                // What has been sent to it.
+  uint32_t reportedTransfers = 0;                   // The LCD's transfer count at the last utilisation report.
+};
+
+void InitializePanels();
+void ProcessPanels();
+void ServicePanels();
+void ComposePanel(LCDPanel&);
+void ProcessLCDBus();
+int FlushPanelRun(LCDPanel&, int);
+void DelayServicingPanels(unsigned long);
+void ReportBusUtilisation();
+
+#endif
\ No newline at end of file
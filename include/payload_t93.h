@@ -0,0 +1,11 @@
+#ifndef _T93_LCD_COUNTER_PAYLOAD_h
+#define _T93_LCD_COUNTER_PAYLOAD_h
+
+#include <Arduino.h>
+
+void RemoveAsteriskNotation(char*);
+bool ValidatePayloadFormat(char*);
+bool AcceptPayloadValueCount(int);
+int SplitPayloadValues(char*, char**, int);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef _T93_LCD_COUNTER_PROFILER_h
+#define _T93_LCD_COUNTER_PROFILER_h
+
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+
+#if LOOP_PROFILING
+
+#define PROFILE_SECTION(section)  ProfileScope _profileScope(section)   // Times the remainder of the enclosing scope against the given section.
+#define PROFILE_LOOP_BEGIN()      BeginLoopProfile()
+#define PROFILE_LOOP_END()        EndLoopProfile()
+
+void BeginLoopProfile();
+void EndLoopProfile();
+void RecordProfileSample(ProfiledSection, uint32_t);
+void LogStallReport(unsigned long);
+void LogProfileSummary();
+
+// Records the cycles between construction and destruction against a section. Cycle count wraps roughly every 17 seconds at 240 MHz.
+class ProfileScope {
+  public:
+    ProfileScope(ProfiledSection section) : _section(section), _start(ESP.getCycleCount()) {}
+    ~ProfileScope() { RecordProfileSample(_section, ESP.getCycleCount() - _start); }
+
+  private:
+    ProfiledSection _section;
+    uint32_t _start;
+};
+
+#else
+
+#define PROFILE_SECTION(section)
+#define PROFILE_LOOP_BEGIN()
+#define PROFILE_LOOP_END()
+
+#endif
+
+#endif
\ No newline at end of file
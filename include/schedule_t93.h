@@ -0,0 +1,18 @@
+#ifndef _T93_LCD_COUNTER_SCHEDULE_h
+#define _T93_LCD_COUNTER_SCHEDULE_h
+
+#include <Arduino.h>
+
+void InitializeSchedule();
+bool IsPollDue();
+unsigned long GetMillisUntilPoll();
+unsigned long GetMillisSincePoll();
+void StartPoll();
+void ScheduleNextPoll(unsigned long);
+unsigned long GetPollSlotDelay(unsigned long);
+unsigned long GetSlotDelay(uint64_t, unsigned long, uint32_t);
+bool IsTimeSynced();
+uint64_t GetEpochMillis();
+uint32_t HashMacAddress(const uint8_t*);
+
+#endif
\ No newline at end of file
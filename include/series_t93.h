@@ -0,0 +1,95 @@
+#ifndef _T93_LCD_COUNTER_SERIES_h
+#define _T93_LCD_COUNTER_SERIES_h
+
+#include <Arduino.h>
+
+#include "globals_t93.h"
+
+// Sits at the start of every chunk, so a range query can skip chunks outside the range (and summarise those inside a single bucket) without decoding them.
+struct SeriesChunkHeader {
+  uint8_t magic;                                    // SERIES_CHUNK_MAGIC, anything else marks the end of a file's chunks.
+  uint8_t slot;                                     // The value slot the samples are of, as a file holds chunks of every slot.
+  uint16_t count;                                   // Samples in the chunk, the first held in full below and the rest encoded in data.
+  uint32_t firstTime;                               // Unix time of the first and last samples, in seconds.
+  uint32_t lastTime;
+  int32_t firstValue;
+  int32_t lowest;                                   // The range of values across the chunk.
+  int32_t highest;
+};
+
+// The unit samples are encoded in. After the first, each sample's time and value are stored as the change in their
+// rate (delta-of-delta), so a value polled on schedule that is steady or changing steadily costs a couple of bits per sample.
+struct SeriesChunk {
+  SeriesChunkHeader header;
+  uint8_t data[SERIES_CHUNK_SIZE - sizeof(SeriesChunkHeader)];
+};
+
+// The chunk a slot's samples are being added to, and what's needed to encode the next sample against the last.
+struct SeriesEncoder {
+  SeriesChunk chunk;
+  uint16_t bits;                                    // Bits of chunk.data used.
+  uint32_t lastTime;
+  int32_t lastValue;
+  int64_t timeDelta;                                // The change between the last two samples.
+  int64_t valueDelta;
+};
+
+// Reads the samples back out of a chunk, oldest first.
+struct SeriesCursor {
+  const SeriesChunk* chunk;
+  uint16_t position;                                // Samples read so far.
+  uint16_t bits;                                    // Bits of chunk->data read so far.
+  uint32_t time;
+  int32_t value;
+  int64_t timeDelta;
+  int64_t valueDelta;
+};
+
+struct SeriesSample {
+  uint32_t time;                                    // Unix time, in seconds.
+  int32_t value;
+};
+
+// What QuerySeries() and SummariseSeries() pass their chunk visitors.
+struct SeriesQuery {
+  uint32_t from;                                    // The time range queried, inclusive.
+  uint32_t to;
+  SeriesSample* samples;                            // QuerySeries(): where samples in range are written, oldest first.
+  int maxSamples;
+  int count;                                        // Samples written so far.
+  int32_t* lowest;                                  // SummariseSeries(): the range of values in each bucket.
+  int32_t* highest;
+  int buckets;
+};
+
+typedef bool (*SeriesChunkVisitor)(const SeriesChunk&, void*);   // Called with each chunk a query covers, oldest first. Returns false to end the query early.
+
+void InitializeSeries();
+bool RecordSeriesSample(int, const char*);
+bool AddSeriesSample(int, uint32_t, int32_t);
+bool NeedsSeriesSeal(uint32_t, uint32_t);
+uint32_t GetOldestHeldSeriesTime(uint32_t);
+void SealSeriesChunk(int);
+void FlushSeries();
+int QuerySeries(int, uint32_t, uint32_t, SeriesSample*, int);
+int SummariseSeries(int, uint32_t, uint32_t, int32_t*, int32_t*, int);
+int VisitSeriesChunks(int, uint32_t, uint32_t, SeriesChunkVisitor, void*);
+bool QuerySeriesVisitor(const SeriesChunk&, void*);
+bool SummariseSeriesVisitor(const SeriesChunk&, void*);
+int GetSeriesBucket(const SeriesQuery&, uint32_t);
+void ReportSeries();
+bool WriteSeriesSegment();
+bool MakeSeriesRoom(size_t);
+void GetSeriesSegmentPath(char*, int, uint32_t);
+bool ParseSeriesSegmentName(const char*, uint32_t&);
+
+void ResetSeriesEncoder(SeriesEncoder&);
+bool EncodeSeriesSample(SeriesEncoder&, uint32_t, int32_t);
+void BeginSeriesCursor(SeriesCursor&, const SeriesChunk&);
+bool NextSeriesSample(SeriesCursor&, SeriesSample&);
+void WriteSeriesField(uint8_t*, uint16_t&, int64_t, uint32_t, const uint8_t*);
+int64_t ReadSeriesField(const uint8_t*, uint16_t&, const uint8_t*, bool&);
+void WriteSeriesBits(uint8_t*, uint16_t&, uint32_t, int);
+uint32_t ReadSeriesBits(const uint8_t*, uint16_t&, int);
+
+#endif
\ No newline at end of file
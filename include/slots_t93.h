@@ -0,0 +1,17 @@
+#ifndef _T93_LCD_COUNTER_SLOTS_h
+#define _T93_LCD_COUNTER_SLOTS_h
+
+void InitializeSlots();
+int GetSlotCount();
+bool SetSlotCount(int);
+const char* GetSlotLabel(int);
+const char* GetSlotValue(int);
+void SetSlotValue(int, const char*);
+const char* GetSlotSummary(int, int);
+int GetSlotArenaUsed();
+
+bool AddSlot();
+void RemoveSlot();
+bool ResizeArenaEntry(int, int, int);
+
+#endif
\ No newline at end of file
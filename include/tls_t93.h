@@ -0,0 +1,69 @@
+#ifndef _T93_LCD_COUNTER_TLS_h
+#define _T93_LCD_COUNTER_TLS_h
+
+#include <WiFi.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/net_sockets.h"
+
+// A TLS client for the API connection with a smaller memory footprint than WiFiClientSecure.
+// Requests the Max Fragment Length extension so the server sends small records, offers only ECDHE with AES-GCM, and skips
+// certificate verification as the previous setInsecure() did. Where mbedTLS is built with variable length buffers, its
+// record buffers are shrunk to the negotiated fragment length once the handshake completes.
+// Derives from WiFiClient so it can be handed to HTTPClient::begin().
+// A deadline can be set, after which the connection is closed at the next call made on it. HTTPClient then gives up on the
+// request as if the server had closed the connection, rather than waiting out a slow response on its own timeouts.
+class LeanTLSClient : public WiFiClient {
+  public:
+    LeanTLSClient();
+    ~LeanTLSClient();
+
+    int connect(IPAddress, uint16_t);
+    int connect(IPAddress, uint16_t, int32_t);
+    int connect(const char*, uint16_t);
+    int connect(const char*, uint16_t, int32_t);
+    int connect(IPAddress, uint16_t, const char*, int32_t);   // Connects by address, sending host for SNI.
+    bool connectSocket(IPAddress, uint16_t, int32_t);         // The two steps of connect(), for callers timing them separately.
+    bool handshake(const char*);
+    size_t write(uint8_t);
+    size_t write(const uint8_t*, size_t);
+    int available();
+    int read();
+    int read(uint8_t*, size_t);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+
+    size_t heapPeak();
+    void setDeadline(unsigned long);
+    void clearDeadline();
+    bool expired();
+
+  private:
+    bool openSocket(IPAddress, uint16_t, int32_t);
+    int pendingBytes();
+    bool checkDeadline();
+    void sampleHeap();
+
+    static int sendRecord(void*, const unsigned char*, size_t);
+    static int receiveRecord(void*, unsigned char*, size_t);
+
+    mbedtls_ssl_context _ssl;
+    mbedtls_ssl_config _config;
+    mbedtls_ctr_drbg_context _drbg;
+    mbedtls_entropy_context _entropy;
+    mbedtls_net_context _socket;
+    bool _initialized;              // Whether the mbedTLS contexts above hold anything that needs freeing.
+    bool _connected;
+    int _peeked;                    // A byte read ahead by peek(), or -1.
+    size_t _heapAtConnect;          // Free heap before the connection was started, for working out what it has used.
+    size_t _lowestHeap;             // The lowest free heap seen while the connection has been open.
+    unsigned long _deadline;        // The millis() after which the connection is closed, if _hasDeadline.
+    bool _hasDeadline;
+    bool _expired;                  // Whether the connection was closed (or the connection attempt abandoned) for passing the deadline.
+};
+
+#endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define _T93_LCD_COUNTER_WIFI_h
 
 void InitializeWiFi();
+bool ReconnectWiFi();
 void PortalTimeoutCallback();
 bool IsWiFiConnected();
 
@@ -1,185 +1,265 @@
-#include <elapsedMillis.h>
-
 #include "globals_t93.h"
 #include "secrets_t93.h"
 #include "wifi_t93.h"
 #include "lcd_t93.h"
+#include "cache_t93.h"
+#include "slots_t93.h"
+#include "decode_t93.h"
+#include "payload_t93.h"
+#include "net_t93.h"
+#include "fleet_t93.h"
+#include "schedule_t93.h"
+#include "health_t93.h"
+#include "deadline_t93.h"
+#include "log_t93.h"
 #include "api_t93.h"
+#include "profiler_t93.h"
+
+#define LOG_MODULE API
+
+static bool pollNow = false;                        // Whether a refresh has brought the next poll forward to now.
+static bool refreshRequested = false;               // Whether a refresh has been requested and is yet to be displayed.
+static unsigned long refreshRequestedAt = 0;        // When the pending refresh was first requested, later requests are merged into it.
+static uint32_t refreshCount = 0;                   // Refreshes displayed since boot, for the latency figures below.
+static uint32_t refreshesMerged = 0;                // Requests served by a refresh already pending or by a scheduled poll.
+static unsigned long refreshLatencyTotal = 0;       // Milliseconds from request to updated display, summed over refreshCount.
+static unsigned long refreshLatencyMax = 0;
 
 /*
 * Non-blocking check on whether the API needs polling.
-* When the polling interval has been reached, the API will be contacted for a value update.
+* Shortly before the next poll is due (see schedule_t93) the connection is opened ahead of time, then once due the API will be contacted for a value update.
+* In fleet mode only the elected poller contacts the API, the other counters receive its values over multicast (see ProcessFleet()).
+* A requested refresh brings the poll forward (see ProcessRefreshRequest()).
 */
 void ProcessAPIPolling() {
-  static elapsedMillis _apiPollTimer = 30000; // Initialize to a value ready for polling. Static so will retain any updated values between invocations.
+  PROFILE_SECTION(SectionAPIPolling);
+  static bool _prewarmed = false;              // Whether the connection has been opened ahead of the upcoming poll.
 
-  if (_apiPollTimer >= POLL_INTERVAL_SECONDS * 1000) {
-    DEBUG_SERIAL.println("Beginning API polling process");
+  if (refreshRequested) {
+    ProcessRefreshRequest();
+  }
+
+  if (!_prewarmed && GetMillisUntilPoll() <= PREWARM_LEAD_MS && IsWiFiConnected() && IsFleetPoller()) {
+    LOG_INFO("Pre-warming API connection");
+    StartDeadline();
+    PrewarmAPIConnection();
+    EndAPIDeadline();
+    _prewarmed = true;
+  }
+
+  if (IsPollDue() || pollNow) {
+    StartPoll();                               // Schedules the next from when this poll was due rather than when it finished, so polls don't drift.
+    pollNow = false;
+    _prewarmed = false;
+    LOG_INFO("Beginning API polling process");
     if (IsWiFiConnected()) {
-      DEBUG_SERIAL.println("WiFi validated");
-      UpdateValueFromAPI();
+      LOG_DEBUG("WiFi validated");
+      if (IsFleetPoller()) {
+        ReportPollResult(UpdateValueFromAPI());
+        ShareFleetValues();
+      }
+      else if (!HasRecentFleetValues()) {                                  // Values come from the fleet's poller, but it has gone quiet.
+        LOG_WARNING("No recent values from fleet poller");
+        MarkAllValuesFetchFailed();
+        DrawPollIndicator(false);
+        ReportPollResult(false);
+      }
+      else {
+        ReportPollResult(true);
+      }
     }
     else {
-      DEBUG_SERIAL.println("WiFi connection failure");
-      WriteToLCD("WiFi conn lost");
-      strncpy(_currentValue[_selectedValueIndex], "NULL", MAX_VALUE_LENGTH);
-      InitializeWiFi();
+      LOG_WARNING("WiFi connection failure");
+      CloseAPIConnection();
+      MarkAllValuesFetchFailed();
+      DrawPollIndicator(false);                                             // The cached value stays on display, marked stale.
+      if (ReconnectWiFi()) {
+        ReportHeartbeat(HeartbeatPoller);                                   // Not counted as a failure, the API may be fine.
+      }
+      else {
+        ReportPollResult(false);                                            // Counted so recovery escalates. The restart it ends with opens the config portal if the network has gone for good.
+      }
     }
 
-    _apiPollTimer = 0;
+    if (refreshRequested) {
+      CompleteRefresh();
+    }
   }
 }
 
 /*
-* Polls the API for updated values to store in the _currentValues array.
-* Response is validated, transformed and split based on the | operator.
-* Booleans indicating which values have changed since the previous request are stored in _currentValueUpdated.
+* Requests the values be refreshed as soon as possible. Requests made while one is pending are merged into it.
 */
-void UpdateValueFromAPI() {
-  _lcd.setCursor(15, 1); // Little dot in bottom right section shows API being polled.
-  _lcd.print(".");
+void RequestRefresh() {
+  if (refreshRequested) {
+    LOG_DEBUG("Refresh already pending, merging request");
+    refreshesMerged++;
+    return;
+  }
+
+  LOG_INFO("Refresh requested");
+  refreshRequested = true;
+  refreshRequestedAt = millis();
+}
 
+/*
+* Decides how a pending refresh is served. Normally the next poll is brought forward to now, and the slot after it skipped if it would
+* follow too closely (see StartPoll()), so the API doesn't receive the refresh and a scheduled poll back to back.
+* Refreshes within REFRESH_COALESCE_MS of the last poll are served by its values, and those within REFRESH_COALESCE_MS of the next are left for it to serve.
+* Without WiFi or as a fleet peer no request can be made, the values already held are shown instead.
+*/
+void ProcessRefreshRequest() {
+  if (!IsWiFiConnected() || !IsFleetPoller()) {                            // Reconnecting is left to the scheduled poll, and fleet peers are sent values by the poller.
+    LOG_INFO("Unable to refresh now, showing values held");
+    CompleteRefresh();
+  }
+  else if (GetMillisSincePoll() < REFRESH_COALESCE_MS) {
+    LOG_INFO("Values polled %lu ms ago, merging refresh", GetMillisSincePoll());
+    refreshesMerged++;
+    CompleteRefresh();
+  }
+  else if (GetMillisUntilPoll() <= REFRESH_COALESCE_MS) {
+    // Left pending, the scheduled poll about to be made serves it.
+  }
+  else {
+    LOG_INFO("Bringing poll forward by %lu ms", GetMillisUntilPoll());
+    pollNow = true;
+  }
+}
+
+/*
+* Shows the selected value in place of the refresh message and records how long the refresh took to display.
+*/
+void CompleteRefresh() {
+  ProcessDisplayValueUpdate(true);
+  unsigned long latency = millis() - refreshRequestedAt;
+  refreshRequested = false;
+  refreshCount++;
+  refreshLatencyTotal += latency;
+  refreshLatencyMax = max(refreshLatencyMax, latency);
+  LOG_INFO("Refresh displayed %lu ms after request (mean %lu ms, max %lu ms over %u refreshes, %u requests merged)",
+    latency, refreshLatencyTotal / refreshCount, refreshLatencyMax, refreshCount, refreshesMerged);
+}
+
+/*
+* Polls the API for updated values to store in the value slots, one slot per value returned.
+* Compressed (gzip/deflate) responses are inflated as they stream in. The decoded response is validated, transformed and split based on the | operator.
+* Booleans indicating which values have changed since the previous request are stored in _currentValueUpdated.
+* On failure, including any response other than a 200, the previous values remain on display, marked stale, until they expire (see MarkValueFetchFailed()).
+* The poll as a whole gets POLL_BUDGET_MS, shared between its phases (see deadline_t93). A phase that overruns abandons the poll, as a failure.
+* Returns true if values were fetched with a 200 response.
+*/
+bool UpdateValueFromAPI() {
   static char responseBuffer[RESPONSE_BUFFER_SIZE];                        // For manipulating the response from the API.
+  static const char* collectedHeaders[] = { "Content-Encoding" };
 
-  WiFiClientSecure client;
-  HTTPClient https;
+  StartDeadline();
+  if (!PrewarmAPIConnection()) {                                           // Normally already connected ahead of time by ProcessAPIPolling(). Connects now if not.
+    MarkAllValuesFetchFailed();
+    DrawPollIndicator(false);                                               // Refresh the stale indicator.
+    EndAPIDeadline();
+    return false;
+  }
 
-  client.setInsecure();                                                     // The endpoint being hit is an https endpoint, but it doesn't require certs etc.
-  https.begin(client, SECRET_API_ENDPOINT);
+  BeginAPIPhase(PhaseHeaders);
+  HTTPClient https;
+  https.begin(GetAPIClient(), GetAPIHost(), GetAPIPort(), GetAPIPath(), true);   // HTTPClient reuses the already open connection.
+  https.setConnectTimeout(GetPhaseRemaining());                             // Only used should HTTPClient find the connection closed and reconnect itself.
+  https.setTimeout(GetPhaseRemaining());                                    // The API client closes the connection at the deadline regardless.
   https.addHeader("X-API-KEY", SECRET_API_KEY);                             // Using X-API-KEY header as auth function on endpoint.
+  https.useHTTP10(true);                                                    // HTTP/1.1 requests carry a fixed Accept-Encoding that refuses compression.
+  https.addHeader("Accept-Encoding", "gzip, deflate");
+  https.collectHeaders(collectedHeaders, LEN(collectedHeaders));
 
-  DEBUG_SERIAL.println("Submitting request");
+  DrawPollIndicator(true);                                                  // Little dot in bottom right section shows API being polled.
+  LOG_DEBUG("Submitting request");
   int httpResponseCode = https.GET();
-  DEBUG_SERIAL.print("Response code: ");
-  DEBUG_SERIAL.println(httpResponseCode);
+  LOG_INFO("Response code: %d", httpResponseCode);
 
-  if (httpResponseCode > 0) {
-    String response = https.getString();                                    // Pulls the response out, unfortunately uses String, but using .getStream() was proving to be riskier depending on how the API returns the payload, headers, chunking etc.
+  if (GetAPIClient().expired()) {                                           // The connection was closed part way through the headers.
+    RecordPhaseOverrun();
+    MarkAllValuesFetchFailed();
+    https.end();
+    DrawPollIndicator(false);
+    EndAPIDeadline();
+    return false;
+  }
 
-    if (response.length() >= RESPONSE_BUFFER_SIZE) {                       // Ensures the response isn't too large to fit in the buffer.
-      DEBUG_SERIAL.println("Response too large for buffer!");
-      WriteToLCD("API response", "too large");
-      for (int i = 0; i < API_VALUE_COUNT; i++) {
-        strncpy(_currentValue[i], "Unknown", MAX_VALUE_LENGTH);             // Triggers an error on the LCD.
-      }
-      response.clear();
-      https.end();
-      _lcd.setCursor(15, 1);
-      _lcd.print(" ");
-      return;
+  if (httpResponseCode == HTTP_CODE_OK) {                                   // Only a 200's body holds values, error pages must not replace those held.
+    BeginAPIPhase(PhaseBody);
+    PayloadDecoder decoder(responseBuffer, RESPONSE_BUFFER_SIZE);          // Decodes straight into responseBuffer as the body arrives. writeToStream() handles content length and chunking.
+    bool decoded = decoder.begin(ParseContentEncoding(https.header("Content-Encoding").c_str()), https.getSize());
+    if (decoded) {
+      https.writeToStream(&decoder);                                        // Stops reading early if the body turns out to be too large, or at the deadline.
+      decoded = decoder.finish();
     }
 
-    strncpy(responseBuffer, response.c_str(), RESPONSE_BUFFER_SIZE - 1);   // Copy string content to responseBuffer. Doing this means we can immediately dispose of the String variable.
-    responseBuffer[RESPONSE_BUFFER_SIZE - 1] = '\0';                       // Ensure null termination
-    response.clear();
-    
-    RemoveAsteriskNotation(responseBuffer);                                 // Removes the * used to inform the 7-seg display which value to display. Unused on LCD units.
-    bool validResponse = ValidatePayloadFormat(responseBuffer);             // Ensures there are at least as many values as API_VALUE_COUNT.
+    if (GetAPIClient().expired()) {                                         // A slow body, the part received may look complete but can't be trusted.
+      RecordPhaseOverrun();
+      MarkAllValuesFetchFailed();
+      https.end();
+      DrawPollIndicator(false);
+      EndAPIDeadline();
+      return false;
+    }
 
-    if (!validResponse) {
-      DEBUG_SERIAL.println("Invalid API response");
-      WriteToLCD("Invalid API", "response");
-      for (int i = 0; i < API_VALUE_COUNT; i++) {
-        strncpy(_currentValue[i], "Unknown", MAX_VALUE_LENGTH);             // Triggers an error on the LCD.
-      }
+    if (decoder.overflowed()) {                                             // Ensures the response isn't too large to fit in the buffer.
+      LOG_WARNING("Response too large for buffer!");
+      MarkAllValuesFetchFailed();
       https.end();
-      _lcd.setCursor(15, 1);
-      _lcd.print(" ");
-      return;
+      DrawPollIndicator(false);
+      EndAPIDeadline();
+      return false;
     }
 
-    char* token = strtok(responseBuffer, "|");                              // Gets the first token (the first value in the string prior to the first '|' operator).
-    int index = 0;
+    if (!decoded) {
+      LOG_WARNING("Unable to decode API response");
+      MarkAllValuesFetchFailed();
+      https.end();
+      DrawPollIndicator(false);
+      EndAPIDeadline();
+      return false;
+    }
 
-    while (token != nullptr && index < API_VALUE_COUNT) {                   // While there are values to be read (ValidatePayloadFormat() should have handled this) and haven't read all the values expected...
-      if (strcmp(_currentValue[index], token) != 0) {                       // If the value differs from what we currently have stored...
-        _currentValueUpdated[index] = true;                                 // Mark as updated.
-        strncpy(_currentValue[index], token, MAX_VALUE_LENGTH);             // Copy the new value into the _currentValue array for eventual displaying.
-        _currentValue[index][MAX_VALUE_LENGTH - 1] = '\0';                  // Ensure null termination
+    RemoveAsteriskNotation(responseBuffer);                                 // Removes the * used to inform the 7-seg display which value to display. Unused on LCD units.
+    bool validResponse = ValidatePayloadFormat(responseBuffer);             // Ensures there is at least one value, and nothing that isn't text.
 
-        DEBUG_SERIAL.print("Got new value: ");
-        DEBUG_SERIAL.print(token);
-        DEBUG_SERIAL.print(" for index ");
-        DEBUG_SERIAL.println(index);
-      }
-      else {
-        _currentValueUpdated[index] = false;                                // No change detected for this stat.
+    if (!validResponse) {
+      LOG_WARNING("Invalid API response");
+      MarkAllValuesFetchFailed();
+      https.end();
+      DrawPollIndicator(false);
+      EndAPIDeadline();
+      return false;
+    }
 
-        DEBUG_SERIAL.print("Polled API and received same value as previously (");
-        DEBUG_SERIAL.print(token);
-        DEBUG_SERIAL.print(") for index ");
-        DEBUG_SERIAL.println(index);
-      }
+    char* values[MAX_VALUE_SLOTS];
+    int valueCount = SplitPayloadValues(responseBuffer, values, MAX_VALUE_SLOTS);
+    if (!AcceptPayloadValueCount(valueCount)) {                             // A change in the number of values is only believed once it repeats.
+      MarkAllValuesFetchFailed();
+      https.end();
+      DrawPollIndicator(false);
+      EndAPIDeadline();
+      return false;
+    }
+    SetSlotCount(valueCount);                                               // There is a slot for each value the API returned, up to MAX_VALUE_SLOTS.
 
-      token = strtok(nullptr, "|");                                         // Get the next token/value
-      index++;
+    for (int index = 0; index < GetSlotCount(); index++) {                  // For each value read from the payload...
+      StoreFetchedValue(index, values[index]);
     }
   }
+  else if (httpResponseCode > 0) {
+    LOG_WARNING("API returned %d, keeping values held", httpResponseCode);
+    MarkAllValuesFetchFailed();
+  }
   else {
-    DEBUG_SERIAL.println("Unable to contact API");                          // In the event WiFi is connected but the API is unreachable
-    WriteToLCD("Unable to", "contact API");
-    for (int i = 0; i < API_VALUE_COUNT; i++) {
-      strncpy(_currentValue[i], "Unknown", MAX_VALUE_LENGTH);
-    }
+    LOG_WARNING("Unable to contact API");                                   // In the event WiFi is connected but the API is unreachable
+    MarkAllValuesFetchFailed();
   }
 
   https.end();
+  EndAPIDeadline();
 
-  _lcd.setCursor(15, 1);
-  _lcd.print(" ");
-}
-
-/*
-* Iterates across the payload from the API and removes the first instance of the '*' character.
-* This character is returned by the API for use in another project but isn't relevant here.
-*/
-void RemoveAsteriskNotation(char* buffer) {
-  DEBUG_SERIAL.println("Stripping asterisk notation");
-  for (int i = 0; i < RESPONSE_BUFFER_SIZE; i++) {           // For each index in the buffer array...
-    if (buffer[i] == '\0') {                                  // If the end of the string is reached then exit.
-      DEBUG_SERIAL.println("End of string located prior to asterisk");
-      return;
-    }
-    if (buffer[i] == '*') {                                   // Once the '*' is found...
-      DEBUG_SERIAL.print("Asterisk located at buffer index ");
-      DEBUG_SERIAL.println(i);
-      for (int j = i; j < RESPONSE_BUFFER_SIZE - 1; j++) {   // Starting at the current index, work along the string and shift all characters left, overwriting the '*'.
-        buffer[j] = buffer[j + 1];
-        if (buffer[j] == '\0') {                              // If the end of the string has been reached then return.
-          DEBUG_SERIAL.println("End of string located within buffer");
-
-          DEBUG_SERIAL.print("responseBuffer contains: ");
-          DEBUG_SERIAL.println(buffer);
-
-          return;
-        }
-      }
-      buffer[RESPONSE_BUFFER_SIZE - 1] = '\0';               // Otherwise, if the end of the array is reached (minus the removed '*') terminate the string and return.
-      DEBUG_SERIAL.println("End of buffer reached before string termination character. This should never happen");
-      return;
-    }
-  }
-}
-
-/*
-* Iterates across the payload from the API. Validates there are enough pipe delimiters for there to be at least as many values from the API as expected in API_VALUE_COUNT.
-*/
-bool ValidatePayloadFormat(char* buffer) {
-  DEBUG_SERIAL.println("Validating resulting payload format for sufficient API values");
-  int pipeCount = 0;
-  for (int i= 0; i < RESPONSE_BUFFER_SIZE; i++) {    // For each character in the buffer...
-    if (buffer[i] == '\0') {                          // If the end of the buffer is reached without returning true, there weren't enough values in the payload.
-      DEBUG_SERIAL.println("Insufficient values located in responseBuffer");
-      return false;
-    }
-    if (buffer[i] == '|') {                           // If pipe delimiter found, there is a value preceeding it.
-      pipeCount++;
-    }
-    if (pipeCount == API_VALUE_COUNT - 1) {           // There is one less pipe delimiter than there are values. Finding this many means enough values have been located.
-      DEBUG_SERIAL.println("Payload passed validation");
-      return true;
-    }
-  }
-  DEBUG_SERIAL.println("End of response buffer reached without sufficient values being located");
-  return false;
-}
+  DrawPollIndicator(false);
+  return httpResponseCode == HTTP_CODE_OK;
+}
\ No newline at end of file
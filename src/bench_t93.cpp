@@ -0,0 +1,391 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+#include "payload_t93.h"
+#include "series_t93.h"
+#include "log_t93.h"
+#include "bench_t93.h"
+
+#define LOG_MODULE BENCH
+
+// The value counts and value lengths payloads are generated with. Combined with each asterisk position these give payloads from a few bytes up to BENCH_MAX_PAYLOAD.
+const int benchValueCounts[] = { 1, 3, 8, 16, 32, 48, 64 };
+const int benchValueLengths[] = { 3, 7, 15 };
+const char* benchAsteriskNames[] = { "none", "first", "last" };
+const char* benchSeriesNames[] = { "flat", "steady", "noisy", "irregular" };
+
+/*
+* Runs each payload pipeline over the generated payloads and logs the timings.
+* To compare a replacement parser against the current one, add a BenchmarkPipeline() call for it here.
+*/
+void RunPayloadBenchmark() {
+  LOG_REPORT("Payload pipeline benchmark");
+  LOG_REPORT("CPU: %u MHz, iterations per payload: %d", getCpuFreqMHz(), BENCH_ITERATIONS);
+  if (LOG_LEVEL_PAYLOAD >= LogDebug) {
+    LOG_REPORT("LOG_LEVEL_PAYLOAD is LogDebug, timings include capturing log records");
+  }
+
+  BenchmarkPipeline("baseline", BaselinePayloadPipeline);
+
+  LOG_REPORT("Payload pipeline benchmark complete");
+  FlushLog(1000);
+}
+
+/*
+* Times a single pipeline across every combination of value count, value length and asterisk position.
+* Reports ns/byte and ns/payload, along with heap bytes and blocks still allocated afterwards, the most heap held at once and any growth in stack usage.
+* On the ESP32 the heap's low water mark is kept since boot, so peak heap only shows a pipeline that takes the heap lower than ever before.
+* The native build's low water mark restarts with each measurement, giving the exact peak (see test/test_bench).
+*/
+void BenchmarkPipeline(const char* name, PayloadPipeline pipeline) {
+  static char payload[BENCH_MAX_PAYLOAD];                                   // Static so the buffers don't count towards the stack measurements.
+  static char workBuffer[BENCH_MAX_PAYLOAD];
+  static char* values[BENCH_MAX_PAYLOAD / 2];                               // Worst case payload is a single character per value.
+
+  LOG_REPORT("Pipeline: %s", name);
+  LOG_REPORT("values len asterisk bytes result   ns/byte  ns/payload heap bytes heap blocks peak heap stack");
+
+  for (int c = 0; c < LEN(benchValueCounts); c++) {
+    for (int l = 0; l < LEN(benchValueLengths); l++) {
+      for (int a = AsteriskAbsent; a <= AsteriskLast; a++) {
+        int payloadLength = GenerateBenchPayload(payload, benchValueCounts[c], benchValueLengths[l], static_cast<BenchAsteriskPosition>(a));
+        if (payloadLength < 0) {                                            // Combination doesn't fit in the bench buffer, skip it.
+          continue;
+        }
+
+        multi_heap_info_t heapBefore;
+        multi_heap_info_t heapAfter;
+        heap_caps_get_info(&heapBefore, MALLOC_CAP_DEFAULT);
+        UBaseType_t stackBefore = uxTaskGetStackHighWaterMark(nullptr);
+
+        uint64_t totalCycles = 0;
+        int result = 0;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+          memcpy(workBuffer, payload, payloadLength + 1);                   // Pipelines modify the buffer in place so it is restored each iteration. The copy isn't timed.
+          uint32_t start = ESP.getCycleCount();
+          result = pipeline(workBuffer, values, LEN(values));
+          totalCycles += ESP.getCycleCount() - start;
+        }
+
+        heap_caps_get_info(&heapAfter, MALLOC_CAP_DEFAULT);
+        UBaseType_t stackAfter = uxTaskGetStackHighWaterMark(nullptr);
+
+        double nsPerPayload = (double) totalCycles * 1000.0 / getCpuFreqMHz() / BENCH_ITERATIONS;
+        char combination[LOG_TEXT_SIZE];                                    // Formatted up front, as the row has more columns than a record has arguments.
+        snprintf(combination, sizeof(combination), "%6d %3d %8s %5d %6d",
+          benchValueCounts[c], benchValueLengths[l], benchAsteriskNames[a], payloadLength, result);
+        LOG_REPORT(
+          "%s %9.2f %11.0f %10d %11d %9d %5u",
+          combination,
+          nsPerPayload / payloadLength,
+          nsPerPayload,
+          (int) heapBefore.total_free_bytes - (int) heapAfter.total_free_bytes,
+          (int) heapAfter.allocated_blocks - (int) heapBefore.allocated_blocks,
+          max((int) heapBefore.total_free_bytes - (int) heapAfter.minimum_free_bytes, 0),
+          (unsigned int) (stackBefore - stackAfter)                         // High water mark is the least free stack ever seen, so this is how much deeper the pipeline reached.
+        );
+        FlushLog(1000);                                                     // Written out before the next timing starts, and never more than the ring holds.
+      }
+    }
+  }
+}
+
+/*
+* Fills the buffer with a pipe delimited payload of valueCount values, each valueLength digits long.
+* The asterisk notation is placed before the first or last value as requested.
+* Returns the length of the payload, or -1 if it would not fit within BENCH_MAX_PAYLOAD.
+*/
+int GenerateBenchPayload(char* buffer, int valueCount, int valueLength, BenchAsteriskPosition asterisk) {
+  int size = valueCount * (valueLength + 1) - 1 + (asterisk == AsteriskAbsent ? 0 : 1);
+  if (size >= BENCH_MAX_PAYLOAD) {
+    return -1;
+  }
+
+  int position = 0;
+  for (int value = 0; value < valueCount; value++) {
+    if (value > 0) {
+      buffer[position++] = '|';
+    }
+    if ((asterisk == AsteriskFirst && value == 0) || (asterisk == AsteriskLast && value == valueCount - 1)) {
+      buffer[position++] = '*';
+    }
+    for (int digit = 0; digit < valueLength; digit++) {
+      buffer[position++] = '0' + ((value + digit) % 10);
+    }
+  }
+  buffer[position] = '\0';
+  return position;
+}
+
+/*
+* The pipeline UpdateValueFromAPI() currently runs a response through.
+* Oversized payloads are rejected as they would be before reaching the response buffer, and only MAX_VALUE_SLOTS values are split out.
+*/
+int BaselinePayloadPipeline(char* buffer, char** values, int maxValues) {
+  if (strnlen(buffer, RESPONSE_BUFFER_SIZE) >= RESPONSE_BUFFER_SIZE) {
+    return -1;
+  }
+
+  RemoveAsteriskNotation(buffer);
+  if (!ValidatePayloadFormat(buffer)) {
+    return -1;
+  }
+  return SplitPayloadValues(buffer, values, min(maxValues, MAX_VALUE_SLOTS));
+}
+
+/*
+* Encodes each generated series as the series store would and logs what it takes to store and the cost per sample in RAM.
+* The encoding doesn't touch the hardware, so this runs on the host (see test/test_bench). RunSeriesBenchmark() times the flash on the ESP32.
+*/
+void RunSeriesEncodingBenchmark() {
+  LOG_REPORT("Series encoding benchmark");
+  LOG_REPORT("CPU: %u MHz, samples per series: %d, chunk size: %d bytes, sealed after: %d minutes", getCpuFreqMHz(), SERIES_BENCH_SAMPLES, SERIES_CHUNK_SIZE, SERIES_SEAL_MINUTES);
+  LOG_REPORT("series    chunks files  bits/sample flash B/sample encode ns/sample decode ns/sample check");
+
+  for (int p = SeriesFlat; p <= SeriesIrregular; p++) {
+    BenchmarkSeriesEncoding(static_cast<BenchSeriesPattern>(p));
+  }
+
+  LOG_REPORT("Series encoding benchmark complete");
+  FlushLog(1000);
+}
+
+/*
+* Decodes the chunks of a generated series back and checks they match what was generated.
+* Bits per sample counts what's encoded, including chunk headers. Flash bytes per sample counts whole chunks, as written, so includes
+* the unused end of those sealed early by SERIES_SEAL_MINUTES.
+*/
+void BenchmarkSeriesEncoding(BenchSeriesPattern pattern) {
+  BenchSeries series;
+  if (!EncodeBenchSeries(pattern, series)) {
+    LOG_REPORT("%-9s unable to encode in %d chunks", benchSeriesNames[pattern], series.maxChunks);
+    FreeBenchSeries(series);
+    return;
+  }
+
+  uint32_t seed = 93;
+  uint32_t time = SERIES_BENCH_START;
+  int32_t value = 1000;
+  int decoded = 0;
+  int mismatches = 0;
+  uint64_t decodeCycles = 0;
+  for (int c = 0; c < series.chunkCount; c++) {
+    SeriesCursor cursor;
+    SeriesSample sample;
+    uint32_t start = ESP.getCycleCount();
+    BeginSeriesCursor(cursor, series.chunks[c]);
+    while (NextSeriesSample(cursor, sample)) {
+      decodeCycles += ESP.getCycleCount() - start;
+      GenerateBenchSample(pattern, seed, time, value);                      // Not timed.
+      mismatches += sample.time != time || sample.value != value ? 1 : 0;
+      decoded++;
+      start = ESP.getCycleCount();
+    }
+    decodeCycles += ESP.getCycleCount() - start;
+  }
+
+  char row[LOG_TEXT_SIZE];                                                  // Formatted up front, as the row has more columns than a record has arguments.
+  snprintf(row, sizeof(row), "%-9s %6d %5d", benchSeriesNames[pattern], series.chunkCount, series.fileCount);
+  LOG_REPORT(
+    "%s %12.2f %14.2f %16.0f %16.0f %s",
+    row,
+    (double) series.encodedBits / SERIES_BENCH_SAMPLES,
+    (double) series.chunkCount * SERIES_CHUNK_SIZE / SERIES_BENCH_SAMPLES,
+    (double) series.encodeCycles * 1000.0 / getCpuFreqMHz() / SERIES_BENCH_SAMPLES,
+    (double) decodeCycles * 1000.0 / getCpuFreqMHz() / SERIES_BENCH_SAMPLES,
+    mismatches == 0 && decoded == SERIES_BENCH_SAMPLES ? "ok" : "MISMATCH"
+  );
+  FlushLog(1000);
+  FreeBenchSeries(series);
+}
+
+/*
+* Writes each generated series to the LittleFS partition as the series store would, a file at a time, and reads it back as a query over
+* the lot would. Logs how long the writes took and how fast the samples were read back. The encoding isn't timed, see RunSeriesEncodingBenchmark().
+*/
+void RunSeriesBenchmark() {
+  LOG_REPORT("Series store benchmark");
+  LOG_REPORT("Samples per series: %d, chunk size: %d bytes, chunks per file: %d, sealed after: %d minutes", SERIES_BENCH_SAMPLES, SERIES_CHUNK_SIZE, SERIES_SEGMENT_CHUNKS, SERIES_SEAL_MINUTES);
+  if (!LittleFS.begin(true)) {
+    LOG_REPORT("Unable to mount LittleFS, series store benchmark skipped");
+    return;
+  }
+  LOG_REPORT("series    chunks files flash B/sample write ms ms/file query samples/s check");
+
+  for (int p = SeriesFlat; p <= SeriesIrregular; p++) {
+    BenchmarkSeriesFlash(static_cast<BenchSeriesPattern>(p));
+  }
+
+  LOG_REPORT("Series store benchmark complete");
+  FlushLog(1000);
+}
+
+/*
+* Times writing a generated series' files, each in a single write as WriteSeriesSegment() does, then reading and decoding them all back.
+*/
+void BenchmarkSeriesFlash(BenchSeriesPattern pattern) {
+  static SeriesChunk fileChunk;                                             // Static so the buffer doesn't count towards the stack.
+  BenchSeries series;
+  if (!EncodeBenchSeries(pattern, series)) {
+    LOG_REPORT("%-9s unable to encode in %d chunks", benchSeriesNames[pattern], series.maxChunks);
+    FreeBenchSeries(series);
+    return;
+  }
+
+  char path[32];
+  int written = 0;
+  unsigned long started = millis();
+  for (int f = 0; f < series.fileCount; f++) {
+    int first = f == 0 ? 0 : series.fileEnds[f - 1];
+    size_t size = (series.fileEnds[f] - first) * sizeof(SeriesChunk);
+    snprintf(path, sizeof(path), "%s-%d", SERIES_BENCH_PATH, f);
+    File file = LittleFS.open(path, FILE_WRITE);
+    bool complete = file && file.write((const uint8_t*) &series.chunks[first], size) == size;
+    file.close();
+    if (!complete) {
+      break;
+    }
+    written++;
+  }
+  unsigned long writeMillis = millis() - started;
+
+  int samplesRead = 0;
+  unsigned long querySamplesPerSecond = 0;
+  if (written == series.fileCount) {
+    started = micros();
+    for (int f = 0; f < series.fileCount; f++) {
+      snprintf(path, sizeof(path), "%s-%d", SERIES_BENCH_PATH, f);
+      File file = LittleFS.open(path, FILE_READ);
+      while (file.read((uint8_t*) &fileChunk, sizeof(fileChunk)) == sizeof(fileChunk)) {
+        SeriesCursor cursor;
+        SeriesSample sample;
+        BeginSeriesCursor(cursor, fileChunk);
+        while (NextSeriesSample(cursor, sample)) {
+          samplesRead++;
+        }
+      }
+      file.close();
+    }
+    unsigned long elapsed = max(micros() - started, 1UL);
+    querySamplesPerSecond = (uint64_t) samplesRead * 1000000 / elapsed;
+  }
+  for (int f = 0; f < written; f++) {
+    snprintf(path, sizeof(path), "%s-%d", SERIES_BENCH_PATH, f);
+    LittleFS.remove(path);
+  }
+
+  char row[LOG_TEXT_SIZE];                                                  // Formatted up front, as the row has more columns than a record has arguments.
+  snprintf(row, sizeof(row), "%-9s %6d %5d", benchSeriesNames[pattern], series.chunkCount, series.fileCount);
+  LOG_REPORT(
+    "%s %14.2f %8u %7.1f %15u %s",
+    row,
+    (double) series.chunkCount * SERIES_CHUNK_SIZE / SERIES_BENCH_SAMPLES,
+    (unsigned int) writeMillis,
+    (double) writeMillis / max(written, 1),
+    (unsigned int) querySamplesPerSecond,
+    written < series.fileCount ? "WRITE FAILED" : samplesRead == SERIES_BENCH_SAMPLES ? "ok" : "MISMATCH"
+  );
+  FlushLog(1000);
+  FreeBenchSeries(series);
+}
+
+/*
+* Encodes SERIES_BENCH_SAMPLES of the given pattern into chunks as the series store would for a single slot: a chunk is sealed once full,
+* and everything held is written once the oldest sample has waited SERIES_SEAL_MINUTES (see NeedsSeriesSeal()). Where the store would have
+* written each file is kept in fileEnds. Returns false if the series needed more than maxChunks. Free the chunks with FreeBenchSeries().
+*/
+bool EncodeBenchSeries(BenchSeriesPattern pattern, BenchSeries& series) {
+  static SeriesEncoder encoder;                                             // Static so the buffers don't count towards the stack measurements.
+  int sealings = (uint64_t) SERIES_BENCH_SAMPLES * SERIES_SAMPLE_SECONDS * 2 / (SERIES_SEAL_MINUTES * 60UL);   // Chunks sealed early, allowing twice the span of a series on schedule for gaps.
+  int maxChunks = SERIES_BENCH_SAMPLES / (sizeof(SeriesChunk::data) * 8 / 72) + sealings + 2;   // Enough should every sample need its time and value written raw.
+  series = { nullptr, nullptr, maxChunks, 0, 0, 0, 0 };
+  series.chunks = (SeriesChunk*) malloc(series.maxChunks * sizeof(SeriesChunk));
+  series.fileEnds = (int*) malloc(series.maxChunks * sizeof(int));
+  if (series.chunks == nullptr || series.fileEnds == nullptr) {
+    return false;
+  }
+
+  uint32_t seed = 93;
+  uint32_t time = SERIES_BENCH_START;
+  int32_t value = 1000;
+  int fileStart = 0;                                                        // The first chunk of the file being gathered.
+  ResetSeriesEncoder(encoder);
+  for (int i = 0; i < SERIES_BENCH_SAMPLES; i++) {
+    GenerateBenchSample(pattern, seed, time, value);
+    uint32_t start = ESP.getCycleCount();
+    if (!EncodeSeriesSample(encoder, time, value)) {
+      if (!SealBenchChunk(series, encoder)) {
+        return false;
+      }
+      EncodeSeriesSample(encoder, time, value);
+      if (series.chunkCount - fileStart == SERIES_SEGMENT_CHUNKS) {
+        series.fileEnds[series.fileCount++] = fileStart = series.chunkCount;
+      }
+    }
+    uint32_t oldest = fileStart < series.chunkCount ? series.chunks[fileStart].header.firstTime : encoder.chunk.header.firstTime;
+    if (NeedsSeriesSeal(oldest, time)) {
+      if (!SealBenchChunk(series, encoder)) {
+        return false;
+      }
+      series.fileEnds[series.fileCount++] = fileStart = series.chunkCount;
+    }
+    series.encodeCycles += ESP.getCycleCount() - start;
+  }
+
+  if (encoder.chunk.header.count > 0 && !SealBenchChunk(series, encoder)) {   // Then the rest, as FlushSeries() would.
+    return false;
+  }
+  if (fileStart < series.chunkCount) {
+    series.fileEnds[series.fileCount++] = series.chunkCount;
+  }
+  return true;
+}
+
+/*
+* Adds the encoder's chunk to the series and starts a new one. Returns false if the series has no room for it.
+*/
+bool SealBenchChunk(BenchSeries& series, SeriesEncoder& encoder) {
+  if (series.chunkCount == series.maxChunks) {
+    return false;
+  }
+  series.chunks[series.chunkCount++] = encoder.chunk;
+  series.encodedBits += encoder.bits + sizeof(SeriesChunkHeader) * 8;
+  ResetSeriesEncoder(encoder);
+  return true;
+}
+
+void FreeBenchSeries(BenchSeries& series) {
+  free(series.chunks);
+  free(series.fileEnds);
+  series.chunks = nullptr;
+  series.fileEnds = nullptr;
+}
+
+/*
+* Steps the time and value to the pattern's next sample. Seed is the state of the xorshift generator used, so the same seed gives the same series.
+*/
+void GenerateBenchSample(BenchSeriesPattern pattern, uint32_t& seed, uint32_t& time, int32_t& value) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+
+  switch (pattern) {
+    case SeriesFlat:
+      time += SERIES_SAMPLE_SECONDS;
+      break;
+    case SeriesSteady:
+      time += SERIES_SAMPLE_SECONDS - 1 + seed % 3;
+      value += 120 + (int32_t) (seed >> 8) % 7 - 3;
+      break;
+    case SeriesNoisy:
+      time += SERIES_SAMPLE_SECONDS;
+      value += (seed >> 8) % 2000;
+      break;
+    default:
+      time += seed % 200 == 0 ? 3600 + (seed >> 8) % 7200 : SERIES_SAMPLE_SECONDS;
+      value += seed % 50 == 0 ? (int32_t) ((seed >> 8) % 100000) - 50000 : 0;
+      break;
+  }
+}
\ No newline at end of file
@@ -7,20 +7,27 @@
 #include "ldr_t93.h"
 #include "eeprom_t93.h"
 #include "enums_t93.h"
+#include "log_t93.h"
 #include "buttons_t93.h"
+#include "slots_t93.h"
+#include "api_t93.h"
+#include "profiler_t93.h"
+
+#define LOG_MODULE BUTTONS
 
 /*
 * Configures pinMode etc for the various button pins.
 */
 void InitializeButtons() {
-  DEBUG_SERIAL.println("Initializing buttons");
+  LOG_INFO("Initializing buttons");
   pinMode(BTN_1_PIN, INPUT);
   pinMode(BTN_2_PIN, INPUT);
 
-  DEBUG_SERIAL.println("Buttons initialized");
+  LOG_INFO("Buttons initialized");
 }
 
 void ProcessButtons() {
+  PROFILE_SECTION(SectionButtons);
   static const int delayBeforeReturn = 3000;    // How long to remain in the button cycling view after no button change before returning back to the caller.
 
   bool buttonOneQuickPressed = false;           // Whether button one was quick pressed during this invocation. If so, loop won't return immediately, but wait for the delay and button one quick press final actions.
@@ -75,7 +82,7 @@ void ProcessButtons() {
       buttonOnePostHoldPressComplete = true;
     }
 
-    if (buttonTwoQuickPressed && buttonTwoLastChanged > delayBeforeReturn) {
+    if (buttonTwoQuickPressed && !buttonTwoPostQuickPressComplete) {        // No delay, the refresh is made from the loop so it can't begin until this returns.
       ButtonTwoPostQuickPressRelease();
       buttonTwoPostQuickPressComplete = true;
     }
@@ -113,12 +120,12 @@ ButtonActionResult CheckButtonOneState() {
 
   bool currentButtonState = digitalRead(BTN_1_PIN);                       // Debounce button. Each change in state vs the previous invocation restarts the timer.
   if (currentButtonState != previousState) {
-    DEBUG_SERIAL.println("Button 1 state change detected");
+    LOG_DEBUG("Button 1 state change detected");
     debounceTimer = 0;
   }
 
   if (debounceTimer >= debounceDelay && currentButtonState == HIGH) {     // Button has passed the debounce check and is being pressed. Begin the timer to determine how long it's been held for.
-    DEBUG_SERIAL.println("Button 1 stable HIGH");
+    LOG_DEBUG("Button 1 stable HIGH");
     if (!buttonHigh) {
       buttonHighTimer = 0;                                                // Don't want to reset the timer the whole time the button is being held, only the first time it moves from unpressed to pressed.
       buttonHigh = true;
@@ -131,15 +138,15 @@ ButtonActionResult CheckButtonOneState() {
     currentButtonState == LOW &&
     buttonHigh
   ) {
-    DEBUG_SERIAL.println("Button 1 stable LOW");
+    LOG_DEBUG("Button 1 stable LOW");
 
     if (buttonHighTimer >= minimumTimeForHold) {                          // If the button was high long enough to consider it held, return that information.
-      DEBUG_SERIAL.println("Button 1 held");
+      LOG_DEBUG("Button 1 held");
       buttonHigh = false;
       result = HoldPress;
     }
     else {                                                                // Otherwise the button was only pressed briefly, return that.
-      DEBUG_SERIAL.println("Button 1 briefly pressed");
+      LOG_DEBUG("Button 1 briefly pressed");
       buttonHigh = false;
       result = QuickPress;
     }
@@ -166,12 +173,12 @@ ButtonActionResult CheckButtonTwoState() {
 
   bool currentButtonState = digitalRead(BTN_2_PIN);                       // Debounce button. Each change in state vs the previous invocation restarts the timer.
   if (currentButtonState != previousState) {
-    DEBUG_SERIAL.println("Button 2 state change detected");
+    LOG_DEBUG("Button 2 state change detected");
     debounceTimer = 0;
   }
 
   if (debounceTimer >= debounceDelay && currentButtonState == HIGH) {     // Button has passed the debounce check and is being pressed. Begin the timer to determine how long it's been held for.
-    DEBUG_SERIAL.println("Button 2 stable HIGH");
+    LOG_DEBUG("Button 2 stable HIGH");
     if (!buttonHigh) {
       buttonHighTimer = 0;                                                // Don't want to reset the timer the whole time the button is being held, only the first time it moves from unpressed to pressed.
       buttonHigh = true;
@@ -184,15 +191,15 @@ ButtonActionResult CheckButtonTwoState() {
     currentButtonState == LOW &&
     buttonHigh
   ) {
-    DEBUG_SERIAL.println("Button 2 stable LOW");
+    LOG_DEBUG("Button 2 stable LOW");
 
     if (buttonHighTimer >= minimumTimeForHold) {                          // If the button was high long enough to consider it held, return that information.
-      DEBUG_SERIAL.println("Button 2 held");
+      LOG_DEBUG("Button 2 held");
       buttonHigh = false;
       result = HoldPress;
     }
     else {                                                                // Otherwise the button was only pressed briefly, return that.
-      DEBUG_SERIAL.println("Button 2 briefly pressed");
+      LOG_DEBUG("Button 2 briefly pressed");
       buttonHigh = false;
       result = QuickPress;
     }
@@ -207,18 +214,17 @@ ButtonActionResult CheckButtonTwoState() {
 * Currently configured to cycle through the various stats.
 */
 void ButtonOneQuickPressed() {
-  DEBUG_SERIAL.println("Button 1 quick release action commencing");
+  LOG_DEBUG("Button 1 quick release action commencing");
   _selectedValueIndex++;                          // Increment the value to be shown. Wrap around if moved out of range.
-  if (_selectedValueIndex >= API_VALUE_COUNT) {
+  if (_selectedValueIndex >= GetSlotCount()) {
     _selectedValueIndex = 0;
   }
 
-  DEBUG_SERIAL.print("Selected value index now: ");
-  DEBUG_SERIAL.println(_selectedValueIndex);
+  LOG_INFO("Selected value index now: %d", _selectedValueIndex);
 
   WriteToLCD(                                     // Display the summary for the currently selected option.
-    _valueSelectionSummary[_selectedValueIndex][0],
-    _valueSelectionSummary[_selectedValueIndex][1]
+    GetSlotSummary(_selectedValueIndex, 0),
+    GetSlotSummary(_selectedValueIndex, 1)
   );
 
   delay(100); // Prevents skipping over options.
@@ -229,10 +235,10 @@ void ButtonOneQuickPressed() {
 * Currently configured to cycle through the various LDR based LCD dimming modes.
 */
 void ButtonOneHoldPressed() {
-  DEBUG_SERIAL.println("Button 1 held release action commencing");
+  LOG_DEBUG("Button 1 held release action commencing");
   if (_selectedDisplayMode == On) {
     _lcd.backlight();
-    DEBUG_SERIAL.println("Setting display backlight to Always Off");
+    LOG_INFO("Setting display backlight to Always Off");
     WriteToLCD("LCD backlight", "always off");
     _selectedDisplayMode = Off;
     _lcdBacklightOn = false;
@@ -240,24 +246,22 @@ void ButtonOneHoldPressed() {
 
   else if (_selectedDisplayMode == Off) {
     _lcd.backlight();
-    DEBUG_SERIAL.println("Setting display backlight to Auto");
+    LOG_INFO("Setting display backlight to Auto");
     WriteToLCD("LCD backlight", "Auto (light dep)");
     _selectedDisplayMode = Auto;
     if (LDRBelowDarkRoomThreshold()) {
-      DEBUG_SERIAL.print("Turning backlight off based on LDR level of ");
-      DEBUG_SERIAL.println(analogRead(LDR_PIN));
+      LOG_INFO("Turning backlight off based on LDR level of %d", analogRead(LDR_PIN));
       _lcdBacklightOn = false;
     }
     else {
-      DEBUG_SERIAL.print("Turning backlight on based on LDR level of ");
-      DEBUG_SERIAL.println(analogRead(LDR_PIN));
+      LOG_INFO("Turning backlight on based on LDR level of %d", analogRead(LDR_PIN));
       _lcdBacklightOn = true;
     }  
   }
 
   else if (_selectedDisplayMode == Auto) {
     _lcd.backlight();
-    DEBUG_SERIAL.println("Setting display backlight to Always On");
+    LOG_INFO("Setting display backlight to Always On");
     WriteToLCD("LCD backlight", "always on");
     _selectedDisplayMode = On;
     _lcdBacklightOn = true;
@@ -271,7 +275,7 @@ void ButtonOneHoldPressed() {
 * Configured to save values to EEPROM and re-render the stat screen.
 */
 void ButtonOnePostQuickPressRelease() {
-  DEBUG_SERIAL.println("Button 1 post quick release action commencing");
+  LOG_DEBUG("Button 1 post quick release action commencing");
   SaveConfigToEEPROM();
   ProcessDisplayValueUpdate(true);    // Call display update with override value to clear the button message from the screen and display the stat again.
 }
@@ -281,7 +285,7 @@ void ButtonOnePostQuickPressRelease() {
 * Configured to action the LCD backlight configuration, then save values to EEPROM and re-render the stat screen.
 */
 void ButtonOnePostHoldPressRelease() {
-  DEBUG_SERIAL.println("Button 1 post held release action commencing");
+  LOG_DEBUG("Button 1 post held release action commencing");
   if (_lcdBacklightOn) {
     _lcd.backlight();
   }
@@ -294,32 +298,42 @@ void ButtonOnePostHoldPressRelease() {
 
 /*
 * Called when button 2 is pressed for at least 50 ms but no more than 2000 ms.
+* Configured to request an immediate refresh of the values. The message shown is replaced once the refresh is served (see ProcessRefreshRequest()).
 */
 void ButtonTwoQuickPressed() {
-  DEBUG_SERIAL.println("Button 2 quick release action commencing");
-  // Currently this does nothing. Provision for future.
+  LOG_DEBUG("Button 2 quick release action commencing");
+  WriteToLCD(GetSlotLabel(_selectedValueIndex), "Refreshing...");
+  RequestRefresh();
 }
 
 /*
 * Called when button 2 is pressed for at least 2000 ms.
+* Currently configured to cycle through the ways the selected value can be viewed (see ValueViewMode).
 */
 void ButtonTwoHoldPressed() {
-  DEBUG_SERIAL.println("Button 2 held release action commencing");
-  // Currently this does nothing. Provision for future.
+  LOG_DEBUG("Button 2 held release action commencing");
+  static const char* viewModeNames[ViewModeCount] = { "Value", "Trend", "Sparkline", "Big digits" };
+  _selectedViewMode = static_cast<ValueViewMode>((_selectedViewMode + 1) % ViewModeCount);
+  LOG_INFO("Setting value view to %s", viewModeNames[_selectedViewMode]);
+  WriteToLCD("Value view", viewModeNames[_selectedViewMode]);
+
+  delay(100); // Prevents skipping over options.
 }
 
 /*
-* Called when button 2 was pressed briefly, the action completed, and the timeout elapsed.
+* Called when button 2 was pressed briefly and the action completed. Unlike the other buttons there is no timeout.
 */
 void ButtonTwoPostQuickPressRelease() {
-  DEBUG_SERIAL.println("Button 2 post quick release action commencing");
+  LOG_DEBUG("Button 2 post quick release action commencing");
   // Currently this does nothing. Provision for future.
 }
 
 /*
 * Called when button 2 was pressed and held, the action completed, and the timeout elapsed.
+* Configured to save values to EEPROM and re-render the stat screen in the chosen view.
 */
 void ButtonTwoPostHoldPressRelease() {
-  DEBUG_SERIAL.println("Button 2 post held release action commencing");
-  // Currently this does nothing. Provision for future.
+  LOG_DEBUG("Button 2 post held release action commencing");
+  SaveConfigToEEPROM();
+  ProcessDisplayValueUpdate(true);    // Call display update with override value to clear the button message from the screen and display the stat again.
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "log_t93.h"
+#include "cache_t93.h"
+#include "slots_t93.h"
+#include "history_t93.h"
+#include "series_t93.h"
+
+#define LOG_MODULE CACHE
+
+/*
+* Stores a value successfully fetched for the given index, marking it fresh.
+* _currentValueUpdated is only set if the value differs from what is already held, so unchanged values don't cause a redraw.
+* The exception is when a trend is on display, as the rate of change moves even when the value doesn't.
+*/
+void StoreFetchedValue(int index, const char* value) {
+  _currentValueFetchedAt[index] = millis();
+  _currentValueStale[index] = false;
+  bool sampled = RecordHistorySample(index, value);
+  RecordSeriesSample(index, value);
+
+  if (strcmp(GetSlotValue(index), value) != 0) {                            // If the value differs from what we currently have stored...
+    _currentValueUpdated[index] = true;                                     // Mark as updated.
+    SetSlotValue(index, value);                                             // Copy the new value into the slot arena for eventual displaying.
+
+    LOG_INFO("Got new value: %s for index %d", value, index);
+  }
+  else {
+    _currentValueUpdated[index] = sampled && _selectedViewMode != ViewValue; // No change detected for this stat.
+
+    LOG_DEBUG("Polled API and received same value as previously (%s) for index %d", value, index);
+  }
+}
+
+/*
+* Called when a fresh value couldn't be obtained for the given index.
+* The last good value keeps being served, marked stale, until it is older than VALUE_MAX_AGE_SECONDS.
+* After that (or if no value was ever fetched) it is replaced with "Unknown", which triggers an error on the LCD.
+*/
+void MarkValueFetchFailed(int index) {
+  bool neverFetched = _currentValueFetchedAt[index] == 0;
+  bool expired = millis() - _currentValueFetchedAt[index] > VALUE_MAX_AGE_SECONDS * 1000UL;
+
+  _currentValueStale[index] = true;
+  if ((neverFetched || expired) && strcmp(GetSlotValue(index), "Unknown") != 0) {
+    LOG_WARNING("Cached value expired for index %d", index);
+    SetSlotValue(index, "Unknown");
+    _currentValueUpdated[index] = true;
+  }
+}
+
+/*
+* Called when a poll failed as a whole (e.g. API unreachable or invalid payload). Marks every value stale.
+*/
+void MarkAllValuesFetchFailed() {
+  for (int i = 0; i < GetSlotCount(); i++) {
+    MarkValueFetchFailed(i);
+  }
+}
+
+/*
+* True if the value at the given index is being served from cache because the latest attempt to fetch it failed.
+*/
+bool IsValueStale(int index) {
+  return _currentValueStale[index];
+}
\ No newline at end of file
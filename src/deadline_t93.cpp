@@ -0,0 +1,110 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "log_t93.h"
+#include "deadline_t93.h"
+
+#define LOG_MODULE DEADLINE
+
+static unsigned long startedAt = 0;                 // When the current poll's budget started.
+static unsigned long pollDeadline = 0;              // The millis() by which the whole poll must be done.
+static DeadlinePhase phase = PhaseNone;             // The phase under way, PhaseNone outside a poll.
+static unsigned long phaseStartedAt = 0;
+static unsigned long phaseDeadline = 0;             // The millis() by which the current phase must be done, never later than pollDeadline.
+static uint32_t overruns[PhaseCount] = { 0 };       // Overruns since boot, by phase.
+static unsigned long longest[PhaseCount] = { 0 };   // The longest each phase has taken since boot in milliseconds, for tuning the budgets.
+
+/*
+* Starts the time budget for a poll (or for opening the connection ahead of one). Each phase begun after this gets its own share of
+* POLL_BUDGET_MS, cut short so the poll as a whole can't run past it.
+*/
+void StartDeadline() {
+  startedAt = millis();
+  pollDeadline = startedAt + POLL_BUDGET_MS;
+  phase = PhaseNone;
+}
+
+/*
+* Ends the phase under way (if any) and starts the next, which must be done by the sooner of its own budget and the poll's.
+*/
+void BeginPhase(DeadlinePhase next) {
+  unsigned long now = millis();
+  if (phase != PhaseNone) {
+    longest[phase] = max(longest[phase], now - phaseStartedAt);
+  }
+
+  phase = next;
+  phaseStartedAt = now;
+  unsigned long budget = GetPhaseBudget(next);
+  phaseDeadline = (long) (pollDeadline - (now + budget)) < 0 ? pollDeadline : now + budget;
+}
+
+/*
+* Ends the poll's budget, logging how much of it was used.
+*/
+void EndDeadline() {
+  BeginPhase(PhaseNone);
+  LOG_DEBUG("Finished in %lu ms of %d ms budget", millis() - startedAt, POLL_BUDGET_MS);
+}
+
+/*
+* The millis() by which the current phase must be done.
+*/
+unsigned long GetPhaseDeadline() {
+  return phaseDeadline;
+}
+
+/*
+* Milliseconds left of the current phase's budget, 0 once overrun.
+*/
+unsigned long GetPhaseRemaining() {
+  long remaining = (long) (phaseDeadline - millis());
+  return remaining > 0 ? remaining : 0;
+}
+
+bool IsPhaseOverrun() {
+  return phase != PhaseNone && GetPhaseRemaining() == 0;
+}
+
+/*
+* Counts an overrun against the current phase. Called by whatever abandons the poll because of it.
+*/
+void RecordPhaseOverrun() {
+  if (phase == PhaseNone) {
+    return;
+  }
+  overruns[phase]++;
+  LOG_WARNING("%s overran its %lu ms budget, %lu ms into the poll (%u overruns since boot)",
+    GetPhaseName(phase), (unsigned long) (phaseDeadline - phaseStartedAt), millis() - startedAt, overruns[phase]);
+  LOG_INFO("Longest taken: DNS %lu ms, connect %lu ms, TLS %lu ms, headers %lu ms, body %lu ms",
+    longest[PhaseDNS], longest[PhaseConnect], longest[PhaseTLS], longest[PhaseHeaders], longest[PhaseBody]);
+}
+
+uint32_t GetPhaseOverruns(DeadlinePhase which) {
+  return which > PhaseNone && which < PhaseCount ? overruns[which] : 0;
+}
+
+const char* GetPhaseName(DeadlinePhase which) {
+  switch (which) {
+    case PhaseDNS: return "DNS";
+    case PhaseConnect: return "Connect";
+    case PhaseTLS: return "TLS";
+    case PhaseHeaders: return "Headers";
+    case PhaseBody: return "Body";
+    default: return "None";
+  }
+}
+
+/*
+* The most a phase may take when the poll's budget allows it.
+*/
+unsigned long GetPhaseBudget(DeadlinePhase which) {
+  switch (which) {
+    case PhaseDNS: return DNS_BUDGET_MS;
+    case PhaseConnect: return CONNECT_BUDGET_MS;
+    case PhaseTLS: return TLS_BUDGET_MS;
+    case PhaseHeaders: return HEADERS_BUDGET_MS;
+    case PhaseBody: return BODY_BUDGET_MS;
+    default: return POLL_BUDGET_MS;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include <Arduino.h>
+#include "rom/miniz.h"
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+#include "log_t93.h"
+#include "decode_t93.h"
+
+#define LOG_MODULE DECODE
+
+PayloadDecoder::PayloadDecoder(char* buffer, size_t capacity) :
+  _buffer(buffer),
+  _capacity(capacity),
+  _length(0),
+  _received(0),
+  _expected(-1),
+  _sink(nullptr),
+  _encoding(EncodingIdentity),
+  _state(DecoderIdentity),
+  _inflater(nullptr),
+  _inflateFlags(TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF),
+  _headerCount(0),
+  _extraRemaining(0),
+  _gzipFlags(0),
+  _overflowed(false) {}
+
+/*
+* Streams the decoded body to sink rather than into a buffer. window is only used for compressed bodies and must be TINFL_LZ_DICT_SIZE bytes.
+*/
+PayloadDecoder::PayloadDecoder(uint8_t* window, size_t windowSize, Print* sink) :
+  _buffer((char*) window),
+  _capacity(windowSize),
+  _length(0),
+  _received(0),
+  _expected(-1),
+  _sink(sink),
+  _encoding(EncodingIdentity),
+  _state(DecoderIdentity),
+  _inflater(nullptr),
+  _inflateFlags(0),                                                         // Wrapping output, the window is reused as the body streams through it.
+  _headerCount(0),
+  _extraRemaining(0),
+  _gzipFlags(0),
+  _overflowed(false) {}
+
+PayloadDecoder::~PayloadDecoder() {
+  free(_inflater);
+}
+
+/*
+* Prepares to decode a body with the given Content-Encoding. Returns false if the encoding is unsupported or the inflater can't be allocated.
+* contentLength is the body's length as sent (i.e. compressed), or -1 if unknown. A body cut short of it fails to finish.
+*/
+bool PayloadDecoder::begin(ContentEncoding encoding, int contentLength) {
+  _encoding = encoding;
+  _expected = contentLength;
+  if (encoding == EncodingIdentity) {
+    _state = DecoderIdentity;
+    return true;
+  }
+  if (encoding == EncodingUnsupported) {
+    LOG_WARNING("Unsupported response Content-Encoding");
+    return false;
+  }
+
+  _inflater = (tinfl_decompressor*) malloc(sizeof(tinfl_decompressor));
+  if (_inflater == nullptr) {
+    LOG_ERROR("Unable to allocate inflater");
+    return false;
+  }
+  tinfl_init(_inflater);
+  _state = encoding == EncodingGzip ? DecoderGzipHeader : DecoderDeflateProbe;
+  return true;
+}
+
+size_t PayloadDecoder::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+/*
+* Decodes the next chunk of the body. Chunks may split headers, compressed blocks and trailers at any byte.
+* Returns fewer bytes than given once decoding fails, which causes HTTPClient::writeToStream() to stop reading the body.
+*/
+size_t PayloadDecoder::write(const uint8_t* data, size_t size) {
+  size_t consumed = 0;
+
+  while (consumed < size && _state != DecoderFailed) {
+    switch (_state) {
+      case DecoderIdentity: {
+        if (_sink != nullptr) {
+          size_t count = _sink->write(data + consumed, size - consumed);
+          _length += count;
+          consumed += count;
+          if (consumed < size) {
+            LOG_WARNING("Decoded output rejected");
+            _state = DecoderFailed;
+          }
+          break;
+        }
+        size_t count = min(size - consumed, _capacity - 1 - _length);      // Leave space for the null terminator.
+        memcpy(_buffer + _length, data + consumed, count);
+        _length += count;
+        consumed += count;
+        if (consumed < size) {
+          _overflowed = true;
+          _state = DecoderFailed;
+        }
+        break;
+      }
+
+      case DecoderGzipHeader:
+        _header[_headerCount++] = data[consumed++];
+        if (_headerCount == 10) {
+          if (_header[0] != 0x1F || _header[1] != 0x8B || _header[2] != 8) { // Magic number and deflate compression method.
+            LOG_WARNING("Invalid gzip header");
+            _state = DecoderFailed;
+            break;
+          }
+          _gzipFlags = _header[3];
+          nextGzipHeaderState();
+        }
+        break;
+
+      case DecoderGzipExtraLength:
+        _header[_headerCount++] = data[consumed++];
+        if (_headerCount == 2) {
+          _extraRemaining = _header[0] | (_header[1] << 8);
+          _state = DecoderGzipExtra;
+          if (_extraRemaining == 0) {
+            nextGzipHeaderState();
+          }
+        }
+        break;
+
+      case DecoderGzipExtra:
+        consumed++;
+        if (--_extraRemaining == 0) {
+          nextGzipHeaderState();
+        }
+        break;
+
+      case DecoderGzipName:
+      case DecoderGzipComment:
+        if (data[consumed++] == '\0') {
+          nextGzipHeaderState();
+        }
+        break;
+
+      case DecoderGzipHeaderCrc:
+        consumed++;
+        if (++_headerCount == 2) {
+          nextGzipHeaderState();
+        }
+        break;
+
+      case DecoderDeflateProbe:
+        _header[_headerCount++] = data[consumed++];
+        if (_headerCount == 2) {
+          if ((_header[0] & 0x0F) == 8 && ((_header[0] << 8) | _header[1]) % 31 == 0) {   // A valid zlib header, otherwise assume a raw deflate stream.
+            _inflateFlags |= TINFL_FLAG_PARSE_ZLIB_HEADER;
+          }
+          _state = DecoderInflate;
+          if (inflate(_header, 2) < 2 && _state == DecoderInflate) {        // Probe bytes are part of the stream, feed them to the inflater.
+            LOG_WARNING("Inflater rejected start of stream");
+            _state = DecoderFailed;
+          }
+        }
+        break;
+
+      case DecoderInflate: {
+        size_t count = inflate(data + consumed, size - consumed);
+        if (count == 0 && _state == DecoderInflate) {                       // Guards against spinning if the inflater makes no progress.
+          _state = DecoderFailed;
+        }
+        consumed += count;
+        break;
+      }
+
+      case DecoderGzipTrailer:
+        _header[_headerCount++] = data[consumed++];
+        if (_headerCount == 8) {                                            // CRC32 then ISIZE. TLS already guarantees integrity, so only the size is checked to detect truncation.
+          uint32_t expectedLength = _header[4] | (_header[5] << 8) | (_header[6] << 16) | ((uint32_t) _header[7] << 24);
+          _state = expectedLength == (uint32_t) _length ? DecoderDone : DecoderFailed;   // ISIZE is the length modulo 2^32.
+        }
+        break;
+
+      case DecoderDone:
+        consumed = size;                                                    // Ignore anything after the end of the stream.
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  _received += consumed;
+  return consumed;
+}
+
+/*
+* Null terminates the decoded body. Returns true if the whole body was decoded successfully.
+* An identity body is only whole if it reached its Content-Length, when that is known. A compressed one must also reach the end of its stream.
+*/
+bool PayloadDecoder::finish() {
+  if (_sink == nullptr) {
+    _buffer[_length] = '\0';
+  }
+  if (_expected >= 0 && _received < (size_t) _expected) {
+    LOG_WARNING("Body truncated, received %u of %d bytes", (unsigned int) _received, _expected);
+    return false;
+  }
+  return _state == DecoderIdentity || _state == DecoderDone;
+}
+
+/*
+* True if decoding stopped because the body would not fit in the buffer.
+*/
+bool PayloadDecoder::overflowed() {
+  return _overflowed;
+}
+
+/*
+* The number of decoded bytes written to the buffer.
+*/
+size_t PayloadDecoder::length() {
+  return _length;
+}
+
+/*
+* Feeds compressed bytes to the inflater, writing the output directly after what has been decoded so far.
+* When streaming, output goes around the circular window and each piece is passed to the sink as the window fills.
+* Returns the number of bytes consumed. Moves on to the trailer (gzip) or done (deflate) once the stream ends.
+*/
+size_t PayloadDecoder::inflate(const uint8_t* data, size_t size) {
+  size_t consumed = 0;
+  tinfl_status status;
+  do {
+    size_t inputSize = size - consumed;
+    size_t offset = _sink != nullptr ? _length & (_capacity - 1) : _length;
+    size_t outputSize = _sink != nullptr ? _capacity - offset : _capacity - 1 - _length;
+    status = tinfl_decompress(
+      _inflater,
+      data + consumed,
+      &inputSize,
+      (mz_uint8*) _buffer,                                                  // The start of the buffer is the window that back references are resolved against.
+      (mz_uint8*) _buffer + offset,
+      &outputSize,
+      _inflateFlags | TINFL_FLAG_HAS_MORE_INPUT
+    );
+    consumed += inputSize;
+
+    if (_sink != nullptr && outputSize > 0 && _sink->write((uint8_t*) _buffer + offset, outputSize) != outputSize) {
+      LOG_WARNING("Decoded output rejected");
+      _state = DecoderFailed;
+      return consumed;
+    }
+    _length += outputSize;
+  } while (status == TINFL_STATUS_HAS_MORE_OUTPUT && _sink != nullptr);     // The window is full, carry on from its start now it has been drained.
+
+  if (status == TINFL_STATUS_DONE) {
+    _headerCount = 0;
+    _state = _encoding == EncodingGzip ? DecoderGzipTrailer : DecoderDone;
+  }
+  else if (status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+    LOG_WARNING("Inflated response too large for buffer");
+    _overflowed = true;
+    _state = DecoderFailed;
+  }
+  else if (status < 0) {
+    LOG_WARNING("Inflate failed with status %d", status);
+    _state = DecoderFailed;
+  }
+  return consumed;
+}
+
+/*
+* Moves on to the next optional gzip header field indicated by the header flags, or to the compressed data once there are none left.
+*/
+void PayloadDecoder::nextGzipHeaderState() {
+  _headerCount = 0;
+  if (_gzipFlags & GZIP_FLAG_EXTRA) {
+    _gzipFlags &= ~GZIP_FLAG_EXTRA;
+    _state = DecoderGzipExtraLength;
+  }
+  else if (_gzipFlags & GZIP_FLAG_NAME) {
+    _gzipFlags &= ~GZIP_FLAG_NAME;
+    _state = DecoderGzipName;
+  }
+  else if (_gzipFlags & GZIP_FLAG_COMMENT) {
+    _gzipFlags &= ~GZIP_FLAG_COMMENT;
+    _state = DecoderGzipComment;
+  }
+  else if (_gzipFlags & GZIP_FLAG_HCRC) {
+    _gzipFlags &= ~GZIP_FLAG_HCRC;
+    _state = DecoderGzipHeaderCrc;
+  }
+  else {
+    _state = DecoderInflate;                                                // gzip wraps a raw deflate stream, no zlib header.
+  }
+}
+
+/*
+* Maps a Content-Encoding response header to the decoding required. A missing header means the body is uncompressed.
+*/
+ContentEncoding ParseContentEncoding(const char* header) {
+  if (header[0] == '\0' || strcasecmp(header, "identity") == 0) {
+    return EncodingIdentity;
+  }
+  if (strcasecmp(header, "gzip") == 0 || strcasecmp(header, "x-gzip") == 0) {
+    return EncodingGzip;
+  }
+  if (strcasecmp(header, "deflate") == 0) {
+    return EncodingDeflate;
+  }
+  return EncodingUnsupported;
+}
\ No newline at end of file
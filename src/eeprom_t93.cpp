@@ -3,11 +3,13 @@
 #include "globals_t93.h"
 #include "enums_t93.h"
 #include "lcd_t93.h"
+#include "log_t93.h"
 #include "eeprom_t93.h"
 
+#define LOG_MODULE EEPROM
+
 void InitializeEEPROM() {
-  DEBUG_SERIAL.print("Initializing EEPROM with a size of ");
-  DEBUG_SERIAL.println(EEPROM_SIZE);
+  LOG_INFO("Initializing EEPROM with a size of %d", EEPROM_SIZE);
   EEPROM.begin(EEPROM_SIZE);
 
   if (EEPROM_INIT) {
@@ -21,41 +23,34 @@ void InitializeEEPROM() {
 * Pulls configuration from EEPROM on ESP startup and reads them into the global variables.
 */
 void LoadConfigFromEEPROM() {
-  DEBUG_SERIAL.println("Loading config values from EEPROM");
+  LOG_INFO("Loading config values from EEPROM");
   _selectedValueIndex = EEPROM.readInt(SV_INDEX);
   _selectedDisplayMode = static_cast<DisplayDimmingMode>(EEPROM.readInt(DM_INDEX));
-  DEBUG_SERIAL.print("_selectedValueIndex: ");
-  DEBUG_SERIAL.println(_selectedValueIndex);
-  DEBUG_SERIAL.print("_selectedDisplayMode: ");
-  DEBUG_SERIAL.println(_selectedDisplayMode);
+  int viewMode = EEPROM.readInt(VM_INDEX);
+  _selectedViewMode = viewMode >= 0 && viewMode < ViewModeCount ? static_cast<ValueViewMode>(viewMode) : ViewValue;
+  LOG_INFO("_selectedValueIndex: %d, _selectedDisplayMode: %d, _selectedViewMode: %d", _selectedValueIndex, _selectedDisplayMode, _selectedViewMode);
 }
 
 /*
 * Saves configuration to EEPROM when config edited via bluetooth command.
 */
 void SaveConfigToEEPROM() {
-  DEBUG_SERIAL.println("Saving config values to EEPROM");
-  DEBUG_SERIAL.print("_selectedValueIndex: ");
-  DEBUG_SERIAL.println(_selectedValueIndex);
-  DEBUG_SERIAL.print("_selectedDisplayMode: ");
-  DEBUG_SERIAL.println(_selectedDisplayMode);
+  LOG_DEBUG("Saving config values to EEPROM, _selectedValueIndex: %d, _selectedDisplayMode: %d, _selectedViewMode: %d", _selectedValueIndex, _selectedDisplayMode, _selectedViewMode);
 
   EEPROM.writeInt(SV_INDEX, _selectedValueIndex);
   EEPROM.writeInt(DM_INDEX, _selectedDisplayMode);
+  EEPROM.writeInt(VM_INDEX, _selectedViewMode);
   EEPROM.commit();
 
-  DEBUG_SERIAL.println("Saved config values to EEPROM");
-  DEBUG_SERIAL.print("_selectedValueIndex: ");
-  DEBUG_SERIAL.println(EEPROM.readInt(SV_INDEX));
-  DEBUG_SERIAL.print("_selectedDisplayMode: ");
-  DEBUG_SERIAL.println(EEPROM.readInt(DM_INDEX));
+  LOG_INFO("Saved config values to EEPROM, _selectedValueIndex: %d, _selectedDisplayMode: %d, _selectedViewMode: %d",
+    EEPROM.readInt(SV_INDEX), EEPROM.readInt(DM_INDEX), EEPROM.readInt(VM_INDEX));
 }
 
 /*
 * Clears the EEPROM, sets all addresses to 0 and then loads in default config.
 */
 void ClearEEPROM() {
-  DEBUG_SERIAL.println("Clearing EEPROM and writing with 0 values");
+  LOG_WARNING("Clearing EEPROM and writing with 0 values");
   for (int i = 0; i < EEPROM_SIZE; i++) {
     EEPROM.write(i, 0);
   };
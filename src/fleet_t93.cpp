@@ -0,0 +1,381 @@
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <elapsedMillis.h>
+#include "mbedtls/md.h"
+
+#include "globals_t93.h"
+#include "secrets_t93.h"
+#include "wifi_t93.h"
+#include "lcd_t93.h"
+#include "cache_t93.h"
+#include "slots_t93.h"
+#include "log_t93.h"
+#include "profiler_t93.h"
+#include "fleet_t93.h"
+
+#define LOG_MODULE FLEET
+
+#ifndef SECRET_FLEET_KEY
+#if FLEET_MODE
+#error "FLEET_MODE requires SECRET_FLEET_KEY to be defined in secrets_t93.h"
+#endif
+#define SECRET_FLEET_KEY ""
+#endif
+
+// Another counter in the fleet. Its lease (active) lapses when it goes quiet, but its boot nonce and sequence number are kept for as long
+// as it holds a slot, including across InitializeFleet(), so packets captured from it can't be replayed once it has left.
+// They're lost when this counter restarts, until the peer is next heard from a captured packet may be accepted once.
+struct FleetPeer {
+  bool active;                                      // Whether this counter has been heard from within FLEET_LEASE_MS.
+  bool known;                                       // Whether this slot holds a counter's replay state, leased or not.
+  uint8_t mac[6];
+  uint32_t bootNonce;                               // Random per boot, so a rebooted peer's sequence numbers starting over aren't taken for replays.
+  uint32_t retiredNonces[FLEET_RETIRED_NONCES];     // The peer's previous boot nonces, newest first. Their packets are replays.
+  uint32_t lastSequence;
+  unsigned long lastHeard;
+};
+
+static WiFiUDP fleetSocket;
+static IPAddress fleetGroup(FLEET_GROUP);
+static bool fleetJoined = false;
+static unsigned long fleetJoinedAt = 0;
+static uint8_t ownMac[6];
+static uint32_t bootNonce = 0;
+static uint32_t sequenceNumber = 0;
+static FleetPeer peers[FLEET_MAX_PEERS];
+static bool wasPoller = false;
+static unsigned long lastValuesAt = 0;              // When values were last received from the poller, 0 if never.
+static elapsedMillis heartbeatTimer;
+
+/*
+* Identifies this counter to the fleet and joins the multicast group if WiFi is already up.
+*/
+void InitializeFleet() {
+  if (!FLEET_MODE) {
+    return;
+  }
+
+  LOG_INFO("Initializing fleet");
+  WiFi.macAddress(ownMac);
+  bootNonce = esp_random();
+  for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+    peers[i].active = false;                                                // Leases are earned again, replay state is kept (see FleetPeer).
+  }
+  if (IsWiFiConnected()) {
+    JoinFleetGroup();
+  }
+}
+
+/*
+* Non-blocking handling of fleet traffic. Applies values shared by the poller, tracks which peers are alive and sends this counter's heartbeat.
+*/
+void ProcessFleet() {
+  PROFILE_SECTION(SectionFleet);
+  if (!FLEET_MODE) {
+    return;
+  }
+  if (!IsWiFiConnected()) {
+    fleetJoined = false;                                                    // Membership is lost with the connection, rejoin once it returns.
+    return;
+  }
+  if (!fleetJoined && !JoinFleetGroup()) {
+    return;
+  }
+
+  static uint8_t packet[FLEET_PACKET_SIZE];
+  int size;
+  while ((size = fleetSocket.parsePacket()) > 0) {
+    int length = fleetSocket.read(packet, sizeof(packet));
+    if (size <= (int) sizeof(packet)) {                                     // Anything larger isn't a fleet packet.
+      HandleFleetPacket(packet, length);
+    }
+  }
+
+  if (heartbeatTimer >= FLEET_HEARTBEAT_MS) {
+    heartbeatTimer = 0;
+    SendFleetPacket(FleetHeartbeat);
+  }
+
+  ExpireFleetPeers();
+  bool poller = IsFleetPoller();
+  if (poller != wasPoller) {
+    if (poller) {
+      LOG_INFO("This counter is now the poller");
+    }
+    else {
+      LOG_INFO("Another counter is now the poller");
+    }
+    wasPoller = poller;
+  }
+}
+
+/*
+* True if this counter should poll the API. Always true outside of fleet mode.
+* In fleet mode the live counter with the lowest MAC address polls. A counter that has just joined waits long enough to have heard
+* every peer's heartbeat before claiming the role, so a reboot doesn't briefly leave two counters polling.
+*/
+bool IsFleetPoller() {
+  if (!FLEET_MODE) {
+    return true;
+  }
+  if (!fleetJoined || millis() - fleetJoinedAt < FLEET_HEARTBEAT_MS * 3 / 2) {
+    return false;
+  }
+
+  for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+    if (peers[i].active && memcmp(peers[i].mac, ownMac, sizeof(ownMac)) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+* True if the poller has shared values within the last two polling intervals, i.e. values held by a non-polling counter are current.
+*/
+bool HasRecentFleetValues() {
+  return lastValuesAt != 0 && millis() - lastValuesAt < POLL_INTERVAL_SECONDS * 2000UL;
+}
+
+/*
+* Sends the current values to the rest of the fleet. Called by the poller after each poll, successful or not, so peers mirror its cache.
+*/
+void ShareFleetValues() {
+  if (FLEET_MODE && fleetJoined && IsFleetPoller()) {
+    SendFleetPacket(FleetValues);
+  }
+}
+
+/*
+* (Re)opens the fleet socket on the multicast group. Returns true if successful.
+*/
+bool JoinFleetGroup() {
+  fleetSocket.stop();
+  if (!fleetSocket.beginMulticast(fleetGroup, FLEET_PORT)) {
+    LOG_ERROR("Unable to join multicast group");
+    return false;
+  }
+
+  LOG_INFO("Joined multicast group");
+  fleetJoined = true;
+  fleetJoinedAt = millis();
+  heartbeatTimer = FLEET_HEARTBEAT_MS;                                      // Announce straight away so peers learn of this counter quickly.
+  return true;
+}
+
+/*
+* Builds, signs and multicasts a packet of the given type.
+* Layout: magic, type, MAC, boot nonce, sequence number, then for FleetValues a value count followed by flags, length and text for each value.
+* A truncated HMAC-SHA256 of everything before it, keyed by SECRET_FLEET_KEY, ends the packet.
+*/
+void SendFleetPacket(FleetPacketType type) {
+  static uint8_t packet[FLEET_PACKET_SIZE];
+
+  memcpy(packet, FLEET_MAGIC, 4);
+  packet[4] = type;
+  memcpy(packet + 5, ownMac, sizeof(ownMac));
+  PutFleetUint32(packet + 11, bootNonce);
+  PutFleetUint32(packet + 15, ++sequenceNumber);
+  int length = FLEET_HEADER_LENGTH;
+
+  if (type == FleetValues) {
+    packet[length++] = GetSlotCount();
+    for (int i = 0; i < GetSlotCount(); i++) {
+      int valueLength = strlen(GetSlotValue(i));
+      packet[length++] = IsValueStale(i) ? FLEET_VALUE_STALE : 0;
+      packet[length++] = valueLength;
+      memcpy(packet + length, GetSlotValue(i), valueLength);
+      length += valueLength;
+    }
+  }
+
+  SignFleetPacket(packet, length, packet + length);
+  length += FLEET_TAG_LENGTH;
+
+  fleetSocket.beginPacket(fleetGroup, FLEET_PORT);
+  fleetSocket.write(packet, length);
+  fleetSocket.endPacket();
+}
+
+/*
+* Authenticates a received packet and updates the sender's record, applying any values it carries if it is the poller.
+* Packets with a bad tag, or a sequence number not newer than the last seen from the sender's current boot, are discarded.
+*/
+void HandleFleetPacket(uint8_t* packet, int length) {
+  if (length < FLEET_HEADER_LENGTH + FLEET_TAG_LENGTH || memcmp(packet, FLEET_MAGIC, 4) != 0) {
+    return;
+  }
+  if (memcmp(packet + 5, ownMac, sizeof(ownMac)) == 0) {                   // This counter's own packet, looped back by the group.
+    return;
+  }
+
+  uint8_t tag[FLEET_TAG_LENGTH];
+  int signedLength = length - FLEET_TAG_LENGTH;
+  SignFleetPacket(packet, signedLength, tag);
+  uint8_t difference = 0;
+  for (int i = 0; i < FLEET_TAG_LENGTH; i++) {                              // Compared in full regardless of where it differs, so the tag can't be found byte by byte.
+    difference |= tag[i] ^ packet[signedLength + i];
+  }
+  if (difference != 0) {
+    LOG_WARNING("Discarding packet with invalid tag");
+    return;
+  }
+
+  int index = FindFleetPeer(packet + 5, true);
+  if (index < 0) {
+    return;                                                                 // No room to track another peer.
+  }
+  FleetPeer& peer = peers[index];
+  uint32_t nonce = GetFleetUint32(packet + 11);
+  uint32_t sequence = GetFleetUint32(packet + 15);
+  if (IsFleetReplay(index, nonce, sequence)) {
+    LOG_WARNING("Discarding replayed packet");
+    return;
+  }
+  if (peer.known && nonce != peer.bootNonce) {                              // The peer has restarted, anything from its previous boot is now a replay.
+    memmove(peer.retiredNonces + 1, peer.retiredNonces, sizeof(peer.retiredNonces) - sizeof(peer.retiredNonces[0]));
+    peer.retiredNonces[0] = peer.bootNonce;
+  }
+
+  bool joined = !peer.active;
+  peer.active = true;
+  peer.known = true;
+  peer.bootNonce = nonce;
+  peer.lastSequence = sequence;
+  peer.lastHeard = millis();
+
+  if (joined) {
+    LOG_INFO("Peer %02X:%02X:%02X:%02X:%02X:%02X joined", peer.mac[0], peer.mac[1], peer.mac[2], peer.mac[3], peer.mac[4], peer.mac[5]);
+    ShareFleetValues();                                                     // Bring the newcomer up to date rather than leaving it blank until the next poll.
+  }
+
+  if (packet[4] == FleetValues && !IsFleetPoller() && IsLowestFleetPeer(index)) {
+    ApplyFleetValues(packet + FLEET_HEADER_LENGTH, signedLength - FLEET_HEADER_LENGTH);
+  }
+}
+
+/*
+* Stores the values from a FleetValues packet as though they had been fetched from the API by this counter.
+*/
+void ApplyFleetValues(const uint8_t* payload, int length) {
+  if (length < 1) {
+    return;
+  }
+
+  int count = payload[0];
+  int position = 1;
+  SetSlotCount(count);
+  for (int i = 0; i < count && position + 2 <= length; i++) {
+    uint8_t flags = payload[position];
+    int valueLength = payload[position + 1];
+    position += 2;
+    if (valueLength >= MAX_VALUE_LENGTH || position + valueLength > length) {
+      return;
+    }
+
+    if (i < GetSlotCount()) {                                               // The poller may run a build allowing more slots, ignore the excess.
+      if (flags & FLEET_VALUE_STALE) {
+        MarkValueFetchFailed(i);
+      }
+      else {
+        char value[MAX_VALUE_LENGTH];
+        memcpy(value, payload + position, valueLength);
+        value[valueLength] = '\0';
+        StoreFetchedValue(i, value);
+      }
+    }
+    position += valueLength;
+  }
+
+  lastValuesAt = millis();
+  DrawPollIndicator(false);                                                 // Refresh the stale indicator.
+}
+
+/*
+* Returns the index of the peer with the given MAC, leased or not, or of a slot for it if create is set. -1 if neither is found.
+* Unused slots are taken first, then the one of the peer heard from longest ago without a lease, whose replay state is lost.
+*/
+int FindFleetPeer(const uint8_t* mac, bool create) {
+  int freeIndex = -1;
+  for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+    if (peers[i].known && memcmp(peers[i].mac, mac, 6) == 0) {
+      return i;
+    }
+    if (!peers[i].active && (freeIndex < 0 || (peers[freeIndex].known && (!peers[i].known || (long) (peers[i].lastHeard - peers[freeIndex].lastHeard) < 0)))) {
+      freeIndex = i;
+    }
+  }
+
+  if (create && freeIndex >= 0) {
+    memset(&peers[freeIndex], 0, sizeof(FleetPeer));
+    memcpy(peers[freeIndex].mac, mac, 6);
+    return freeIndex;
+  }
+  return -1;
+}
+
+/*
+* True if a packet with the given boot nonce and sequence number has already been seen from the peer at the given index,
+* i.e. its sequence number isn't newer than the last from the peer's current boot, or it is from one of the peer's previous boots.
+* Checked whether or not the peer holds a lease.
+*/
+bool IsFleetReplay(int index, uint32_t nonce, uint32_t sequence) {
+  const FleetPeer& peer = peers[index];
+  if (!peer.known) {
+    return false;
+  }
+  if (nonce == peer.bootNonce) {
+    return sequence <= peer.lastSequence;
+  }
+  for (int i = 0; i < FLEET_RETIRED_NONCES; i++) {
+    if (nonce == peer.retiredNonces[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+* True if the peer at the given index has the lowest MAC of the live peers, i.e. is the one this counter expects to be polling.
+*/
+bool IsLowestFleetPeer(int index) {
+  for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+    if (i != index && peers[i].active && memcmp(peers[i].mac, peers[index].mac, 6) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+* Forgets peers not heard from within FLEET_LEASE_MS. Losing the poller this way hands the role to the next lowest MAC.
+*/
+void ExpireFleetPeers() {
+  for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+    if (peers[i].active && millis() - peers[i].lastHeard > FLEET_LEASE_MS) {
+      LOG_INFO("Peer %02X:%02X:%02X:%02X:%02X:%02X left", peers[i].mac[0], peers[i].mac[1], peers[i].mac[2], peers[i].mac[3], peers[i].mac[4], peers[i].mac[5]);
+      peers[i].active = false;
+    }
+  }
+}
+
+/*
+* Writes the first FLEET_TAG_LENGTH bytes of the HMAC-SHA256 of packet to tag.
+*/
+void SignFleetPacket(const uint8_t* packet, int length, uint8_t* tag) {
+  static const char key[] = SECRET_FLEET_KEY;
+  uint8_t digest[32];
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*) key, strlen(key), packet, length, digest);
+  memcpy(tag, digest, FLEET_TAG_LENGTH);
+}
+
+void PutFleetUint32(uint8_t* destination, uint32_t value) {
+  destination[0] = value >> 24;
+  destination[1] = value >> 16;
+  destination[2] = value >> 8;
+  destination[3] = value;
+}
+
+uint32_t GetFleetUint32(const uint8_t* source) {
+  return ((uint32_t) source[0] << 24) | ((uint32_t) source[1] << 16) | ((uint32_t) source[2] << 8) | source[3];
+}
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include "globals_t93.h"
 
-hd44780_I2Cexp _lcd(LCD_ADDRESS, LCD_COLUMNS, LCD_ROWS);
-char _currentValue[API_VALUE_COUNT][MAX_VALUE_LENGTH];
-bool _currentValueUpdated[API_VALUE_COUNT];
+MeteredLCD _lcd(LCD_ADDRESS, LCD_COLUMNS, LCD_ROWS);
+bool _currentValueUpdated[MAX_VALUE_SLOTS];
+unsigned long _currentValueFetchedAt[MAX_VALUE_SLOTS];
+bool _currentValueStale[MAX_VALUE_SLOTS];
 int _selectedValueIndex;
 DisplayDimmingMode _selectedDisplayMode;
+ValueViewMode _selectedViewMode;
 bool _lcdBacklightOn;
\ No newline at end of file
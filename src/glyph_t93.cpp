@@ -0,0 +1,116 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "log_t93.h"
+#include "glyph_t93.h"
+
+#define LOG_MODULE GLYPH
+
+static GlyphSlot glyphSlots[CGRAM_SLOTS];
+static uint32_t glyphClock = 0;                     // Counts acquisitions, for ordering slots by when they were last used.
+static uint32_t glyphUploads = 0;                   // Glyphs written to CGRAM since boot, each an I2C transfer of 9 bytes.
+static uint32_t glyphHits = 0;                      // Acquisitions served by a glyph already in CGRAM.
+
+/*
+* Marks every CGRAM slot empty, as its contents are unknown after the LCD is initialized.
+*/
+void InitializeGlyphs() {
+  memset(glyphSlots, 0, sizeof(glyphSlots));
+}
+
+/*
+* Maps a logical glyph to a CGRAM slot for display, returning the slot (its character code) or -1 if every slot is in use on display.
+* A glyph already in CGRAM is reused as is. Otherwise it is uploaded to an empty slot, or over the least recently used glyph not on display.
+* Each acquisition must be matched by a ReleaseGlyph() once the character is no longer displayed, or by ReleaseAllGlyphs() when the display is cleared.
+*/
+int AcquireGlyph(uint16_t id, const byte* pattern) {
+  glyphClock++;
+  for (int slot = 0; slot < CGRAM_SLOTS; slot++) {
+    if (glyphSlots[slot].id == id) {
+      glyphSlots[slot].users++;
+      glyphSlots[slot].lastUsed = glyphClock;
+      glyphHits++;
+      return slot;
+    }
+  }
+
+  int slot = FindEvictableGlyphSlot();
+  if (slot < 0) {
+    LOG_WARNING("No CGRAM slot free for glyph %04x", id);
+    return -1;
+  }
+
+  if (glyphSlots[slot].id != 0) {
+    LOG_DEBUG("Evicting glyph %04x from slot %d for %04x", glyphSlots[slot].id, slot, id);
+  }
+  _lcd.createChar(slot, pattern);
+  glyphUploads++;
+  glyphSlots[slot] = { id, 1, glyphClock };
+  LOG_DEBUG("Glyph %04x uploaded to slot %d, %u uploads and %u hits since boot", id, slot, glyphUploads, glyphHits);
+  return slot;
+}
+
+/*
+* Takes a slot for a glyph that will be rewritten in place with UpdateScratchGlyph(), returning the slot or -1 if none is free.
+* The slot's previous glyph is lost, so it is taken from the least recently used like any other.
+*/
+int AcquireScratchGlyph() {
+  glyphClock++;
+  int slot = FindEvictableGlyphSlot();
+  if (slot >= 0) {
+    glyphSlots[slot] = { GLYPH_ID(GlyphSetScratch, slot), 1, glyphClock };
+  }
+  return slot;
+}
+
+void UpdateScratchGlyph(int slot, const byte* pattern) {
+  _lcd.createChar(slot, pattern);
+  glyphUploads++;
+}
+
+/*
+* Records that one fewer character on display shows the given slot. Scratch slots are emptied, as their last frame is of no further use.
+*/
+void ReleaseGlyph(int slot) {
+  if (slot < 0 || glyphSlots[slot].users == 0) {
+    return;
+  }
+  glyphSlots[slot].users--;
+  if (glyphSlots[slot].users == 0 && glyphSlots[slot].id == GLYPH_ID(GlyphSetScratch, slot)) {
+    glyphSlots[slot].id = 0;
+  }
+}
+
+/*
+* Releases every slot, for when the display has been cleared. The glyphs stay in CGRAM, ready to be reused without uploading again.
+*/
+void ReleaseAllGlyphs() {
+  for (int slot = 0; slot < CGRAM_SLOTS; slot++) {
+    while (glyphSlots[slot].users > 0) {
+      ReleaseGlyph(slot);
+    }
+  }
+}
+
+/*
+* Returns the slot a new glyph should go in: an empty one if there is one, otherwise the least recently used not on display. -1 if all are on display.
+*/
+int FindEvictableGlyphSlot() {
+  int chosen = -1;
+  for (int slot = 0; slot < CGRAM_SLOTS; slot++) {
+    if (glyphSlots[slot].users > 0) {
+      continue;
+    }
+    if (glyphSlots[slot].id == 0) {
+      return slot;
+    }
+    if (chosen < 0 || glyphSlots[slot].lastUsed < glyphSlots[chosen].lastUsed) {
+      chosen = slot;
+    }
+  }
+  return chosen;
+}
+
+uint32_t GetGlyphUploads() {
+  return glyphUploads;
+}
\ No newline at end of file
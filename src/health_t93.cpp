@@ -0,0 +1,329 @@
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "globals_t93.h"
+#include "api_t93.h"
+#include "wifi_t93.h"
+#include "net_t93.h"
+#include "fleet_t93.h"
+#include "schedule_t93.h"
+#include "lcd_t93.h"
+#include "slots_t93.h"
+#include "series_t93.h"
+#include "log_t93.h"
+#include "profiler_t93.h"
+#include "health_t93.h"
+
+#define LOG_MODULE HEALTH
+
+// A sample of the heap, taken as a poll completes.
+struct HeapSample {
+  uint32_t time;                                    // The millis() it was taken at.
+  uint32_t freeHeap;
+  uint32_t largestBlock;
+};
+
+RTC_NOINIT_ATTR static HealthRetained retained;
+static volatile uint32_t heartbeatAt[HeartbeatCount]; // The millis() each heartbeat was last reported at, 0 until the first. Read from the monitor task.
+static uint16_t consecutiveFailures = 0;            // Polls failed in a row.
+static HeapSample heapRing[HEALTH_TREND_SAMPLES];   // Recent heap samples, oldest overwritten first.
+static uint8_t heapNewest = 0;
+static uint8_t heapCount = 0;
+static RecoveryLevel recoveryLevel = RecoveryNone;  // The last recovery step taken since the counter was last healthy.
+static unsigned long recoveredAt = 0;               // When that step was taken.
+
+/*
+* Explains the last reset, shows any values kept across it and starts watching for loop() stalling.
+* Must follow InitializeSlots(), as restored values are stored in the slots.
+*/
+void InitializeHealth() {
+  LOG_INFO("Initializing health monitor");
+  esp_reset_reason_t reason = esp_reset_reason();
+  bool valid = reason != ESP_RST_POWERON && retained.magic == HEALTH_RETAINED_MAGIC && retained.checksum == ChecksumRetained();
+  if (!valid) {
+    memset(&retained, 0, sizeof(retained));
+    retained.magic = HEALTH_RETAINED_MAGIC;
+  }
+
+  if (valid && retained.fault != FaultNone) {
+    LOG_WARNING("Restarted to recover from %s, %u restarts since the last successful poll",
+      GetHealthFaultName((HealthFault) retained.fault), retained.restarts);
+  }
+  else if (reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT) {
+    LOG_ERROR("Unexpected reset, reason %d", (int) reason);
+  }
+
+  if (valid && RestoreWarmStart()) {
+    LOG_INFO("Restored %d values held before the restart", GetSlotCount());
+  }
+  retained.fault = FaultNone;
+  retained.slotCount = 0;
+  retained.checksum = ChecksumRetained();
+
+  heartbeatAt[HeartbeatPoller] = millis();                                  // Gives the first poll a full HEALTH_POLLER_STALL_SECONDS.
+  xTaskCreatePinnedToCore(HealthMonitorTask, "health", 2048, nullptr, 1, nullptr, 0);
+}
+
+/*
+* Non-blocking check on the counter's health. While a fault persists, recovery steps are taken in order of how disruptive they are,
+* each given HEALTH_RECOVERY_GRACE_SECONDS to work before the next. The ladder starts over once the fault clears.
+* Restarts back off, so an API that is simply down doesn't cause one every few minutes.
+*/
+void ProcessHealth() {
+  PROFILE_SECTION(SectionHealth);
+  ReportHeartbeat(HeartbeatLoop);
+
+  HealthFault fault = DiagnoseHealth();
+  if (fault == FaultNone) {
+    if (recoveryLevel != RecoveryNone) {
+      LOG_INFO("Healthy again after recovery step %d", (int) recoveryLevel);
+      recoveryLevel = RecoveryNone;
+    }
+    return;
+  }
+
+  unsigned long grace = HEALTH_RECOVERY_GRACE_SECONDS * 1000UL;
+  if (recoveryLevel == RecoveryPoller) {
+    grace <<= min((int) retained.restarts, 6);
+  }
+  if (recoveryLevel != RecoveryNone && millis() - recoveredAt < grace) {
+    return;
+  }
+
+  RecoveryLevel next = (RecoveryLevel) min((int) recoveryLevel + 1, (int) RecoveryRestart);
+  PerformRecovery(next, fault);
+}
+
+/*
+* Records that the given subsystem is still making progress. Safe to call from any task.
+*/
+void ReportHeartbeat(HealthHeartbeat heartbeat) {
+  heartbeatAt[heartbeat] = max(millis(), 1UL);
+}
+
+/*
+* Records the outcome of a poll, which also counts as the poller's heartbeat. The heap is sampled here as well,
+* so every sample is taken with the connection in the same state.
+*/
+void ReportPollResult(bool fetched) {
+  ReportHeartbeat(HeartbeatPoller);
+  if (fetched) {
+    consecutiveFailures = 0;
+    if (retained.restarts != 0) {
+      retained.restarts = 0;
+      retained.checksum = ChecksumRetained();
+    }
+  }
+  else if (consecutiveFailures < UINT16_MAX) {
+    consecutiveFailures++;
+  }
+  SampleHeap();
+}
+
+/*
+* Returns the most pressing fault currently present, or FaultNone.
+*/
+HealthFault DiagnoseHealth() {
+  if (consecutiveFailures >= HEALTH_API_FAILURE_LIMIT) {
+    return FaultAPIFailures;
+  }
+  if (millis() - heartbeatAt[HeartbeatPoller] > HEALTH_POLLER_STALL_SECONDS * 1000UL) {
+    return FaultPollerStalled;
+  }
+  if (heapCount == 0) {
+    return FaultNone;
+  }
+
+  const HeapSample& newest = heapRing[heapNewest];
+  if (newest.freeHeap < HEALTH_MIN_FREE_HEAP || newest.largestBlock < HEALTH_MIN_HEAP_BLOCK) {
+    return FaultHeapLow;
+  }
+  int32_t freeTrend, blockTrend;
+  if (GetHeapTrend(&freeTrend, &blockTrend) && freeTrend < 0
+    && (int64_t) newest.freeHeap + (int64_t) freeTrend * HEALTH_LEAK_HORIZON_HOURS < HEALTH_MIN_FREE_HEAP) {
+    return FaultHeapLeak;
+  }
+  return FaultNone;
+}
+
+/*
+* Takes the given recovery step for the given fault. Each step also undoes those before it, so is worth taking even if they didn't help.
+*/
+void PerformRecovery(RecoveryLevel level, HealthFault fault) {
+  LOG_WARNING("Unhealthy (%s), recovery step %d", GetHealthFaultName(fault), (int) level);
+
+  switch (level) {
+    case RecoveryHTTPClient:
+      CloseAPIConnection();                                                 // Also frees the memory held by the TLS session.
+      InvalidateDNSCache();
+      break;
+
+    case RecoveryWiFi:
+      CloseAPIConnection();
+      InvalidateDNSCache();
+      WiFi.disconnect();
+      ReconnectWiFi();                                                      // Never opens the portal, which would leave the counter offline waiting on it.
+      break;
+
+    case RecoveryPoller:
+      CloseAPIConnection();
+      InitializeAPIConnection();
+      InvalidateDNSCache();
+      InitializeSchedule();
+      InitializeFleet();
+      break;
+
+    default:
+      retained.restarts++;
+      SaveWarmStart(fault);
+      WriteToLCD("Recovering", "restarting...");
+      FlushSeries();
+      delay(1000);
+      FlushLog(1000);
+      ESP.restart();
+  }
+
+  recoveryLevel = level;
+  recoveredAt = millis();
+  heartbeatAt[HeartbeatPoller] = millis();                                  // Stalls are measured from the recovery, not from before it.
+  ClearHeapTrend();                                                         // So a leak must show again after the recovery to count.
+}
+
+/*
+* Records the free heap and its largest block, logging them with their trends.
+*/
+void SampleHeap() {
+  heapNewest = heapCount == 0 ? 0 : (heapNewest + 1) % HEALTH_TREND_SAMPLES;
+  heapCount = min(heapCount + 1, HEALTH_TREND_SAMPLES);
+  heapRing[heapNewest] = {
+    (uint32_t) millis(),
+    (uint32_t) heap_caps_get_free_size(MALLOC_CAP_DEFAULT),
+    (uint32_t) heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT)
+  };
+
+  int32_t freeTrend, blockTrend;
+  if (GetHeapTrend(&freeTrend, &blockTrend)) {
+    LOG_INFO("Free heap: %u (%+ld/h), largest free block: %u (%+ld/h)", heapRing[heapNewest].freeHeap, (long) freeTrend,
+      heapRing[heapNewest].largestBlock, (long) blockTrend);
+  }
+  else {
+    LOG_INFO("Free heap: %u, largest free block: %u", heapRing[heapNewest].freeHeap, heapRing[heapNewest].largestBlock);
+  }
+}
+
+void ClearHeapTrend() {
+  heapCount = 0;
+}
+
+/*
+* Sets freeTrend and blockTrend to how fast free heap and its largest block are changing, in bytes per hour.
+* Each is the least squares slope across the samples held, so a single poll holding more memory than usual barely moves it.
+* Returns false until HEALTH_TREND_SAMPLES samples have been taken.
+*/
+bool GetHeapTrend(int32_t* freeTrend, int32_t* blockTrend) {
+  if (heapCount < HEALTH_TREND_SAMPLES) {
+    return false;
+  }
+
+  int oldest = (heapNewest + 1) % HEALTH_TREND_SAMPLES;
+  int64_t sumTime = 0, sumTimeSquared = 0, sumFree = 0, sumBlock = 0, sumTimeFree = 0, sumTimeBlock = 0;
+  for (int i = 0; i < HEALTH_TREND_SAMPLES; i++) {
+    const HeapSample& sample = heapRing[(oldest + i) % HEALTH_TREND_SAMPLES];
+    int64_t time = (sample.time - heapRing[oldest].time) / 1000;             // Seconds from the oldest sample.
+    sumTime += time;
+    sumTimeSquared += time * time;
+    sumFree += sample.freeHeap;
+    sumBlock += sample.largestBlock;
+    sumTimeFree += time * sample.freeHeap;
+    sumTimeBlock += time * sample.largestBlock;
+  }
+
+  int64_t spread = HEALTH_TREND_SAMPLES * sumTimeSquared - sumTime * sumTime;
+  if (spread == 0) {
+    return false;
+  }
+  *freeTrend = (HEALTH_TREND_SAMPLES * sumTimeFree - sumTime * sumFree) * 3600 / spread;
+  *blockTrend = (HEALTH_TREND_SAMPLES * sumTimeBlock - sumTime * sumBlock) * 3600 / spread;
+  return true;
+}
+
+/*
+* Watches loop() from the other core. If it stops reporting its heartbeat nothing run from it can recover, so the ESP is restarted.
+* The values are copied across from here as loop() is stuck and won't touch them.
+*/
+void HealthMonitorTask(void* parameter) {
+  while (true) {
+    delay(1000);
+    uint32_t loopAt = heartbeatAt[HeartbeatLoop];
+    if (loopAt != 0 && millis() - loopAt > HEALTH_LOOP_STALL_SECONDS * 1000UL) {
+      LOG_ERROR("loop() stalled for %lu ms, restarting", millis() - loopAt);
+      retained.restarts++;
+      SaveWarmStart(FaultLoopStalled);
+      FlushLog(1000);
+      ESP.restart();
+    }
+  }
+}
+
+/*
+* Copies the values held, and the fault that led to the restart about to be made, into RTC memory.
+*/
+void SaveWarmStart(HealthFault fault) {
+  retained.fault = fault;
+  retained.slotCount = GetSlotCount();
+  int used = 0;
+  for (int i = 0; i < retained.slotCount; i++) {
+    retained.valueAges[i] = _currentValueFetchedAt[i] == 0 ? UINT32_MAX : millis() - _currentValueFetchedAt[i];
+    int size = strlen(GetSlotValue(i)) + 1;                                 // Values share SLOT_ARENA_SIZE with their labels in the slots, so always fit.
+    memcpy(retained.values + used, GetSlotValue(i), size);
+    used += size;
+  }
+  retained.checksum = ChecksumRetained();
+}
+
+/*
+* Puts back the values saved before a restart, marked stale and aged by when they were fetched, so they are shown until the first poll
+* replaces them and expire as they would have without the restart. Returns false if there were none.
+*/
+bool RestoreWarmStart() {
+  if (retained.slotCount == 0 || retained.slotCount > MAX_VALUE_SLOTS) {
+    return false;
+  }
+
+  SetSlotCount(retained.slotCount);
+  const char* value = retained.values;
+  for (int i = 0; i < GetSlotCount(); i++) {
+    SetSlotValue(i, value);
+    value += strlen(value) + 1;
+    if (retained.valueAges[i] != UINT32_MAX) {
+      _currentValueFetchedAt[i] = max(millis() - retained.valueAges[i], 1UL);   // Wraps if older than the uptime, which the age checks allow for.
+    }
+    _currentValueStale[i] = true;
+    _currentValueUpdated[i] = true;
+  }
+  return true;
+}
+
+/*
+* FNV-1a over the retained state, excluding the checksum itself.
+*/
+uint32_t ChecksumRetained() {
+  const uint8_t* bytes = (const uint8_t*) &retained;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(HealthRetained, checksum); i++) {
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+const char* GetHealthFaultName(HealthFault fault) {
+  switch (fault) {
+    case FaultAPIFailures: return "API failures";
+    case FaultPollerStalled: return "poller stalled";
+    case FaultHeapLow: return "heap low";
+    case FaultHeapLeak: return "heap leak";
+    case FaultLoopStalled: return "loop stalled";
+    default: return "none";
+  }
+}
\ No newline at end of file
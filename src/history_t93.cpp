@@ -0,0 +1,174 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "history_t93.h"
+
+static HistorySample historyRing[MAX_VALUE_SLOTS][HISTORY_SAMPLES];  // Recent samples of each slot's value, oldest overwritten first.
+static uint8_t historyNewest[MAX_VALUE_SLOTS];      // Where each slot's newest sample is in its ring.
+static uint8_t historyCount[MAX_VALUE_SLOTS];       // How many samples each slot's ring holds.
+static int32_t historyDelta[MAX_VALUE_SLOTS];       // The change between each slot's two newest samples.
+static int64_t historyRate[MAX_VALUE_SLOTS];        // Each slot's rate of change across its ring, per hour in fixed point (see HISTORY_RATE_SCALE).
+
+/*
+* Forgets the samples held for the given slot, e.g. when it is reused for a different value.
+*/
+void ClearHistory(int index) {
+  historyNewest[index] = 0;
+  historyCount[index] = 0;
+  historyDelta[index] = 0;
+  historyRate[index] = 0;
+}
+
+/*
+* Samples a value fetched for the given slot, if it is numeric. Returns false if it isn't, leaving the history unchanged.
+* Samples are kept at least HISTORY_SAMPLE_SECONDS apart by replacing the newest sample until it is that far from the one before.
+* The delta and rate are updated from the ends of the ring, so each sample costs the same however many are held.
+*/
+bool RecordHistorySample(int index, const char* text) {
+  int32_t value;
+  if (!ParseHistoryValue(text, &value)) {
+    return false;
+  }
+
+  int count = historyCount[index];
+  int newest = historyNewest[index];
+  int previous = (newest + HISTORY_SAMPLES - 1) % HISTORY_SAMPLES;
+  bool settled = count < 2 || historyRing[index][newest].time - historyRing[index][previous].time >= HISTORY_SAMPLE_SECONDS * 1000UL;
+  if (count == 0) {
+    newest = 0;
+    count = 1;
+  }
+  else if (settled) {
+    newest = (newest + 1) % HISTORY_SAMPLES;
+    count = min(count + 1, HISTORY_SAMPLES);
+  }
+
+  historyRing[index][newest] = { (uint32_t) millis(), value };
+  historyNewest[index] = newest;
+  historyCount[index] = count;
+  if (count < 2) {
+    return true;
+  }
+
+  previous = (newest + HISTORY_SAMPLES - 1) % HISTORY_SAMPLES;
+  const HistorySample& oldest = historyRing[index][(newest + HISTORY_SAMPLES - count + 1) % HISTORY_SAMPLES];
+  historyDelta[index] = value - historyRing[index][previous].value;
+  uint32_t elapsed = historyRing[index][newest].time - oldest.time;
+  historyRate[index] = elapsed == 0 ? 0 : ((int64_t) value - oldest.value) * HISTORY_RATE_SCALE * 3600000LL / elapsed;
+  return true;
+}
+
+int GetHistoryCount(int index) {
+  return historyCount[index];
+}
+
+/*
+* Returns the given slot's sample at position (0 being the oldest held).
+*/
+HistorySample GetHistorySample(int index, int position) {
+  int oldest = (historyNewest[index] + HISTORY_SAMPLES - historyCount[index] + 1) % HISTORY_SAMPLES;
+  return historyRing[index][(oldest + position) % HISTORY_SAMPLES];
+}
+
+int32_t GetHistoryDelta(int index) {
+  return historyDelta[index];
+}
+
+/*
+* Sets rate to the given slot's rate of change per hour, in multiples of 1 / HISTORY_RATE_SCALE. Divide by 60 for per minute.
+* Returns false if there aren't yet two samples to measure it from.
+*/
+bool GetHistoryRate(int index, int64_t* rate) {
+  if (historyCount[index] < 2) {
+    return false;
+  }
+  *rate = historyRate[index];
+  return true;
+}
+
+/*
+* Formats the given slot's rate of change for display, e.g. "+123/h", "-2.5/h" or "+1520/m" for fast changing values.
+* Returns false, formatting a placeholder, if there aren't yet two samples to measure it from.
+*/
+bool FormatHistoryTrend(int index, char* text, int size) {
+  int64_t rate;
+  if (!GetHistoryRate(index, &rate)) {
+    snprintf(text, size, "--/h");
+    return false;
+  }
+
+  const char* unit = "/h";
+  if (rate >= 100000LL * HISTORY_RATE_SCALE || rate <= -100000LL * HISTORY_RATE_SCALE) {
+    rate /= 60;
+    unit = "/m";
+  }
+  char sign = rate < 0 ? '-' : '+';
+  uint64_t magnitude = min((uint64_t) (rate < 0 ? -rate : rate), (uint64_t) UINT32_MAX * HISTORY_RATE_SCALE);
+
+  if (magnitude < 10 * HISTORY_RATE_SCALE) {                                // Small rates get a decimal place, so slow counters don't read as +0/h.
+    unsigned long tenths = (magnitude * 10 + HISTORY_RATE_SCALE / 2) / HISTORY_RATE_SCALE;
+    snprintf(text, size, "%c%lu.%lu%s", sign, tenths / 10, tenths % 10, unit);
+  }
+  else {
+    snprintf(text, size, "%c%lu%s", sign, (unsigned long) ((magnitude + HISTORY_RATE_SCALE / 2) / HISTORY_RATE_SCALE), unit);
+  }
+  return true;
+}
+
+/*
+* Scales the given slot's newest samples (up to width of them) between its lowest and highest, as bar heights from 0 to SPARKLINE_LEVELS - 1.
+* Levels are written oldest first. Returns the number written.
+*/
+int GetSparklineLevels(int index, uint8_t* levels, int width) {
+  int count = min((int) historyCount[index], width);
+  int first = historyCount[index] - count;
+  int32_t lowest = INT32_MAX;
+  int32_t highest = INT32_MIN;
+  for (int i = 0; i < count; i++) {
+    int32_t value = GetHistorySample(index, first + i).value;
+    lowest = min(lowest, value);
+    highest = max(highest, value);
+  }
+
+  for (int i = 0; i < count; i++) {
+    int64_t offset = (int64_t) GetHistorySample(index, first + i).value - lowest;
+    levels[i] = highest == lowest ? 0 : offset * (SPARKLINE_LEVELS - 1) / ((int64_t) highest - lowest);
+  }
+  return count;
+}
+
+/*
+* Parses the whole number at the start of a value, skipping thousands separators (e.g. "1,234,567" or "-12 345").
+* Any fractional part or suffix is ignored. Returns false if the value doesn't start with a number or it doesn't fit in 32 bits.
+*/
+bool ParseHistoryValue(const char* text, int32_t* value) {
+  while (*text == ' ') {
+    text++;
+  }
+  bool negative = *text == '-';
+  if (*text == '-' || *text == '+') {
+    text++;
+  }
+
+  int64_t magnitude = 0;
+  bool digits = false;
+  for (; *text != '\0'; text++) {
+    if (*text >= '0' && *text <= '9') {
+      magnitude = magnitude * 10 + (*text - '0');
+      digits = true;
+      if (magnitude > (int64_t) INT32_MAX + 1) {
+        return false;
+      }
+    }
+    else if (!(digits && (*text == ',' || *text == ' ' || *text == '_'))) {
+      break;
+    }
+  }
+
+  int64_t result = negative ? -magnitude : magnitude;
+  if (!digits || result > INT32_MAX) {
+    return false;
+  }
+  *value = (int32_t) result;
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <Update.h>
+#include "mbedtls/sha256.h"
+
+#include "globals_t93.h"
+#include "decode_t93.h"
+#include "log_t93.h"
+#include "image_t93.h"
+
+#define LOG_MODULE IMAGE
+
+FirmwareWriter::FirmwareWriter() :
+  _length(0) {
+  mbedtls_sha256_init(&_sha);
+  mbedtls_sha256_starts_ret(&_sha, 0);                                      // 0 selects SHA-256 rather than SHA-224.
+}
+
+FirmwareWriter::~FirmwareWriter() {
+  mbedtls_sha256_free(&_sha);
+}
+
+size_t FirmwareWriter::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+/*
+* Hashes and flashes the next piece of the image. Returns fewer bytes than given if flashing fails, which stops the download.
+*/
+size_t FirmwareWriter::write(const uint8_t* data, size_t size) {
+  size_t written = Update.write((uint8_t*) data, size);
+  mbedtls_sha256_update_ret(&_sha, data, written);
+  _length += written;
+  return written;
+}
+
+/*
+* Writes the SHA-256 of everything written so far to hash (32 bytes).
+*/
+void FirmwareWriter::digest(uint8_t* hash) {
+  mbedtls_sha256_finish_ret(&_sha, hash);
+}
+
+size_t FirmwareWriter::length() {
+  return _length;
+}
+
+/*
+* Finishes decoding a downloaded image into the writer and checks it against the SHA-256 it was sent with.
+* Returns false, having logged why, if the download was incomplete or corrupt or the image isn't the one expected.
+*/
+bool FinishFirmwareImage(PayloadDecoder& decoder, FirmwareWriter& writer, const uint8_t* expectedHash) {
+  uint8_t actualHash[32];
+  bool finished = decoder.finish();
+  writer.digest(actualHash);
+  if (!finished) {
+    LOG_WARNING("Firmware download incomplete or corrupt (%s)", Update.errorString());
+    return false;
+  }
+  if (memcmp(actualHash, expectedHash, sizeof(actualHash)) != 0) {
+    LOG_WARNING("Firmware hash mismatch");
+    return false;
+  }
+  return true;
+}
+
+/*
+* Parses 64 hex characters into a 32 byte hash. Returns false if the text isn't a SHA-256 in hex.
+*/
+bool ParseImageHash(const char* text, uint8_t* hash) {
+  if (strlen(text) != 64 || strspn(text, "0123456789abcdefABCDEF") != 64) {  // strtoul() alone would also take signs and spaces.
+    return false;
+  }
+
+  for (int i = 0; i < 32; i++) {
+    char byteText[3] = { text[i * 2], text[i * 2 + 1], '\0' };
+    hash[i] = strtoul(byteText, nullptr, 16);
+  }
+  return true;
+}
+
+/*
+* Formats a 32 byte hash as 64 lowercase hex characters and a null terminator.
+*/
+void FormatImageHash(const uint8_t* hash, char* text) {
+  for (int i = 0; i < 32; i++) {
+    sprintf(text + i * 2, "%02x", hash[i]);
+  }
+}
+
+/*
+* Formats a 32 byte hash as the image's entity tag, i.e. its hex in quotes (67 characters with the null terminator).
+* The server uses the image's SHA-256 as its ETag, so this is what If-None-Match carries to identify the running image.
+*/
+void FormatImageTag(const uint8_t* hash, char* tag) {
+  tag[0] = '"';
+  FormatImageHash(hash, tag + 1);
+  strcpy(tag + 65, "\"");
+}
\ No newline at end of file
@@ -1,89 +1,383 @@
+#include <elapsedMillis.h>
+
 #include "globals_t93.h"
 #include "secrets_t93.h"
 #include "ldr_t93.h"
+#include "log_t93.h"
 #include "lcd_t93.h"
+#include "cache_t93.h"
+#include "slots_t93.h"
+#include "history_t93.h"
+#include "glyph_t93.h"
+#include "panels_t93.h"
+#include "profiler_t93.h"
+
+#define LOG_MODULE LCD
+
+static int renderedValueIndex = -1;                 // The value index currently rendered on the display, or -1 if the display is showing something else (e.g. a message).
+static char renderedValue[MAX_VALUE_LENGTH];        // The value text currently rendered on the lower row. Diffed against new values for odometer updates.
+static char writtenBottomRow[LCD_DDRAM_COLUMNS + 1]; // The text written to the lower row, so whatever the polling indicator covers can be restored.
+static bool marqueeActive = false;                  // Whether the display is scrolling because a row is wider than the LCD.
+static int marqueeOffset = 0;                       // How many columns the display has been shifted left by. Wraps at LCD_DDRAM_COLUMNS.
+static elapsedMillis marqueeTimer;                  // Time since the display last shifted.
+static int indicatorColumn = -1;                    // The display RAM column the polling or stale indicator was drawn in, or -1 if neither is on display.
+static bool indicatorPolling = false;               // Whether the indicator drawn is the polling dot rather than the stale indicator.
+static bool bigDigitsShown = false;                 // Whether the display holds big digits, which are then updated in place.
+static uint16_t bigDigitCells[LCD_ROWS][LCD_COLUMNS - 1]; // What each column of big digits shows (see LayoutBigDigits()).
+static int8_t bigDigitSlots[LCD_ROWS][LCD_COLUMNS - 1]; // The CGRAM slot acquired for each column of big digits, -1 for ROM characters.
 
 /*
 * Initializes I2C comms with the LCD. Sets backlight according to users preferences.
 */
 void InitializeLCD() {
-  DEBUG_SERIAL.println("Initializing LCD");
+  LOG_INFO("Initializing LCD");
   
   _lcd.init();
+  Wire.setClock(I2C_CLOCK_HZ);
   if (_selectedDisplayMode == On) {
-    DEBUG_SERIAL.println("LCD backlight config set to Always On");
+    LOG_INFO("LCD backlight config set to Always On");
     _lcd.backlight();
     _lcdBacklightOn = true;
   }
   else if (_selectedDisplayMode == Off) {
-    DEBUG_SERIAL.println("LCD backlight config set to Always Off");
+    LOG_INFO("LCD backlight config set to Always Off");
     _lcd.noBacklight();
     _lcdBacklightOn = false;
   }
   else if (_selectedDisplayMode == Auto && LDRBelowDarkRoomThreshold()) {
-    DEBUG_SERIAL.print("LCD backlight config set to Auto and LDR reading is: ");
-    DEBUG_SERIAL.println(analogRead(LDR_PIN));
+    LOG_INFO("LCD backlight config set to Auto and LDR reading is: %d", analogRead(LDR_PIN));
     _lcd.noBacklight();
     _lcdBacklightOn = false;
   }
   else if (_selectedDisplayMode == Auto && !LDRBelowDarkRoomThreshold()) {
-    DEBUG_SERIAL.print("LCD backlight config set to Auto and LDR reading is: ");
-    DEBUG_SERIAL.println(analogRead(LDR_PIN));
+    LOG_INFO("LCD backlight config set to Auto and LDR reading is: %d", analogRead(LDR_PIN));
     _lcd.backlight();
     _lcdBacklightOn = true;
   }  
   
-  // Import the custom chars into the LCD config.
-  DEBUG_SERIAL.println("Importing LCD custom characters");
-  for (int i = 0; i < LEN(animationCustomChars); i++) {
-    _lcd.createChar(i, animationCustomChars[i]);
-  }
-  
-  DEBUG_SERIAL.println("LCD initialized");
+  InitializeGlyphs();
+  LOG_INFO("LCD initialized");
 }
 
 void ProcessDisplayValueUpdate(bool override) {
-  if (_currentValueUpdated[_selectedValueIndex] || override) {
-    if (!override) {
-      DEBUG_SERIAL.println("Updated value found for writing to LCD");
-      WriteToLCD(_valueLabel[_selectedValueIndex], _currentValue[_selectedValueIndex], true);
+  PROFILE_SECTION(SectionDisplayValueUpdate);
+  if ((_currentValueUpdated[_selectedValueIndex] || override) && _selectedViewMode != ViewValue) {
+    WriteValueView();                                                       // Trends and sparklines are redrawn in place, without animation.
+    renderedValueIndex = _selectedValueIndex;
+    strncpy(renderedValue, GetSlotValue(_selectedValueIndex), MAX_VALUE_LENGTH);
+    DrawPollIndicator(false);
+    _currentValueUpdated[_selectedValueIndex] = false;
+  }
+  else if (_currentValueUpdated[_selectedValueIndex] || override) {
+    bool fitsDisplay = strlen(renderedValue) < LCD_COLUMNS && strlen(GetSlotValue(_selectedValueIndex)) < LCD_COLUMNS;
+    if (!override && ODOMETER_UPDATES && renderedValueIndex == _selectedValueIndex && fitsDisplay) {
+      LOG_DEBUG("Updated value found, rolling changed digits");
+      PerformOdometerUpdate(renderedValue, GetSlotValue(_selectedValueIndex));
+      strncpy(writtenBottomRow, GetSlotValue(_selectedValueIndex), LCD_DDRAM_COLUMNS);
+    }
+    else if (!override) {
+      LOG_DEBUG("Updated value found for writing to LCD");
+      WriteToLCD(GetSlotLabel(_selectedValueIndex), GetSlotValue(_selectedValueIndex), true);
     }
     else {
-      DEBUG_SERIAL.println("Override option passed, refreshing with known values");
-      WriteToLCD(_valueLabel[_selectedValueIndex], _currentValue[_selectedValueIndex], false);
+      LOG_DEBUG("Override option passed, refreshing with known values");
+      WriteToLCD(GetSlotLabel(_selectedValueIndex), GetSlotValue(_selectedValueIndex), false);
     }
+    if (strlen(GetSlotValue(_selectedValueIndex)) > LCD_COLUMNS - 1) {       // Long values scroll rather than run underneath the polling indicator.
+      ResetMarquee(true);
+    }
+    renderedValueIndex = _selectedValueIndex;                               // Set after WriteToLCD() as any write marks the value as no longer rendered.
+    strncpy(renderedValue, GetSlotValue(_selectedValueIndex), MAX_VALUE_LENGTH);
+    DrawPollIndicator(false);                                               // Shows the stale indicator if the value is from cache.
     _currentValueUpdated[_selectedValueIndex] = false;
   }
 }
 
+/*
+* Draws the selected value in the selected view mode other than ViewValue, which ProcessDisplayValueUpdate() draws itself.
+* The trend view shows the value and its rate of change on the lower row, or just the rate if both don't fit.
+* The sparkline view moves the rate up beside the label, making room for a sparkline of the recent values.
+* The big digit view fills both rows with the value, falling back to the label and value if it won't fit.
+*/
+void WriteValueView() {
+  if (_selectedViewMode == ViewBigDigits) {
+    if (!WriteBigDigits(GetSlotValue(_selectedValueIndex))) {
+      WriteToLCD(GetSlotLabel(_selectedValueIndex), GetSlotValue(_selectedValueIndex));
+    }
+    return;
+  }
+
+  char trend[LCD_COLUMNS + 1];
+  FormatHistoryTrend(_selectedValueIndex, trend, sizeof(trend));
+
+  if (_selectedViewMode == ViewTrend) {
+    char bottomRow[LCD_COLUMNS];                                            // The last column is reserved for the API polling indicator.
+    const char* value = GetSlotValue(_selectedValueIndex);
+    if ((int) (strlen(value) + 1 + strlen(trend)) < LCD_COLUMNS) {
+      snprintf(bottomRow, sizeof(bottomRow), "%s %s", value, trend);
+    }
+    else {
+      snprintf(bottomRow, sizeof(bottomRow), "%s", trend);
+    }
+    WriteToLCD(GetSlotLabel(_selectedValueIndex), bottomRow);
+    return;
+  }
+
+  char topRow[LCD_COLUMNS + 1];
+  int labelWidth = max(LCD_COLUMNS - (int) strlen(trend) - 1, 0);
+  snprintf(topRow, sizeof(topRow), "%-*.*s %s", labelWidth, labelWidth, GetSlotLabel(_selectedValueIndex), trend);
+
+  uint8_t levels[HISTORY_SAMPLES];
+  int count = GetSparklineLevels(_selectedValueIndex, levels, HISTORY_SAMPLES);
+  WriteToLCD(topRow, count > 0 ? "" : "No history yet");
+
+  for (int i = 0; i < count; i++) {                                         // Bars are acquired after WriteToLCD(), as clearing the display releases every glyph.
+    byte glyph[8];
+    for (int row = 0; row < 8; row++) {                                     // Level n lights the bottom n + 1 pixel rows.
+      glyph[row] = row >= 7 - levels[i] ? 0x1F : 0x00;
+    }
+    int slot = AcquireGlyph(GLYPH_ID(GlyphSetSparkline, levels[i]), glyph);  // Only uploaded if the bar isn't already in CGRAM.
+    _lcd.setCursor(i, 1);
+    _lcd.write(slot >= 0 ? slot : '_');
+  }
+}
+
+/*
+* Draws a value in digits two rows high, returning false if it won't fit (see LayoutBigDigits()).
+* After the first draw only the columns that change are written, and each new column's glyph is acquired before the old is released,
+* so segments shared between the old and new value stay in CGRAM. A typical update uploads nothing.
+*/
+bool WriteBigDigits(const char* value) {
+  uint16_t cells[LCD_ROWS][LCD_COLUMNS - 1];
+  if (!LayoutBigDigits(value, cells)) {
+    return false;
+  }
+
+  uint32_t uploads = GetGlyphUploads();
+  if (!bigDigitsShown) {
+    ClearLCD();
+    ResetMarquee(false);
+    writtenBottomRow[0] = '\0';
+    for (int row = 0; row < LCD_ROWS; row++) {
+      for (int column = 0; column < LCD_COLUMNS - 1; column++) {
+        bigDigitCells[row][column] = ' ';                                   // As left by the clear.
+        bigDigitSlots[row][column] = -1;
+      }
+    }
+    bigDigitsShown = true;
+  }
+
+  int8_t oldSlots[LCD_ROWS][LCD_COLUMNS - 1];
+  memcpy(oldSlots, bigDigitSlots, sizeof(oldSlots));
+  for (int row = 0; row < LCD_ROWS; row++) {
+    for (int column = 0; column < LCD_COLUMNS - 1; column++) {
+      uint16_t cell = cells[row][column];
+      if (cell == bigDigitCells[row][column]) {
+        oldSlots[row][column] = -1;                                         // Unchanged, keeps its slot.
+        continue;
+      }
+
+      int slot = -1;
+      if (cell > 0xFF) {
+        slot = AcquireGlyph(cell, bigDigitSegments[cell & 0xFF]);
+      }
+      _lcd.setCursor(column, row);
+      _lcd.write(cell > 0xFF ? (slot >= 0 ? slot : 0xFF) : cell);             // A full block stands in if no slot could be had.
+      bigDigitCells[row][column] = cell;
+      bigDigitSlots[row][column] = slot;
+    }
+  }
+
+  for (int row = 0; row < LCD_ROWS; row++) {
+    for (int column = 0; column < LCD_COLUMNS - 1; column++) {
+      ReleaseGlyph(oldSlots[row][column]);
+    }
+  }
+  LOG_DEBUG("Big digits drawn for %s, %u glyph uploads", value, GetGlyphUploads() - uploads);
+  return true;
+}
+
+/*
+* Lays out a value as big digits across both rows of every column but the last, right aligned like a counter.
+* Each cell is a ROM character, or the GLYPH_ID() of a big digit segment. Digits are 3 columns wide, separated by a blank column
+* where there's room. Separators ('.', ',', ':', '-' and spaces) take one column, and thousands separators are dropped if need be.
+* Returns false if the value holds any other character or is too long.
+*/
+bool LayoutBigDigits(const char* value, uint16_t cells[LCD_ROWS][LCD_COLUMNS - 1]) {
+  static const int width = LCD_COLUMNS - 1;                                 // The last column is reserved for the API polling indicator.
+  int length = strlen(value);
+  while (length > 0 && value[length - 1] == ' ') {
+    length--;
+  }
+  while (length > 0 && *value == ' ') {
+    value++;
+    length--;
+  }
+  if (length == 0) {
+    return false;
+  }
+
+  for (int attempt = 0; attempt < 3; attempt++) {                           // Spaced digits, then digits touching, then without thousands separators.
+    bool spaced = attempt == 0;
+    bool grouped = attempt < 2;
+    int needed = 0;
+    bool previousDigit = false;
+    for (int i = 0; i < length; i++) {
+      char character = value[i];
+      bool digit = character >= '0' && character <= '9';
+      if (!digit && !strchr(".,:- ", character)) {
+        return false;
+      }
+      if (!grouped && (character == ',' || character == ' ')) {
+        continue;
+      }
+      needed += digit ? BIG_DIGIT_WIDTH + (spaced && previousDigit ? 1 : 0) : 1;
+      previousDigit = digit;
+    }
+    if (needed > width) {
+      continue;
+    }
+
+    int column = width - needed;
+    for (int fill = 0; fill < column; fill++) {
+      cells[0][fill] = ' ';
+      cells[1][fill] = ' ';
+    }
+    previousDigit = false;
+    for (int i = 0; i < length; i++) {
+      char character = value[i];
+      bool digit = character >= '0' && character <= '9';
+      if (!grouped && (character == ',' || character == ' ')) {
+        continue;
+      }
+      if (digit && spaced && previousDigit) {
+        cells[0][column] = ' ';
+        cells[1][column] = ' ';
+        column++;
+      }
+      if (digit) {
+        for (int part = 0; part < BIG_DIGIT_WIDTH; part++, column++) {
+          for (int row = 0; row < LCD_ROWS; row++) {
+            uint8_t code = bigDigitFont[character - '0'][row][part];
+            cells[row][column] = code < LEN(bigDigitSegments) ? GLYPH_ID(GlyphSetBigDigit, code) : code;
+          }
+        }
+      }
+      else {
+        cells[0][column] = character == '-' ? GLYPH_ID(GlyphSetBigDigit, BIG_DIGIT_MINUS) : ' ';  // Separators sit on the lower row, a minus at mid height.
+        cells[1][column] = character == '-' ? ' ' : character;
+        column++;
+      }
+      previousDigit = digit;
+    }
+    return true;
+  }
+  return false;
+}
+
+/*
+* Clears the display, releasing every glyph it showed.
+*/
+void ClearLCD() {
+  _lcd.clear();                                                             // Also returns the display shift to home.
+  ReleaseAllGlyphs();
+  bigDigitsShown = false;
+}
+
 /*
 * Writes provided text to the top and bottom rows of the LCD.
 * If animation is specified, that will play prior to the update.
+* Rows wider than the LCD are written in full to display RAM and scrolled by ProcessMarquee().
 */
 void WriteToLCD(const char* topRow, const char* bottomRow, bool animate) {
+  PROFILE_SECTION(SectionWriteToLCD);
   if (animate) {
     PerformLCDAnimation();
   }
+  renderedValueIndex = -1;
 
-  DEBUG_SERIAL.print("LCD write: ");
-  DEBUG_SERIAL.print(topRow);
-  if (strcmp(bottomRow, "") != 0) {
-    DEBUG_SERIAL.print(" ");
-  }
-  DEBUG_SERIAL.println(bottomRow);
-  _lcd.clear();
+  LOG_INFO("LCD write: %s%s%s", topRow, strcmp(bottomRow, "") != 0 ? " " : "", bottomRow);
+  ClearLCD();
   _lcd.setCursor(0, 0);
   _lcd.print(topRow);
   _lcd.setCursor(0, 1);
   _lcd.print(bottomRow);
+
+  strncpy(writtenBottomRow, bottomRow, LCD_DDRAM_COLUMNS);
+  writtenBottomRow[LCD_DDRAM_COLUMNS] = '\0';
+  ResetMarquee(strlen(topRow) > LCD_COLUMNS || strlen(bottomRow) > LCD_COLUMNS);
+}
+
+/*
+* Returns the scroll position to the start and enables or disables scrolling.
+* The display itself must already be at its home position, as it is after a clear.
+*/
+void ResetMarquee(bool active) {
+  marqueeActive = active;
+  marqueeOffset = 0;
+  marqueeTimer = 0;
+  indicatorColumn = -1;                                                     // Cleared along with the display.
+}
+
+/*
+* Non-blocking scroll of text wider than the LCD.
+* The text is only sent over I2C once, by WriteToLCD(). Each step here is a single display shift command,
+* plus moving the polling or stale indicator back into the last column if one is shown.
+*/
+void ProcessMarquee() {
+  PROFILE_SECTION(SectionMarquee);
+  if (!marqueeActive) {
+    return;
+  }
+
+  unsigned long holdTime = marqueeOffset == 0 ? MARQUEE_PAUSE_MS : MARQUEE_STEP_MS;  // Hold at the start of the text before each pass so it can be read.
+  if (marqueeTimer >= holdTime) {
+    _lcd.scrollDisplayLeft();
+    marqueeOffset = (marqueeOffset + 1) % LCD_DDRAM_COLUMNS;
+    marqueeTimer = 0;
+    if (indicatorColumn >= 0) {                                             // The shift moved the indicator left with the text.
+      _lcd.setCursor(indicatorColumn, 1);
+      _lcd.write(indicatorColumn < (int) strlen(writtenBottomRow) ? writtenBottomRow[indicatorColumn] : ' ');
+      DrawPollIndicator(indicatorPolling);
+    }
+  }
+}
+
+/*
+* Shows or hides the dot in the bottom right of the display that indicates the API is being polled.
+* The dot is written to whichever display RAM column is currently shifted into the last column. As the display shift carries it
+* along with the text, ProcessMarquee() redraws it after each step so it stays in the last column while text scrolls.
+* Hiding it restores the character it covered, or shows STALE_INDICATOR if the value on display is being served from cache.
+*/
+void DrawPollIndicator(bool polling) {
+  int column = (marqueeOffset + LCD_COLUMNS - 1) % LCD_DDRAM_COLUMNS;
+  char covered = column < (int) strlen(writtenBottomRow) ? writtenBottomRow[column] : ' ';
+  _lcd.setCursor(column, 1);
+  indicatorColumn = column;
+  indicatorPolling = polling;
+  if (polling) {
+    _lcd.write('.');
+  }
+  else if (renderedValueIndex >= 0 && IsValueStale(renderedValueIndex)) {
+    _lcd.write(STALE_INDICATOR);
+  }
+  else {
+    _lcd.write(covered);
+    indicatorColumn = -1;
+  }
 }
 
 /*
 * Clears the LCD and performs a sine-wave animation on it. Used when the value updates to draw the users attention.
 */
 void PerformLCDAnimation() {
-  DEBUG_SERIAL.println("Performing LCD animation");
-  _lcd.clear();
+  PROFILE_SECTION(SectionLCDAnimation);
+  LOG_INFO("Performing LCD animation");
+  ClearLCD();
+  int slots[LEN(animationCustomChars)];                                     // Where each animation character is in CGRAM. Nothing else is on display, so there's room for all of them.
+  for (int i = 0; i < LEN(animationCustomChars); i++) {
+    slots[i] = AcquireGlyph(GLYPH_ID(GlyphSetAnimation, i), animationCustomChars[i]);
+  }
   for (int i = 0; i < 3; i++) {                               // Loop the animation three times.
     for (int frame = 0; frame < ANIM_FRAME_COUNT; frame++) {  // For each frame in the animation...
       for (int column = 0; column < LCD_COLUMNS; column++) {  // For each column in the display...
@@ -99,11 +393,115 @@ void PerformLCDAnimation() {
         }
         for (int row = 0; row < LCD_ROWS; row ++) {           // Draw the correct character in the upper and lower rows for that column.
           _lcd.setCursor(column, row);
-          _lcd.write(animationSequence[frameIndex][row]);
+          int slot = slots[animationSequence[frameIndex][row]];
+          _lcd.write(slot >= 0 ? slot : ' ');
         }
     }
-    delay(100);
+    DelayServicingPanels(100);                                // Other LCDs on the bus carry on updating between frames.
     }
   }
-  _lcd.clear();
+  ClearLCD();
+}
+
+/*
+* Rolls the characters that differ between the old and new value into place on the lower row, like an odometer.
+* Unchanged characters and the upper row are left untouched. Changed positions are grouped by their old and new character
+* and rolled two groups at a time, each in a scratch CGRAM slot rewritten frame by frame (see AcquireScratchGlyph()).
+* Characters with no glyph in odometerGlyphs (e.g. letters, separators) are written directly.
+*/
+void PerformOdometerUpdate(const char* oldValue, const char* newValue) {
+  static const int maxColumns = LCD_COLUMNS - 1;                            // The last column is reserved for the API polling indicator.
+  char oldChars[maxColumns];
+  char newChars[maxColumns];
+  bool pending[maxColumns];
+  int oldLength = strlen(oldValue);
+  int newLength = strlen(newValue);
+
+  for (int column = 0; column < maxColumns; column++) {                     // Pad both values with spaces so they can be compared column by column.
+    oldChars[column] = column < oldLength ? oldValue[column] : ' ';
+    newChars[column] = column < newLength ? newValue[column] : ' ';
+    pending[column] = oldChars[column] != newChars[column];
+
+    if (pending[column] && (OdometerGlyphIndex(oldChars[column]) < 0 || OdometerGlyphIndex(newChars[column]) < 0)) {
+      _lcd.setCursor(column, 1);                                            // Can't be rolled, write the new character straight away.
+      _lcd.write(newChars[column]);
+      pending[column] = false;
+    }
+  }
+
+  while (true) {
+    char groupOld[2];                                                       // The old and new character of each group being rolled in this pass. One group per CGRAM slot.
+    char groupNew[2];
+    int groupSlots[2];
+    int groupCount = 0;
+
+    for (int column = 0; column < maxColumns; column++) {                   // Assign each pending column to a group, starting a new group if there is a free slot.
+      if (!pending[column]) {
+        continue;
+      }
+      int group = 0;
+      while (group < groupCount && (groupOld[group] != oldChars[column] || groupNew[group] != newChars[column])) {
+        group++;
+      }
+      if (group == groupCount && groupCount < LEN(groupOld) && (groupSlots[groupCount] = AcquireScratchGlyph()) >= 0) {
+        groupOld[groupCount] = oldChars[column];
+        groupNew[groupCount] = newChars[column];
+        UpdateScratchGlyph(groupSlots[groupCount], odometerGlyphs[OdometerGlyphIndex(oldChars[column])]);  // Starts out as the character it replaces.
+        groupCount++;
+      }
+      if (group < groupCount) {
+        _lcd.setCursor(column, 1);                                          // Point the column at the group's slot. From here on only the slot's glyph is rewritten.
+        _lcd.write(groupSlots[group]);
+      }
+    }
+
+    if (groupCount == 0) {
+      for (int column = 0; column < maxColumns; column++) {                 // Done, or no slot could be had, in which case the rest are written without rolling.
+        if (pending[column]) {
+          _lcd.setCursor(column, 1);
+          _lcd.write(newChars[column]);
+        }
+      }
+      return;
+    }
+
+    for (int shift = ODOMETER_ROLL_STEP; shift < 8; shift += ODOMETER_ROLL_STEP) {
+      for (int group = 0; group < groupCount; group++) {
+        const byte* oldGlyph = odometerGlyphs[OdometerGlyphIndex(groupOld[group])];
+        const byte* newGlyph = odometerGlyphs[OdometerGlyphIndex(groupNew[group])];
+        byte frame[8];
+        for (int row = 0; row < 8; row++) {                                 // The old glyph moves up by shift rows, with the top of the new glyph following beneath it.
+          frame[row] = row + shift < 8 ? oldGlyph[row + shift] : newGlyph[row + shift - 8];
+        }
+        UpdateScratchGlyph(groupSlots[group], frame);
+      }
+      DelayServicingPanels(ODOMETER_FRAME_MS);
+    }
+
+    for (int column = 0; column < maxColumns; column++) {                   // Replace the rolled columns with the real characters and release the slots for the next pass.
+      for (int group = 0; group < groupCount; group++) {
+        if (pending[column] && groupOld[group] == oldChars[column] && groupNew[group] == newChars[column]) {
+          _lcd.setCursor(column, 1);
+          _lcd.write(newChars[column]);
+          pending[column] = false;
+        }
+      }
+    }
+    for (int group = 0; group < groupCount; group++) {
+      ReleaseGlyph(groupSlots[group]);
+    }
+  }
+}
+
+/*
+* Returns the index in odometerGlyphs of the glyph for a character, or -1 if it has no glyph and can't be rolled.
+*/
+int OdometerGlyphIndex(char character) {
+  if (character >= '0' && character <= '9') {
+    return character - '0';
+  }
+  if (character == ' ') {
+    return LEN(odometerGlyphs) - 1;
+  }
+  return -1;
 }
\ No newline at end of file
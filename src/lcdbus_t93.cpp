@@ -0,0 +1,74 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "lcdbus_t93.h"
+
+static uint32_t busTransfers = 0;                   // Bytes sent to every LCD since boot.
+
+MeteredLCD::MeteredLCD(uint8_t address, int columns, int rows) :
+  hd44780_I2Cexp(address, columns, rows),
+  _transfers(0) {
+}
+
+size_t MeteredLCD::write(uint8_t value) {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::write(value);
+}
+
+int MeteredLCD::clear() {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::clear();
+}
+
+int MeteredLCD::home() {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::home();
+}
+
+int MeteredLCD::setCursor(uint8_t column, uint8_t row) {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::setCursor(column, row);
+}
+
+/*
+* Counted as the CGRAM address command followed by the 8 rows of the glyph.
+*/
+int MeteredLCD::createChar(uint8_t location, const uint8_t* charmap) {
+  _transfers += 9;
+  CountBusTransfers(9);
+  return hd44780_I2Cexp::createChar(location, (uint8_t*) charmap);
+}
+
+int MeteredLCD::scrollDisplayLeft() {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::scrollDisplayLeft();
+}
+
+int MeteredLCD::backlight() {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::backlight();
+}
+
+int MeteredLCD::noBacklight() {
+  _transfers++;
+  CountBusTransfers(1);
+  return hd44780_I2Cexp::noBacklight();
+}
+
+uint32_t MeteredLCD::transfers() {
+  return _transfers;
+}
+
+void CountBusTransfers(uint32_t count) {
+  busTransfers += count;
+}
+
+uint32_t GetBusTransfers() {
+  return busTransfers;
+}
\ No newline at end of file
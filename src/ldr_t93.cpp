@@ -6,15 +6,19 @@
 #include "lcd_t93.h"
 #include "eeprom_t93.h"
 #include "enums_t93.h"
+#include "log_t93.h"
 #include "ldr_t93.h"
+#include "profiler_t93.h"
+
+#define LOG_MODULE LDR
 
 /*
 * Configures pinMode for the LDR pin and initial calibration.
 */
 void InitializeLDR() {
-  DEBUG_SERIAL.println("Initializing LDR");
+  LOG_INFO("Initializing LDR");
   pinMode(LDR_PIN, INPUT);
-  DEBUG_SERIAL.println("LDR Initialized");
+  LOG_INFO("LDR Initialized");
 }
 
 /*
@@ -22,6 +26,7 @@ void InitializeLDR() {
 * If Auto backlight configured, turns LCD backlight off in a dark toom.
 */
 void ProcessLDR() {
+  PROFILE_SECTION(SectionLDR);
   if (_selectedDisplayMode == Auto) {
     UpdateBacklightPerLightLevel();
   }
@@ -49,39 +54,35 @@ void UpdateBacklightPerLightLevel() {
   bool readingAboveLightRoomThreshold = LDRAboveLightRoomThreshold();
 
   if (readingBelowDarkRoomThreshold != previouslyReadingDarkness) {         // Debounces moving above and below the lower threshold.
-    DEBUG_SERIAL.print("LDR dark room state changed. Now with value of: ");
-    DEBUG_SERIAL.println(analogRead(LDR_PIN));
+    LOG_DEBUG("LDR dark room state changed. Now with value of: %d", analogRead(LDR_PIN));
     debounceTimer = 0;
   }
 
   if (readingAboveLightRoomThreshold != previouslyReadingLightness) {       // Debounces moving above and below the upper threshold.
-    DEBUG_SERIAL.print("LDR light room state changed. Now with value of: ");
-    DEBUG_SERIAL.println(analogRead(LDR_PIN));
+    LOG_DEBUG("LDR light room state changed. Now with value of: %d", analogRead(LDR_PIN));
     debounceTimer = 0;
   }
 
   if (debounceTimer > debounceDelay) {                                      // Readings have stabilized.
     if (readingBelowDarkRoomThreshold && !previouslyInDarkRoom) {           // If moving from above the lower threshold to below it...
-      DEBUG_SERIAL.println("Moving from light state to dark state");
+      LOG_DEBUG("Moving from light state to dark state");
       previouslyInDarkRoom = true;                                          // Have moved into a dark state.
       darkTimer = 0;                                                        // Begin tracking how long the unit has been in darkness.
     }
 
     if (readingBelowDarkRoomThreshold && previouslyInDarkRoom) {            // Currently in darkness, and have been for a while.
       if (darkTimer > darknessTimeThreshold && _lcdBacklightOn) {           // Have been in darkness long enough to now turn off backlight.
-        DEBUG_SERIAL.println("Was in dark state long enough to consider the room moving into dark state");
-        DEBUG_SERIAL.println("LCD in auto mode, turning off backlight");
+        LOG_INFO("Was in dark state long enough to consider the room moving into dark state, turning off backlight");
         _lcd.noBacklight();
         _lcdBacklightOn = false;
       }
     }
 
     if (readingAboveLightRoomThreshold && previouslyInDarkRoom) {           // If moving from below the upper threshold to above it...
-      DEBUG_SERIAL.println("Moving from dark state to light state");
+      LOG_DEBUG("Moving from dark state to light state");
       previouslyInDarkRoom = false;                                         // Reset for next loop.
       if (darkTimer > darknessTimeThreshold && !_lcdBacklightOn) {          // Was in darkness for more than 3000ms, likely lights were off and now are back on.
-        DEBUG_SERIAL.println("Was in dark state long enough to consider the room previously being dark");
-        DEBUG_SERIAL.println("LCD in auto mode, turning on backlight");
+        LOG_INFO("Was in dark state long enough to consider the room previously being dark, turning on backlight");
         _lcd.backlight();
         _lcdBacklightOn = true;
       }
@@ -0,0 +1,267 @@
+#include <Arduino.h>
+#include <atomic>
+
+#include "globals_t93.h"
+#include "log_t93.h"
+
+// A bounded lock-free queue (after Dmitry Vyukov's). Each cell's sequence number says whether it is free for the producer at a
+// given position or holds a record for the consumer, so any task may log while the drain task is the single consumer.
+struct LogCell {
+  std::atomic<uint32_t> sequence;
+  LogRecord record;
+};
+
+static LogCell logRing[LOG_RING_SIZE];
+static std::atomic<uint32_t> logHead(0);           // The next position to be written.
+static std::atomic<uint32_t> logTail(0);           // The next position to be drained. Only advanced by the drain task.
+static std::atomic<uint32_t> droppedRecords(0);     // Records lost to a full ring since last reported.
+static std::atomic<bool> loggingStarted(false);   // Records made before the ring is ready are dropped, not counted.
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of 2");
+
+/*
+* Opens the serial port and starts the drain task. Anything logged before this is dropped, so it must be called first in setup().
+*/
+void InitializeLogging() {
+  if (!DEBUG) {
+    return;
+  }
+
+  Serial.begin(LOG_BAUD);
+  for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+    logRing[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  loggingStarted.store(true, std::memory_order_release);
+  xTaskCreatePinnedToCore(LogDrainTask, "log", 4096, nullptr, 1, nullptr, 0);   // Lowest priority above idle, on the core loop() doesn't run on.
+}
+
+/*
+* Waits up to timeout milliseconds for the drain task to write out everything logged so far. Used before restarting.
+*/
+void FlushLog(unsigned long timeout) {
+  if (!loggingStarted) {
+    return;
+  }
+
+  unsigned long start = millis();
+  while (logTail.load() != logHead.load() && millis() - start < timeout) {
+    delay(LOG_DRAIN_INTERVAL_MS);
+  }
+  Serial.flush();
+}
+
+/*
+* Applies rate limiting to a log statement, unless it is part of a report. Returns false if it has already been recorded LOG_RATE_LIMIT times this window.
+* Otherwise sets suppressed to the number of repeats dropped since it was last recorded.
+* Safe to call from any task without locking. Tasks racing over a new window may each be admitted, so a few records over the limit may get through.
+*/
+bool AdmitLogSite(LogSite* site, uint16_t* suppressed) {
+  if (!site->limited) {
+    *suppressed = 0;
+    return true;
+  }
+
+  uint32_t now = millis();
+  uint32_t windowStart = site->windowStart.load(std::memory_order_relaxed);
+  if (now - windowStart >= LOG_RATE_WINDOW_MS && site->windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+    site->windowCount.store(0, std::memory_order_relaxed);                 // Only the task that moved the window on starts its count.
+  }
+  if (site->windowCount.fetch_add(1, std::memory_order_relaxed) >= LOG_RATE_LIMIT) {
+    site->suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  *suppressed = min(site->suppressed.exchange(0, std::memory_order_relaxed), (uint32_t) UINT16_MAX);
+  return true;
+}
+
+/*
+* Copies a record into the ring. Never waits: if the ring is full the record is dropped and counted.
+*/
+void EnqueueLogRecord(const LogRecord& record) {
+  if (!loggingStarted.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  uint32_t position = logHead.load(std::memory_order_relaxed);
+  LogCell* cell;
+  while (true) {
+    cell = &logRing[position & (LOG_RING_SIZE - 1)];
+    int32_t difference = (int32_t) (cell->sequence.load(std::memory_order_acquire) - position);
+    if (difference == 0) {                                                  // Free for this position, try to claim it.
+      if (logHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (difference < 0) {                                              // Still holds a record from a lap ago, the ring is full.
+      droppedRecords.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else {                                                                  // Claimed by another task in the meantime, try the next.
+      position = logHead.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->record = record;
+  cell->sequence.store(position + 1, std::memory_order_release);            // Hand the cell to the consumer.
+}
+
+/*
+* Takes the oldest record from the ring. Returns false if it is empty.
+*/
+bool DequeueLogRecord(LogRecord& record) {
+  uint32_t position = logTail.load(std::memory_order_relaxed);
+  LogCell* cell = &logRing[position & (LOG_RING_SIZE - 1)];
+  if ((int32_t) (cell->sequence.load(std::memory_order_acquire) - (position + 1)) < 0) {
+    return false;
+  }
+
+  record = cell->record;
+  cell->sequence.store(position + LOG_RING_SIZE, std::memory_order_release); // Free for the producer on the next lap.
+  logTail.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+/*
+* Formats and writes out buffered records, then sleeps. Waiting on the serial port happens here rather than in the loop.
+*/
+void LogDrainTask(void* parameter) {
+  static char line[LOG_LINE_SIZE];
+  LogRecord record;
+
+  while (true) {
+    while (DequeueLogRecord(record)) {
+      FormatLogRecord(record, line, sizeof(line));
+      Serial.println(line);
+    }
+
+    uint32_t dropped = droppedRecords.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+      Serial.printf("%10s %-8s W %u messages dropped, log ring full\n", "", "LOG", dropped);
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+/*
+* Formats a record as "seconds.millis module level message", e.g. "    12.345 API      I Response code: 200".
+* Conversions in the format are applied one at a time to the recorded arguments. Length modifiers are ignored except ll, which takes two slots.
+* Returns the length of the formatted line.
+*/
+int FormatLogRecord(const LogRecord& record, char* line, int size) {
+  static const char levelLetters[] = { '-', 'E', 'W', 'I', 'D' };
+  int length = snprintf(line, size, "%6lu.%03lu %-8s %c ", (unsigned long) (record.timestamp / 1000), (unsigned long) (record.timestamp % 1000),
+    record.site->module, levelLetters[record.site->level]);
+
+  const char* format = record.site->format;
+  int arg = 0;
+  while (*format != '\0' && length < size - 1) {
+    if (*format != '%') {
+      line[length++] = *format++;
+      continue;
+    }
+    if (format[1] == '%') {
+      line[length++] = '%';
+      format += 2;
+      continue;
+    }
+
+    char spec[16];                                                          // The conversion with its flags, width and precision, ll being the only length modifier kept.
+    int specLength = 0;
+    spec[specLength++] = *format++;
+    while (*format != '\0' && strchr("-+ #0123456789.", *format) != nullptr && specLength < (int) sizeof(spec) - 4) {
+      spec[specLength++] = *format++;
+    }
+    bool wide = false;
+    while (*format != '\0' && strchr("lhzjt", *format) != nullptr) {
+      if (format[0] == 'l' && format[1] == 'l') {
+        wide = true;
+        format++;
+      }
+      format++;
+    }
+    char conversion = *format != '\0' ? *format++ : 's';
+    if (wide) {
+      spec[specLength++] = 'l';
+      spec[specLength++] = 'l';
+    }
+    spec[specLength++] = conversion;
+    spec[specLength] = '\0';
+
+    uint32_t value = arg < record.argCount ? record.args[arg++] : 0;
+    uint64_t wideValue = value;
+    if (wide && arg < record.argCount) {
+      wideValue |= (uint64_t) record.args[arg++] << 32;
+    }
+
+    char* out = line + length;
+    int space = size - length;
+    int written = 0;
+    switch (conversion) {
+      case 'd':
+      case 'i':
+        written = wide ? snprintf(out, space, spec, (long long) wideValue) : snprintf(out, space, spec, (int) value);
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+        written = wide ? snprintf(out, space, spec, (unsigned long long) wideValue) : snprintf(out, space, spec, (unsigned int) value);
+        break;
+      case 'c':
+        written = snprintf(out, space, spec, (int) value);
+        break;
+      case 'f':
+      case 'e':
+      case 'g': {
+        float decoded;
+        memcpy(&decoded, &value, sizeof(decoded));
+        written = snprintf(out, space, spec, (double) decoded);
+        break;
+      }
+      case 'p':
+        written = snprintf(out, space, spec, (void*) (uintptr_t) value);
+        break;
+      case 's':
+        written = snprintf(out, space, spec, value < LOG_TEXT_SIZE ? record.text + value : "(null)");
+        break;
+      default:
+        written = snprintf(out, space, "%s", spec);                         // Not understood, show it as written.
+        break;
+    }
+    length += min(max(written, 0), space - 1);
+  }
+
+  if (record.suppressed > 0 && length < size - 1) {
+    length += snprintf(line + length, size - length, " (%u similar suppressed)", record.suppressed);
+    length = min(length, size - 1);
+  }
+  line[length] = '\0';
+  return length;
+}
+
+/*
+* Appends a 32 bit argument to the record. Arguments beyond LOG_MAX_ARGS are ignored.
+*/
+void PushLogArg(LogRecord& record, uint32_t value) {
+  if (record.argCount < LOG_MAX_ARGS) {
+    record.args[record.argCount++] = value;
+  }
+}
+
+/*
+* Copies a string argument into the record's text, truncated to the space left, and appends its offset as the argument.
+*/
+void CaptureLogArg(LogRecord& record, const char* value) {
+  int space = LOG_TEXT_SIZE - record.textUsed;
+  if (value == nullptr || space <= 0) {
+    PushLogArg(record, UINT32_MAX);
+    return;
+  }
+
+  int length = min((int) strlen(value), space - 1);
+  memcpy(record.text + record.textUsed, value, length);
+  record.text[record.textUsed + length] = '\0';
+  PushLogArg(record, record.textUsed);
+  record.textUsed += length + 1;
+}
\ No newline at end of file
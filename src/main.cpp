@@ -1,61 +1,64 @@
 #include <Arduino.h>
-#include <elapsedMillis.h>
 
 #include "api_t93.h"
+#include "bench_t93.h"
 #include "buttons_t93.h"
 #include "eeprom_t93.h"
 #include "enums_t93.h"
+#include "fleet_t93.h"
 #include "globals_t93.h"
+#include "health_t93.h"
 #include "lcd_t93.h"
 #include "ldr_t93.h"
+#include "log_t93.h"
+#include "net_t93.h"
+#include "ota_t93.h"
+#include "panels_t93.h"
+#include "profiler_t93.h"
+#include "schedule_t93.h"
 #include "secrets_t93.h"
+#include "series_t93.h"
+#include "slots_t93.h"
 #include "wifi_t93.h"
 
-elapsedMillis memoryLoggingTimer;
-elapsedMillis restartTimer;
-
-void LogMemoryUsage();
-void ProcessRestart();
+#define LOG_MODULE MAIN
 
 void setup() {
-  DEBUG_SERIAL.begin(9600);
+  InitializeLogging();
+
+  if (PAYLOAD_BENCHMARK) {
+    RunPayloadBenchmark();
+  }
+
+  if (SERIES_BENCHMARK) {
+    RunSeriesBenchmark();
+  }
   
   InitializeEEPROM();
+  InitializeSlots();
+  InitializeHealth();
+  InitializeSeries();
   InitializeButtons();
   InitializeLDR();
   InitializeLCD();
+  InitializePanels();
   InitializeWiFi();
-
-  if (DEBUG) {
-    memoryLoggingTimer = 0;
-  }
-
-  restartTimer = 0;
+  InitializeSchedule();
+  InitializeAPIConnection();
+  InitializeFleet();
+  InitializeOTA();
 }
 
 void loop() {
+  PROFILE_LOOP_BEGIN();
+  ProcessFleet();
   ProcessAPIPolling();
   ProcessDisplayValueUpdate();
+  ProcessMarquee();
+  ProcessPanels();
   ProcessButtons();
   ProcessLDR();
-  if (DEBUG && memoryLoggingTimer > 10000) {
-    LogMemoryUsage();
-    memoryLoggingTimer = 0;
-  }
-  ProcessRestart();
-}
-
-void LogMemoryUsage() {
-  size_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
-  size_t largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
-  DEBUG_SERIAL.printf("Free Heap: %zu, Largest Free Block: %zu\n", freeHeap, largestFreeBlock);
-}
-
-void ProcessRestart() {
-  if (restartTimer > restartTimer) {
-    DEBUG_SERIAL.println("Periodic reboot of ESP32 to keep memory fresh.");
-    WriteToLCD("Periodic reboot", "cycle commencing");
-    delay(1000);
-    ESP.restart();
-  }
+  ProcessOTA();
+  ProcessHealth();
+  PROFILE_LOOP_END();
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <elapsedMillis.h>
+
+#include "globals_t93.h"
+#include "secrets_t93.h"
+#include "deadline_t93.h"
+#include "log_t93.h"
+#include "net_t93.h"
+#include "tls_t93.h"
+
+#define LOG_MODULE NET
+
+static LeanTLSClient apiClient;                     // Persists between polls so the connection can be opened ahead of the poll deadline.
+static char apiHost[64];                            // SECRET_API_ENDPOINT split into its parts. The host is resolved and connected to separately from the request.
+static uint16_t apiPort = 443;
+static char apiPath[128];
+
+static IPAddress cachedAddress;                     // The last DNS answer for apiHost, reused until its TTL expires.
+static unsigned long cachedAddressAt = 0;
+static uint32_t cachedAddressTtl = 0;               // Seconds. 0 when nothing is cached.
+
+/*
+* Splits SECRET_API_ENDPOINT ("https://host[:port]/path") into host, port and path so DNS and TLS can happen before the request.
+*/
+void InitializeAPIConnection() {
+  LOG_INFO("Initializing API connection");
+  const char* endpoint = SECRET_API_ENDPOINT;
+  const char* hostStart = strstr(endpoint, "://");
+  hostStart = hostStart != nullptr ? hostStart + 3 : endpoint;
+  const char* pathStart = strchr(hostStart, '/');
+  if (pathStart == nullptr) {
+    pathStart = hostStart + strlen(hostStart);
+  }
+  const char* portStart = (const char*) memchr(hostStart, ':', pathStart - hostStart);
+  const char* hostEnd = portStart != nullptr ? portStart : pathStart;
+
+  int hostLength = min((int) (hostEnd - hostStart), LEN(apiHost) - 1);
+  memcpy(apiHost, hostStart, hostLength);
+  apiHost[hostLength] = '\0';
+  apiPort = portStart != nullptr ? atoi(portStart + 1) : 443;
+  strncpy(apiPath, *pathStart != '\0' ? pathStart : "/", LEN(apiPath) - 1);
+  apiPath[LEN(apiPath) - 1] = '\0';
+
+  LOG_INFO("API host: %s, port: %u, path: %s", apiHost, apiPort, apiPath);
+}
+
+/*
+* Resolves the API host (from cache where possible) and completes the TCP and TLS handshakes, leaving the connection open for the next request.
+* Does nothing if a connection is already open. Returns true if the API client is connected.
+* Must be called within a deadline (see StartDeadline()), each step is a phase of it and is abandoned if it overruns.
+*/
+bool PrewarmAPIConnection() {
+  if (apiClient.connected()) {
+    return true;
+  }
+
+  IPAddress address;
+  if (!ResolveAPIHost(address)) {
+    LOG_WARNING("Unable to resolve API host");
+    return false;
+  }
+
+  LOG_DEBUG("Connecting to API at %s", address.toString().c_str());
+  BeginAPIPhase(PhaseConnect);
+  bool connected = apiClient.connectSocket(address, apiPort, TLS_CONNECT_TIMEOUT_MS);
+  if (connected) {
+    BeginAPIPhase(PhaseTLS);
+    connected = apiClient.handshake(apiHost);                               // Host is passed for SNI as the connection is made by address.
+  }
+
+  if (!connected) {
+    if (apiClient.expired()) {
+      RecordPhaseOverrun();
+    }
+    LOG_WARNING("Unable to connect to API");
+    InvalidateDNSCache();                                                   // The address may have moved, resolve it afresh next time.
+    return false;
+  }
+  return true;
+}
+
+/*
+* Begins the next phase of the current deadline (see deadline_t93), passing the phase's deadline on to the API client.
+*/
+void BeginAPIPhase(DeadlinePhase phase) {
+  BeginPhase(phase);
+  apiClient.setDeadline(GetPhaseDeadline());
+}
+
+/*
+* Ends the current deadline. The API client's deadline is lifted, so a connection opened ahead of a poll stays open until it.
+*/
+void EndAPIDeadline() {
+  EndDeadline();
+  apiClient.clearDeadline();
+}
+
+/*
+* Closes the API connection, releasing the memory held by its TLS session.
+*/
+void CloseAPIConnection() {
+  apiClient.stop();
+}
+
+LeanTLSClient& GetAPIClient() {
+  return apiClient;
+}
+
+const char* GetAPIHost() {
+  return apiHost;
+}
+
+uint16_t GetAPIPort() {
+  return apiPort;
+}
+
+const char* GetAPIPath() {
+  return apiPath;
+}
+
+/*
+* Provides the address of the API host, querying DNS only when the cached answer's TTL has expired.
+* Falls back to the system resolver (with the minimum TTL) if the direct query fails with time left in the DNS phase.
+* The system resolver's wait can't be shortened, so it may still overrun the phase, in which case its answer is cached for the next poll.
+*/
+bool ResolveAPIHost(IPAddress& address) {
+  if (address.fromString(apiHost)) {                                        // Endpoint given as an IP address, nothing to resolve.
+    return true;
+  }
+
+  if (cachedAddressTtl > 0 && millis() - cachedAddressAt < cachedAddressTtl * 1000UL) {
+    address = cachedAddress;
+    return true;
+  }
+
+  BeginAPIPhase(PhaseDNS);
+  uint32_t ttl = 0;
+  if (!QueryDNS(apiHost, address, ttl, GetPhaseRemaining())) {
+    if (IsPhaseOverrun()) {
+      RecordPhaseOverrun();
+      return false;
+    }
+    LOG_WARNING("DNS query failed, falling back to system resolver");
+    if (!WiFi.hostByName(apiHost, address)) {
+      return false;
+    }
+    ttl = DNS_MIN_TTL_SECONDS;
+  }
+
+  cachedAddress = address;
+  cachedAddressAt = millis();
+  cachedAddressTtl = constrain(ttl, (uint32_t) DNS_MIN_TTL_SECONDS, (uint32_t) DNS_MAX_TTL_SECONDS);
+  LOG_DEBUG("Resolved %s to %s, caching for %u s", apiHost, address.toString().c_str(), cachedAddressTtl);
+  if (IsPhaseOverrun()) {
+    RecordPhaseOverrun();
+    return false;
+  }
+  return true;
+}
+
+/*
+* Forgets the cached API host address.
+*/
+void InvalidateDNSCache() {
+  cachedAddressTtl = 0;
+}
+
+/*
+* Sends a single A record query for host to the network's DNS server and waits up to timeout milliseconds for the answer.
+* Done directly, rather than through the system resolver, as that doesn't expose the TTL of the answer.
+*/
+bool QueryDNS(const char* host, IPAddress& address, uint32_t& ttl, unsigned long timeout) {
+  static uint8_t packet[512];                                               // The maximum size of a DNS message over UDP.
+  uint16_t id = esp_random();
+  int length = 0;
+
+  const uint8_t header[] = { (uint8_t) (id >> 8), (uint8_t) id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0 };  // Recursion desired, one question.
+  memcpy(packet, header, sizeof(header));
+  length = sizeof(header);
+
+  const char* label = host;
+  while (*label != '\0') {                                                  // Encode the host as length prefixed labels, e.g. 3api7example3com0.
+    const char* dot = strchr(label, '.');
+    int labelLength = dot != nullptr ? dot - label : strlen(label);
+    if (labelLength == 0 || labelLength > 63 || length + labelLength + 6 > (int) sizeof(packet)) {
+      return false;
+    }
+    packet[length++] = labelLength;
+    memcpy(packet + length, label, labelLength);
+    length += labelLength;
+    label += labelLength + (dot != nullptr ? 1 : 0);
+  }
+  const uint8_t question[] = { 0, 0, 1, 0, 1 };                             // Root label, type A, class IN.
+  memcpy(packet + length, question, sizeof(question));
+  length += sizeof(question);
+
+  WiFiUDP udp;
+  udp.begin(0);
+  udp.beginPacket(WiFi.dnsIP(), 53);
+  udp.write(packet, length);
+  udp.endPacket();
+
+  int received = 0;
+  elapsedMillis timer = 0;
+  while (timer < timeout) {
+    if (udp.parsePacket() > 0) {
+      received = udp.read(packet, sizeof(packet));
+      if (received >= 12 && packet[0] == (uint8_t) (id >> 8) && packet[1] == (uint8_t) id) {
+        break;
+      }
+      received = 0;                                                         // Not the response to this query, keep waiting.
+    }
+    delay(5);
+  }
+  udp.stop();
+
+  if (received < 12 || !(packet[2] & 0x80) || (packet[3] & 0x0F) != 0) {    // Timed out, not a response, or an error response code.
+    return false;
+  }
+
+  int questionCount = (packet[4] << 8) | packet[5];
+  int answerCount = (packet[6] << 8) | packet[7];
+  int position = 12;
+  for (int i = 0; i < questionCount && position >= 0; i++) {
+    position = SkipDNSName(packet, received, position);
+    position = position >= 0 ? position + 4 : -1;                           // Type and class.
+  }
+
+  for (int i = 0; i < answerCount && position >= 0; i++) {                  // Answers may include CNAME records ahead of the A record.
+    position = SkipDNSName(packet, received, position);
+    if (position < 0 || position + 10 > received) {
+      return false;
+    }
+    uint16_t type = (packet[position] << 8) | packet[position + 1];
+    uint16_t recordClass = (packet[position + 2] << 8) | packet[position + 3];
+    uint32_t recordTtl = ((uint32_t) packet[position + 4] << 24) | (packet[position + 5] << 16) | (packet[position + 6] << 8) | packet[position + 7];
+    uint16_t dataLength = (packet[position + 8] << 8) | packet[position + 9];
+    position += 10;
+    if (position + dataLength > received) {
+      return false;
+    }
+
+    if (type == 1 && recordClass == 1 && dataLength == 4) {
+      address = IPAddress(packet[position], packet[position + 1], packet[position + 2], packet[position + 3]);
+      ttl = recordTtl;
+      return true;
+    }
+    position += dataLength;
+  }
+  return false;
+}
+
+/*
+* Returns the position just after the (possibly compressed) name starting at position, or -1 if it runs past the end of the packet.
+*/
+int SkipDNSName(const uint8_t* packet, int length, int position) {
+  while (position < length) {
+    uint8_t labelLength = packet[position];
+    if (labelLength == 0) {
+      return position + 1;
+    }
+    if ((labelLength & 0xC0) == 0xC0) {                                     // Compression pointer, the name continues elsewhere.
+      return position + 2;
+    }
+    position += labelLength + 1;
+  }
+  return -1;
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <Update.h>
+#include <elapsedMillis.h>
+#include "esp_ota_ops.h"
+#include "rom/miniz.h"
+
+#include "globals_t93.h"
+#include "secrets_t93.h"
+#include "wifi_t93.h"
+#include "lcd_t93.h"
+#include "decode_t93.h"
+#include "image_t93.h"
+#include "tls_t93.h"
+#include "slots_t93.h"
+#include "series_t93.h"
+#include "log_t93.h"
+#include "profiler_t93.h"
+#include "ota_t93.h"
+
+#define LOG_MODULE OTA
+
+#ifndef SECRET_OTA_URL
+#define SECRET_OTA_URL ""
+#endif
+
+static bool pendingVerify = false;                  // Whether the running firmware is newly installed and yet to pass its health check.
+static elapsedMillis otaCheckTimer;
+static elapsedMillis healthCheckTimer;
+
+/*
+* Tells the Arduino core not to mark newly installed firmware valid at boot, leaving that to ProcessOTAHealthCheck().
+*/
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+/*
+* Checks whether the running firmware was just installed by an update, in which case it must pass a health check before it is kept.
+*/
+void InitializeOTA() {
+  esp_ota_img_states_t state;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+    LOG_INFO("Running newly installed firmware, awaiting health check");
+    pendingVerify = true;
+  }
+  else {
+    esp_ota_mark_app_valid_cancel_rollback();                               // Firmware flashed over USB, nothing to verify.
+  }
+
+  healthCheckTimer = 0;
+  otaCheckTimer = 0;
+}
+
+/*
+* Non-blocking check on whether new firmware should be looked for, or newly installed firmware kept.
+*/
+void ProcessOTA() {
+  PROFILE_SECTION(SectionOTA);
+  if (pendingVerify) {
+    ProcessOTAHealthCheck();
+    return;                                                                 // Don't replace firmware that hasn't yet proven itself, it would lose the rollback target.
+  }
+
+  if (strlen(SECRET_OTA_URL) == 0 || otaCheckTimer < OTA_CHECK_MINUTES * 60000UL || !IsWiFiConnected()) {
+    return;
+  }
+  otaCheckTimer = 0;
+  CheckForFirmwareUpdate();
+}
+
+/*
+* Keeps newly installed firmware once it has fetched a value, otherwise rolls back to the previous firmware after OTA_HEALTH_CHECK_SECONDS.
+*/
+void ProcessOTAHealthCheck() {
+  if (HasFreshValue()) {
+    LOG_INFO("New firmware passed health check");
+    esp_ota_mark_app_valid_cancel_rollback();
+    pendingVerify = false;
+  }
+  else if (healthCheckTimer > OTA_HEALTH_CHECK_SECONDS * 1000UL) {
+    LOG_ERROR("New firmware failed health check, rolling back");
+    WriteToLCD("Update failed", "Rolling back");
+    delay(1000);
+    FlushLog(1000);
+    esp_ota_mark_app_invalid_rollback_and_reboot();                         // Reboots into the previous firmware.
+  }
+}
+
+/*
+* Asks SECRET_OTA_URL for firmware other than that running, identifying the running image by its SHA-256 (If-None-Match).
+* A new image may be sent gzip or deflate compressed and is inflated as it downloads, straight into the inactive app partition.
+* The image is only booted if its SHA-256 matches the OTA_HASH_HEADER response header. Returns false if no update was installed.
+*/
+bool CheckForFirmwareUpdate() {
+  static const char* collectedHeaders[] = { "Content-Encoding", OTA_HASH_HEADER };
+  uint8_t runningHash[32];
+  char entityTag[67];
+  esp_partition_get_sha256(esp_ota_get_running_partition(), runningHash);
+  FormatImageTag(runningHash, entityTag);
+
+  LOG_INFO("Checking for firmware update");
+  WiFiClient plainClient;
+  LeanTLSClient secureClient;
+  bool secure = strncmp(SECRET_OTA_URL, "https:", 6) == 0;
+  HTTPClient http;
+  http.begin(secure ? secureClient : plainClient, SECRET_OTA_URL);
+  http.useHTTP10(true);                                                     // HTTP/1.1 requests carry a fixed Accept-Encoding that refuses compression.
+  http.addHeader("Accept-Encoding", "gzip, deflate");
+  http.addHeader("If-None-Match", entityTag);
+  http.collectHeaders(collectedHeaders, LEN(collectedHeaders));
+
+  int httpResponseCode = http.GET();
+  if (httpResponseCode == 304) {
+    LOG_INFO("Firmware up to date");
+    http.end();
+    return false;
+  }
+  if (httpResponseCode != 200) {
+    LOG_WARNING("Firmware check failed, response code: %d", httpResponseCode);
+    http.end();
+    return false;
+  }
+
+  uint8_t expectedHash[32];
+  if (!ParseImageHash(http.header(OTA_HASH_HEADER).c_str(), expectedHash)) {
+    LOG_WARNING("Firmware response has no valid " OTA_HASH_HEADER " header");
+    http.end();
+    return false;
+  }
+
+  ContentEncoding encoding = ParseContentEncoding(http.header("Content-Encoding").c_str());
+  uint8_t* window = nullptr;
+  if (encoding != EncodingIdentity) {
+    window = (uint8_t*) malloc(TINFL_LZ_DICT_SIZE);                         // Images are compressed with the full deflate window, so back references reach 32 KB.
+    if (window == nullptr) {
+      LOG_ERROR("Unable to allocate inflate window");
+      http.end();
+      return false;
+    }
+  }
+
+  if (!Update.begin()) {                                                    // The decompressed size isn't known up front, the whole inactive partition is made available.
+    LOG_ERROR("Unable to begin firmware update");
+    free(window);
+    http.end();
+    return false;
+  }
+
+  WriteToLCD("Updating", "firmware...");
+  elapsedMillis timer = 0;
+  FirmwareWriter writer;
+  bool installed = false;
+  {
+    PayloadDecoder decoder(window, TINFL_LZ_DICT_SIZE, &writer);
+    int received = 0;
+    if (decoder.begin(encoding, http.getSize())) {
+      received = http.writeToStream(&decoder);
+    }
+
+    if (FinishFirmwareImage(decoder, writer, expectedHash)) {
+      installed = Update.end(true);                                         // Validates the image and makes it the boot partition.
+      if (installed) {
+        LOG_INFO("Firmware installed: received %d bytes for a %u byte image (%u%%) in %lu ms",
+          received, (unsigned int) writer.length(), writer.length() > 0 ? (unsigned int) (received * 100ULL / writer.length()) : 0, (unsigned long) timer);
+      }
+      else {
+        LOG_WARNING("Unable to complete firmware update (%s)", Update.errorString());
+      }
+    }
+  }
+  free(window);
+  http.end();
+
+  if (!installed) {
+    Update.abort();
+    ProcessDisplayValueUpdate(true);                                        // Put the value back in place of the update message.
+    return false;
+  }
+
+  WriteToLCD("Firmware updated", "Restarting");
+  FlushSeries();
+  delay(1000);
+  FlushLog(1000);
+  ESP.restart();
+  return true;
+}
+
+/*
+* True if any value has been fetched (by this counter or the fleet's poller) and isn't stale, showing the firmware can reach the API.
+*/
+bool HasFreshValue() {
+  for (int i = 0; i < GetSlotCount(); i++) {
+    if (_currentValueFetchedAt[i] != 0 && !_currentValueStale[i]) {
+      return true;
+    }
+  }
+  return false;
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <elapsedMillis.h>
+
+#include "globals_t93.h"
+#include "slots_t93.h"
+#include "cache_t93.h"
+#include "log_t93.h"
+#include "profiler_t93.h"
+#include "panels_t93.h"
+
+#define LOG_MODULE PANELS
+
+static LCDPanel panels[] = EXTRA_LCDS;              // Constructing these touches no hardware, they're only initialized in MULTI_LCD mode.
+static int nextPanel = 0;                           // The panel served first by the next ProcessLCDBus(), rotated so none is always served last.
+static elapsedMillis reportTimer;
+static uint32_t reportedBusTransfers = 0;           // GetBusTransfers() at the last utilisation report.
+static uint32_t reportedMainTransfers = 0;          // The main LCD's transfer count at the last utilisation report.
+
+/*
+* Initializes each additional LCD that answers at its address. LCDs that don't answer are left out, rather than slowing the bus with writes that fail.
+* Must follow InitializeLCD(), which starts the bus.
+*/
+void InitializePanels() {
+  if (!MULTI_LCD) {
+    return;
+  }
+
+  LOG_INFO("Initializing additional LCDs");
+  for (int i = 0; i < LEN(panels); i++) {
+    LCDPanel& panel = panels[i];
+    Wire.beginTransmission(panel.address);
+    panel.present = Wire.endTransmission() == 0;
+    if (!panel.present) {
+      LOG_WARNING("No LCD found at 0x%02x", panel.address);
+      continue;
+    }
+
+    panel.lcd.init();
+    memset(panel.shown, ' ', sizeof(panel.shown));                          // As left by init, which clears the display.
+    panel.backlightOn = true;
+    panel.pageShownAt = millis();
+    ComposePanel(panel);
+    LOG_INFO("LCD at 0x%02x showing %s", panel.address, panel.slot >= 0 ? GetSlotLabel(min(panel.slot, GetSlotCount() - 1)) : "every value");
+  }
+  Wire.setClock(I2C_CLOCK_HZ);                                              // Re-applied, as initializing an LCD may reset it.
+  reportTimer = 0;
+}
+
+/*
+* Non-blocking refresh of the additional LCDs, from loop(). See ServicePanels().
+*/
+void ProcessPanels() {
+  PROFILE_SECTION(SectionPanels);
+  ServicePanels();
+}
+
+/*
+* Composes what each additional LCD should show and sends a share of the changes.
+* Also periodically reports bus utilisation, which is done without MULTI_LCD too, as the main LCD's traffic is metered either way.
+*/
+void ServicePanels() {
+  if (MULTI_LCD) {
+    for (int i = 0; i < LEN(panels); i++) {
+      if (panels[i].present) {
+        ComposePanel(panels[i]);
+      }
+    }
+    ProcessLCDBus();
+  }
+
+  if (reportTimer > LCD_BUS_REPORT_SECONDS * 1000UL) {
+    ReportBusUtilisation();
+    reportTimer = 0;
+  }
+}
+
+/*
+* Composes the label and value the panel should show into its shadow, paging to the next value if due.
+* The backlight follows the main LCD's. Values too long for the lower row are cut short, the additional LCDs don't scroll.
+*/
+void ComposePanel(LCDPanel& panel) {
+  if (panel.backlightOn != _lcdBacklightOn) {
+    if (_lcdBacklightOn) {
+      panel.lcd.backlight();
+    }
+    else {
+      panel.lcd.noBacklight();
+    }
+    panel.backlightOn = _lcdBacklightOn;
+  }
+
+  int index = panel.slot;
+  if (index < 0) {
+    if (millis() - panel.pageShownAt > LCD_PAGE_SECONDS * 1000UL) {
+      panel.pageIndex++;
+      panel.pageShownAt = millis();
+    }
+    panel.pageIndex %= GetSlotCount();
+    index = panel.pageIndex;
+  }
+  index = min(index, GetSlotCount() - 1);                                   // The API may return fewer values than the panel expects.
+
+  char row[LCD_COLUMNS + 1];
+  snprintf(row, sizeof(row), "%-*.*s", LCD_COLUMNS, LCD_COLUMNS, GetSlotLabel(index));
+  memcpy(panel.shadow[0], row, LCD_COLUMNS);
+  snprintf(row, sizeof(row), "%-*.*s", LCD_COLUMNS - 1, LCD_COLUMNS - 1, GetSlotValue(index));
+  row[LCD_COLUMNS - 1] = IsValueStale(index) ? STALE_INDICATOR : ' ';       // The last column mirrors the main LCD's stale indicator.
+  memcpy(panel.shadow[1], row, LCD_COLUMNS);
+}
+
+/*
+* Sends up to LCD_BUS_BUDGET bytes of changes to the additional LCDs. Panels take turns, each sending one run of changed characters
+* (at most LCD_BUS_RUN_MAX) per turn, so a panel with a lot to change can't hold up the others. Turns carry on across calls until the
+* panels match their shadows.
+*/
+void ProcessLCDBus() {
+  int budget = LCD_BUS_BUDGET;
+  bool sent = true;
+  while (budget > 0 && sent) {
+    sent = false;
+    for (int turn = 0; turn < LEN(panels) && budget > 0; turn++) {
+      LCDPanel& panel = panels[nextPanel];
+      nextPanel = (nextPanel + 1) % LEN(panels);
+      if (!panel.present) {
+        continue;
+      }
+      int cost = FlushPanelRun(panel, min(budget - 1, LCD_BUS_RUN_MAX));
+      budget -= cost;
+      sent |= cost > 0;
+    }
+  }
+}
+
+/*
+* Sends the panel's first run of changed characters, up to maxLength of them. Unchanged characters between changes are resent
+* if that's no more than moving the cursor past them would cost. Returns the bytes sent, 0 if the panel was up to date.
+*/
+int FlushPanelRun(LCDPanel& panel, int maxLength) {
+  if (maxLength <= 0) {
+    return 0;
+  }
+
+  for (int row = 0; row < LCD_ROWS; row++) {
+    int start = 0;
+    while (start < LCD_COLUMNS && panel.shadow[row][start] == panel.shown[row][start]) {
+      start++;
+    }
+    if (start == LCD_COLUMNS) {
+      continue;
+    }
+
+    int end = start + 1;                                                    // One past the last character sent.
+    for (int column = end; column < LCD_COLUMNS && column - start < maxLength; column++) {
+      if (panel.shadow[row][column] != panel.shown[row][column]) {
+        end = column + 1;
+      }
+      else if (column - end >= 1) {                                         // Two unchanged in a row, a new run would be cheaper.
+        break;
+      }
+    }
+
+    panel.lcd.setCursor(start, row);
+    for (int column = start; column < end; column++) {
+      panel.lcd.write(panel.shadow[row][column]);
+      panel.shown[row][column] = panel.shadow[row][column];
+    }
+    return 1 + end - start;
+  }
+  return 0;
+}
+
+/*
+* Waits for the given time while keeping the additional LCDs up to date, for effects on the main LCD that hold loop() between frames.
+*/
+void DelayServicingPanels(unsigned long milliseconds) {
+  PROFILE_SECTION(SectionPanelDelay);
+  if (!MULTI_LCD) {
+    delay(milliseconds);
+    return;
+  }
+
+  elapsedMillis timer = 0;
+  while (timer < milliseconds) {
+    ServicePanels();                                                        // Not ProcessPanels(), the time is already counted against the effect's section.
+    delay(1);
+  }
+}
+
+/*
+* Logs the share of I2C bus time spent talking to the LCDs since the last report, in total and per LCD.
+* Worked out from the bytes sent (see MeteredLCD), so excludes the time LCDs spend executing commands with the bus idle.
+* Only the additional LCDs are held to LCD_BUS_BUDGET, so the main LCD's share shows what effects like the odometer cost the others.
+*/
+void ReportBusUtilisation() {
+  unsigned long elapsed = reportTimer;
+  uint64_t capacity = (uint64_t) I2C_CLOCK_HZ * elapsed / 1000;            // Bit times available over the period.
+  if (capacity == 0) {
+    return;
+  }
+
+  uint32_t total = GetBusTransfers() - reportedBusTransfers;
+  reportedBusTransfers = GetBusTransfers();
+  LOG_REPORT("I2C bus %lu.%02lu%% utilised over %lu s (%u bytes)",
+    (unsigned long) ((uint64_t) total * LCD_BUS_BITS_PER_TRANSFER * 100 / capacity),
+    (unsigned long) ((uint64_t) total * LCD_BUS_BITS_PER_TRANSFER * 10000 / capacity % 100), elapsed / 1000, total);
+
+  uint32_t mainSent = _lcd.transfers() - reportedMainTransfers;
+  reportedMainTransfers = _lcd.transfers();
+  LOG_REPORT("  0x%02x (main) %u bytes", LCD_ADDRESS, mainSent);
+  for (int i = 0; i < LEN(panels); i++) {
+    if (panels[i].present) {
+      uint32_t sent = panels[i].lcd.transfers() - panels[i].reportedTransfers;
+      panels[i].reportedTransfers = panels[i].lcd.transfers();
+      LOG_REPORT("  0x%02x %u bytes", panels[i].address, sent);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "log_t93.h"
+#include "payload_t93.h"
+
+#define LOG_MODULE PAYLOAD
+
+/*
+* Iterates across the payload from the API and removes the first instance of the '*' character.
+* This character is returned by the API for use in another project but isn't relevant here.
+*/
+void RemoveAsteriskNotation(char* buffer) {
+  LOG_DEBUG("Stripping asterisk notation");
+  for (int i = 0; i < RESPONSE_BUFFER_SIZE; i++) {           // For each index in the buffer array...
+    if (buffer[i] == '\0') {                                  // If the end of the string is reached then exit.
+      LOG_DEBUG("End of string located prior to asterisk");
+      return;
+    }
+    if (buffer[i] == '*') {                                   // Once the '*' is found...
+      LOG_DEBUG("Asterisk located at buffer index %d", i);
+      for (int j = i; j < RESPONSE_BUFFER_SIZE - 1; j++) {   // Starting at the current index, work along the string and shift all characters left, overwriting the '*'.
+        buffer[j] = buffer[j + 1];
+        if (buffer[j] == '\0') {                              // If the end of the string has been reached then return.
+          LOG_DEBUG("End of string located within buffer, responseBuffer contains: %s", buffer);
+
+          return;
+        }
+      }
+      buffer[RESPONSE_BUFFER_SIZE - 1] = '\0';               // Otherwise, if the end of the array is reached (minus the removed '*') terminate the string and return.
+      LOG_WARNING("End of buffer reached before string termination character. This should never happen");
+      return;
+    }
+  }
+}
+
+/*
+* Iterates across the payload from the API. Validates there is at least one value, i.e. something other than pipe delimiters,
+* and that every character is printable and none is '<'. Binary garbage and HTML error pages served as a 200 are rejected,
+* rather than being split into values and shown. The number of values isn't fixed, see AcceptPayloadValueCount().
+*/
+bool ValidatePayloadFormat(char* buffer) {
+  LOG_DEBUG("Validating resulting payload format for API values");
+  bool valueFound = false;
+  for (int i = 0; i < RESPONSE_BUFFER_SIZE; i++) {   // For each character in the buffer...
+    unsigned char character = buffer[i];
+    if (character == '\0') {                         // The end of the payload, valid if there was a value in it.
+      if (!valueFound) {
+        LOG_WARNING("No values located in responseBuffer");
+        return false;
+      }
+      LOG_DEBUG("Payload passed validation");
+      return true;
+    }
+    if (character < ' ' || character > '~' || character == '<') {   // Control characters, anything beyond ASCII and markup.
+      LOG_WARNING("Unexpected character 0x%02x at buffer index %d", character, i);
+      return false;
+    }
+    if (character != '|') {                          // Anything other than a pipe delimiter is part of a value.
+      valueFound = true;
+    }
+  }
+  LOG_WARNING("End of response buffer reached without string termination");
+  return false;
+}
+
+/*
+* Whether a payload with the given number of values should be used. The first payload's count is taken as it is. After that a
+* different count, e.g. from an error page that got through validation, is only taken once VALUE_COUNT_POLLS payloads in a row
+* agree on it. Until then the payload is rejected, so a single bad response can't resize the slots and drop the values held.
+*/
+bool AcceptPayloadValueCount(int count) {
+  static int acceptedCount = 0;                       // The count of the last payload used, 0 until one has been.
+  static int pendingCount = 0;                        // A different count seen on the latest polls, and how many in a row have had it.
+  static int pendingPolls = 0;
+
+  if (acceptedCount == 0 || count == acceptedCount) {
+    acceptedCount = count;
+    pendingPolls = 0;
+    return true;
+  }
+
+  if (count != pendingCount) {
+    pendingCount = count;
+    pendingPolls = 0;
+  }
+  if (++pendingPolls < VALUE_COUNT_POLLS) {
+    LOG_WARNING("Payload has %d values rather than %d, waiting for it to repeat", count, acceptedCount);
+    return false;
+  }
+
+  LOG_INFO("Value count changed from %d to %d", acceptedCount, count);
+  acceptedCount = count;
+  pendingPolls = 0;
+  return true;
+}
+
+/*
+* Splits the payload on the | operator, storing a pointer to each value in the values array. The buffer is modified in place.
+* Values in excess of maxValues are discarded. Returns the number of values located.
+*/
+int SplitPayloadValues(char* buffer, char** values, int maxValues) {
+  char* token = strtok(buffer, "|");            // Gets the first token (the first value in the string prior to the first '|' operator).
+  int count = 0;
+
+  while (token != nullptr && count < maxValues) {
+    values[count] = token;
+    token = strtok(nullptr, "|");               // Get the next token/value
+    count++;
+  }
+  return count;
+}
\ No newline at end of file
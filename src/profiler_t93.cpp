@@ -0,0 +1,138 @@
+#include <Arduino.h>
+#include <elapsedMillis.h>
+#include <algorithm>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+#include "log_t93.h"
+#include "profiler_t93.h"
+
+#define LOG_MODULE PROFILER
+
+#if LOOP_PROFILING
+
+const char* profiledSectionNames[SectionCount] = {
+  "ProcessAPIPolling",
+  "ProcessDisplayValueUpdate",
+  "ProcessButtons",
+  "ProcessLDR",
+  "ProcessMarquee",
+  "ProcessFleet",
+  "ProcessOTA",
+  "ProcessHealth",
+  "ProcessPanels",
+  "WriteToLCD",
+  "PerformLCDAnimation",
+  "DelayServicingPanels"
+};
+
+static uint32_t sampleRing[SectionCount][PROFILE_RING_SIZE];  // The most recent durations, in cycles, for each section.
+static int sampleHead[SectionCount];                          // The next index to be written in each section's ring.
+static int sampleCount[SectionCount];                         // How many samples each ring holds, up to PROFILE_RING_SIZE.
+static uint32_t iterationCycles[SectionCount];                // Cycles spent in each section during the current loop iteration.
+static unsigned long loopStartMillis;                         // Loop duration is taken from millis() so long stalls aren't lost to the cycle counter wrapping.
+static elapsedMillis summaryTimer;
+
+/*
+* Marks the start of a loop() iteration, clearing the per-iteration section totals.
+*/
+void BeginLoopProfile() {
+  memset(iterationCycles, 0, sizeof(iterationCycles));
+  loopStartMillis = millis();
+}
+
+/*
+* Marks the end of a loop() iteration. Reports a stall if the iteration ran over budget and periodically logs the summary.
+*/
+void EndLoopProfile() {
+  unsigned long loopMillis = millis() - loopStartMillis;
+  if (loopMillis > LOOP_BUDGET_MS) {
+    LogStallReport(loopMillis);
+  }
+
+  if (summaryTimer > PROFILE_REPORT_SECONDS * 1000) {
+    LogProfileSummary();
+    summaryTimer = 0;
+  }
+}
+
+/*
+* Stores a duration in the section's ring, overwriting the oldest sample once full, and adds it to the current iteration's total.
+*/
+void RecordProfileSample(ProfiledSection section, uint32_t cycles) {
+  sampleRing[section][sampleHead[section]] = cycles;
+  sampleHead[section] = (sampleHead[section] + 1) % PROFILE_RING_SIZE;
+  if (sampleCount[section] < PROFILE_RING_SIZE) {
+    sampleCount[section]++;
+  }
+  iterationCycles[section] += cycles;
+}
+
+/*
+* Names the loop() subsystem that consumed the most time in an over-budget iteration, followed by every section that ran.
+* Time the subsystems don't account for went to code outside every section, and is named as the culprit if it is the most.
+* The helpers (WriteToLCD etc.) are nested within the subsystems so are listed for context rather than blamed.
+*/
+void LogStallReport(unsigned long loopMillis) {
+  uint32_t cyclesPerMicro = getCpuFreqMHz();
+  int culprit = -1;                                                 // None until a subsystem is found to have run.
+  uint64_t profiledCycles = 0;
+  for (int section = SectionAPIPolling; section < SectionWriteToLCD; section++) {
+    profiledCycles += iterationCycles[section];
+    if (iterationCycles[section] > 0 && (culprit < 0 || iterationCycles[section] > iterationCycles[culprit])) {
+      culprit = section;
+    }
+  }
+
+  unsigned long profiledMillis = profiledCycles / cyclesPerMicro / 1000;
+  unsigned long unprofiledMillis = loopMillis > profiledMillis ? loopMillis - profiledMillis : 0;
+  unsigned long culpritMillis = culprit >= 0 ? iterationCycles[culprit] / cyclesPerMicro / 1000 : 0;
+  const char* culpritName = culprit >= 0 ? profiledSectionNames[culprit] : "none";
+  if (unprofiledMillis > culpritMillis) {
+    culpritName = "outside profiled sections";
+    culpritMillis = unprofiledMillis;
+  }
+
+  LOG_WARNING("Stall: loop took %lu ms (budget %d ms), culprit %s (%lu ms)", loopMillis, LOOP_BUDGET_MS, culpritName, culpritMillis);
+  for (int section = 0; section < SectionCount; section++) {
+    if (iterationCycles[section] > 0) {
+      LOG_REPORT("  %-26s %8lu us", profiledSectionNames[section], (unsigned long) (iterationCycles[section] / cyclesPerMicro));
+    }
+  }
+  LOG_REPORT("  %-26s %8lu us", "(outside profiled sections)", unprofiledMillis * 1000);
+}
+
+/*
+* Logs min/mean/max/p99 in microseconds for each section, calculated over the samples currently held in its ring.
+*/
+void LogProfileSummary() {
+  static uint32_t sorted[PROFILE_RING_SIZE];
+  uint32_t cyclesPerMicro = getCpuFreqMHz();
+
+  LOG_REPORT("Profile over last %d samples per section (us):", PROFILE_RING_SIZE);
+  LOG_REPORT("  section                         min      mean       max       p99");
+  for (int section = 0; section < SectionCount; section++) {
+    int count = sampleCount[section];
+    if (count == 0) {
+      continue;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) {
+      sorted[i] = sampleRing[section][i];
+      total += sorted[i];
+    }
+    std::sort(sorted, sorted + count);
+    int p99Index = (count * 99 + 99) / 100 - 1;                     // Nearest-rank percentile.
+
+    LOG_REPORT("  %-26s %9lu %9lu %9lu %9lu",
+      profiledSectionNames[section],
+      (unsigned long) (sorted[0] / cyclesPerMicro),
+      (unsigned long) (total / count / cyclesPerMicro),
+      (unsigned long) (sorted[count - 1] / cyclesPerMicro),
+      (unsigned long) (sorted[p99Index] / cyclesPerMicro)
+    );
+  }
+}
+
+#endif
\ No newline at end of file
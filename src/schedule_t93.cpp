@@ -0,0 +1,122 @@
+#include <WiFi.h>
+#include <time.h>
+#include <sys/time.h>
+#include <limits.h>
+
+#include "globals_t93.h"
+#include "log_t93.h"
+#include "schedule_t93.h"
+
+#define LOG_MODULE SCHEDULE
+
+static uint32_t macOffset = 0;                      // Where in each interval this counter polls once the clock is set, spreading the fleet evenly.
+static uint32_t randomOffset = 0;                   // Where in each interval (counted from boot) this counter polls until the clock is set.
+static unsigned long nextPollAt = 0;                // The millis() the next poll is due at.
+static unsigned long lastPollAt = 0;                // The millis() the last poll started at.
+static bool polled = false;                         // Whether a poll has started since boot.
+static bool synced = false;                         // Whether the schedule is aligned to the clock yet.
+
+/*
+* Starts the clock syncing over SNTP and schedules the first poll.
+* Polls happen at a fixed offset into each POLL_INTERVAL_SECONDS, so counters powered up together don't poll the API together.
+* Once the clock is set the offset comes from a hash of the MAC address, which spreads a fleet evenly however they were booted.
+* Until then it is random, counted from boot.
+*/
+void InitializeSchedule() {
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  macOffset = HashMacAddress(mac) % (POLL_INTERVAL_SECONDS * 1000UL);
+  randomOffset = esp_random() % (POLL_INTERVAL_SECONDS * 1000UL);
+  LOG_INFO("Poll offset %lu ms once the clock is set, %lu ms until then", (unsigned long) macOffset, (unsigned long) randomOffset);
+
+  configTime(0, 0, NTP_SERVER);                                             // Offsets are relative to UTC, there's no need for the local time zone.
+  ScheduleNextPoll(0);
+}
+
+/*
+* Returns true once the next poll is due. Also moves the schedule onto the clock the first time it's found to be set.
+*/
+bool IsPollDue() {
+  if (!synced && IsTimeSynced()) {
+    synced = true;
+    LOG_INFO("Clock set over SNTP, polling at the MAC derived offset");
+    ScheduleNextPoll(polled ? POLL_INTERVAL_SECONDS * 500UL : 0);
+  }
+  return (long) (millis() - nextPollAt) >= 0;
+}
+
+unsigned long GetMillisUntilPoll() {
+  long remaining = (long) (nextPollAt - millis());
+  return remaining > 0 ? remaining : 0;
+}
+
+/*
+* Returns how long ago the last poll started, or ULONG_MAX if there hasn't been one.
+*/
+unsigned long GetMillisSincePoll() {
+  return polled ? millis() - lastPollAt : ULONG_MAX;
+}
+
+/*
+* Records a poll starting now, whether scheduled or not, and schedules the next.
+* The next is this counter's first slot at least half an interval away. For a scheduled poll that's the following slot,
+* an early poll instead skips a slot that would follow it too closely.
+*/
+void StartPoll() {
+  lastPollAt = millis();
+  polled = true;
+  ScheduleNextPoll(POLL_INTERVAL_SECONDS * 500UL);
+}
+
+/*
+* Schedules the next poll for this counter's first slot at least earliest milliseconds after the last poll (or from now if there hasn't been one).
+*/
+void ScheduleNextPoll(unsigned long earliest) {
+  unsigned long sincePoll = polled ? millis() - lastPollAt : 0;
+  unsigned long fromNow = earliest > sincePoll ? earliest - sincePoll : 0;
+  nextPollAt = millis() + GetPollSlotDelay(fromNow);
+  LOG_DEBUG("Next poll in %lu ms", nextPollAt - millis());
+}
+
+/*
+* Returns the milliseconds from now to this counter's first slot at least earliest milliseconds away.
+* Slots are measured from the Unix epoch once the clock is set, otherwise from boot.
+*/
+unsigned long GetPollSlotDelay(unsigned long earliest) {
+  return GetSlotDelay(synced ? GetEpochMillis() : (uint64_t) millis(), earliest, synced ? macOffset : randomOffset);
+}
+
+/*
+* Returns the milliseconds from now to the first slot at least earliest milliseconds away, for slots at offset into each
+* POLL_INTERVAL_SECONDS of a clock reading now. Depends on nothing else, so the fleet's schedule can be worked out for any counter.
+*/
+unsigned long GetSlotDelay(uint64_t now, unsigned long earliest, uint32_t offset) {
+  const uint64_t interval = POLL_INTERVAL_SECONDS * 1000ULL;
+  uint64_t phase = (now + earliest) % interval;
+  return earliest + (offset + interval - phase) % interval;
+}
+
+/*
+* True once SNTP has set the clock. Before then it counts up from the epoch, so any date in the past is unset.
+*/
+bool IsTimeSynced() {
+  return time(nullptr) > NTP_VALID_AFTER;
+}
+
+uint64_t GetEpochMillis() {
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  return (uint64_t) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+/*
+* FNV-1a over the 6 bytes of a MAC address. Consecutive addresses, as a batch of boards tends to have, hash far apart.
+*/
+uint32_t HashMacAddress(const uint8_t* mac) {
+  uint32_t hash = 2166136261UL;
+  for (int i = 0; i < 6; i++) {
+    hash ^= mac[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
\ No newline at end of file
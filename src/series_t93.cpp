@@ -0,0 +1,544 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "globals_t93.h"
+#include "history_t93.h"
+#include "schedule_t93.h"
+#include "log_t93.h"
+#include "series_t93.h"
+
+#define LOG_MODULE SERIES
+
+// The payload widths of the three short codes ('10', '110' and '1110') a zigzagged delta-of-delta is written with, '0' being no change.
+// Anything larger is written as '1111' and the raw 32 bit time or value. Times are in seconds, so jitter of a few seconds takes the first.
+static const uint8_t seriesTimeWidths[] = { 7, 9, 12 };
+static const uint8_t seriesValueWidths[] = { 6, 13, 20 };
+static const int seriesDataBits = sizeof(SeriesChunk::data) * 8;
+static const int seriesMaxSampleBits = 2 * (4 + 32);                       // A sample with both time and value written raw.
+
+static SeriesEncoder encoders[SERIES_MAX_SLOTS];    // Each slot's chunk being filled.
+static SeriesChunk segment[SERIES_SEGMENT_CHUNKS];  // Full chunks of any slot, oldest first, waiting to be written together as the next file.
+static int segmentChunks = 0;                       // Chunks held in segment.
+static uint32_t firstSegment = 0;                   // The number of the oldest file. Files are numbered consecutively from it.
+static uint32_t segmentCount = 0;                   // Files held.
+static SeriesChunk readChunk;                       // Chunks are read from flash into here by queries.
+static bool seriesReady = false;                    // Whether the filesystem is mounted.
+
+/*
+* Mounts the LittleFS partition (the one labelled spiffs in the partition table), formatting it if it doesn't hold a filesystem yet,
+* and finds the history already stored. Samples are kept in files of up to SERIES_SEGMENT_CHUNKS chunks, of any slot, each written once
+* in full and named by a number counting up from the first.
+*/
+void InitializeSeries() {
+  if (!SERIES_STORE) {
+    return;
+  }
+
+  LOG_INFO("Initializing series store");
+  for (int i = 0; i < SERIES_MAX_SLOTS; i++) {
+    ResetSeriesEncoder(encoders[i]);
+  }
+  segmentChunks = 0;
+  firstSegment = 0;
+  segmentCount = 0;
+  seriesReady = false;
+
+  if (!LittleFS.begin(true)) {
+    LOG_ERROR("Unable to mount LittleFS, history won't be stored");
+    return;
+  }
+  LittleFS.mkdir(SERIES_PATH);
+
+  uint32_t lastSegment = 0;
+  File directory = LittleFS.open(SERIES_PATH);
+  File entry = directory.openNextFile();
+  while (entry) {
+    uint32_t number;
+    if (ParseSeriesSegmentName(entry.name(), number)) {
+      if (segmentCount == 0 || number < firstSegment) {
+        firstSegment = number;
+      }
+      if (segmentCount == 0 || number > lastSegment) {
+        lastSegment = number;
+      }
+      segmentCount++;
+    }
+    entry.close();
+    entry = directory.openNextFile();
+  }
+  directory.close();
+
+  if (segmentCount > 0 && lastSegment - firstSegment + 1 != segmentCount) {
+    LOG_WARNING("Files missing, treating %lu onwards as held", (unsigned long) firstSegment);
+    segmentCount = lastSegment - firstSegment + 1;                          // Queries skip the missing files.
+  }
+
+  seriesReady = true;
+  ReportSeries();
+}
+
+/*
+* Adds a value fetched for the given slot to its stored history, if it is numeric and the clock is set (so it can be placed in time across restarts).
+* Returns true if the value was stored (see AddSeriesSample()).
+*/
+bool RecordSeriesSample(int index, const char* text) {
+  if (!seriesReady || !IsTimeSynced()) {
+    return false;
+  }
+  int32_t value;
+  if (!ParseHistoryValue(text, &value)) {
+    return false;
+  }
+  return AddSeriesSample(index, GetEpochMillis() / 1000, value);
+}
+
+/*
+* Adds a sample taken at the given Unix time (in seconds) to the given slot's history.
+* Samples within three quarters of SERIES_SAMPLE_SECONDS of the last are skipped, so a poll landing a little early still lines up.
+* Once the oldest sample held in RAM is due to be written (see NeedsSeriesSeal()), everything held is written. Returns true if the sample was stored.
+*/
+bool AddSeriesSample(int index, uint32_t time, int32_t value) {
+  if (!seriesReady || index < 0 || index >= SERIES_MAX_SLOTS) {
+    return false;
+  }
+
+  SeriesEncoder& encoder = encoders[index];
+  if (encoder.chunk.header.count > 0 && (int32_t) (time - encoder.lastTime) < SERIES_SAMPLE_SECONDS * 3 / 4) {
+    return false;
+  }
+  if (!EncodeSeriesSample(encoder, time, value)) {                          // The chunk is full, seal it and start the next with this sample.
+    SealSeriesChunk(index);
+    EncodeSeriesSample(encoder, time, value);
+  }
+
+  if (NeedsSeriesSeal(GetOldestHeldSeriesTime(time), time)) {
+    FlushSeries();
+  }
+  return true;
+}
+
+/*
+* Whether a sample taken at firstTime has been held in RAM for longer than SERIES_SEAL_MINUTES at now, so should be written.
+* Shared with the series benchmark, so it seals chunks as the store does.
+*/
+bool NeedsSeriesSeal(uint32_t firstTime, uint32_t now) {
+  return now - firstTime > SERIES_SEAL_MINUTES * 60UL;
+}
+
+/*
+* Returns the time of the oldest sample held in RAM, in the chunks being filled or those waiting to be written, or the given time if it is older.
+*/
+uint32_t GetOldestHeldSeriesTime(uint32_t time) {
+  for (int i = 0; i < segmentChunks; i++) {
+    time = min(time, segment[i].header.firstTime);
+  }
+  for (int i = 0; i < SERIES_MAX_SLOTS; i++) {
+    if (encoders[i].chunk.header.count > 0) {
+      time = min(time, encoders[i].chunk.header.firstTime);
+    }
+  }
+  return time;
+}
+
+/*
+* Moves the given slot's chunk, full or not, to those waiting to be written and starts a new one. Writes them once there are SERIES_SEGMENT_CHUNKS.
+*/
+void SealSeriesChunk(int index) {
+  if (encoders[index].chunk.header.count == 0) {
+    return;
+  }
+  segment[segmentChunks] = encoders[index].chunk;
+  segment[segmentChunks].header.slot = index;
+  segmentChunks++;
+  ResetSeriesEncoder(encoders[index]);
+
+  if (segmentChunks == SERIES_SEGMENT_CHUNKS) {
+    WriteSeriesSegment();
+  }
+}
+
+/*
+* Writes every chunk held in RAM to flash, e.g. ahead of a restart.
+*/
+void FlushSeries() {
+  if (!seriesReady) {
+    return;
+  }
+  for (int i = 0; i < SERIES_MAX_SLOTS; i++) {
+    SealSeriesChunk(i);
+  }
+  WriteSeriesSegment();
+}
+
+/*
+* Writes the given slot's samples from the time range (inclusive) into samples, oldest first. Returns the number written.
+* If there are more than maxSamples, only the oldest are written. Narrow the range, or see SummariseSeries(), for the rest.
+*/
+int QuerySeries(int index, uint32_t from, uint32_t to, SeriesSample* samples, int maxSamples) {
+  SeriesQuery query = { from, to, samples, maxSamples, 0, nullptr, nullptr, 0 };
+  if (maxSamples > 0) {
+    VisitSeriesChunks(index, from, to, QuerySeriesVisitor, &query);
+  }
+  return query.count;
+}
+
+/*
+* Divides the time range (inclusive) into equal buckets and finds the lowest and highest of the given slot's values in each, e.g. to draw
+* days of history in a few columns. Buckets without samples are left with lowest above highest. Returns the number of buckets with samples.
+* A chunk falling within a single bucket is summarised from its header, so long ranges cost little more than reading the chunks.
+*/
+int SummariseSeries(int index, uint32_t from, uint32_t to, int32_t* lowest, int32_t* highest, int buckets) {
+  for (int i = 0; i < buckets; i++) {
+    lowest[i] = INT32_MAX;
+    highest[i] = INT32_MIN;
+  }
+  if (buckets <= 0 || to < from) {
+    return 0;
+  }
+
+  SeriesQuery query = { from, to, nullptr, 0, 0, lowest, highest, buckets };
+  VisitSeriesChunks(index, from, to, SummariseSeriesVisitor, &query);
+
+  int filled = 0;
+  for (int i = 0; i < buckets; i++) {
+    filled += lowest[i] <= highest[i] ? 1 : 0;
+  }
+  return filled;
+}
+
+/*
+* Calls visitor with each of the given slot's chunks that overlap the time range (inclusive), oldest first: those in files, then those
+* waiting to be written, then the one being filled. Only the 24 byte header of other slots' chunks and chunks outside the range is read.
+* Returns the number of chunks visited.
+*/
+int VisitSeriesChunks(int index, uint32_t from, uint32_t to, SeriesChunkVisitor visitor, void* context) {
+  if (!seriesReady || index < 0 || index >= SERIES_MAX_SLOTS) {
+    return 0;
+  }
+
+  int visited = 0;
+  for (uint32_t number = firstSegment; number < firstSegment + segmentCount; number++) {
+    char path[32];
+    GetSeriesSegmentPath(path, sizeof(path), number);
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) {
+      continue;
+    }
+
+    while (file.read((uint8_t*) &readChunk.header, sizeof(readChunk.header)) == sizeof(readChunk.header) && readChunk.header.magic == SERIES_CHUNK_MAGIC) {
+      if (readChunk.header.slot != index || readChunk.header.lastTime < from) {
+        file.seek(file.position() + sizeof(readChunk.data));
+        continue;
+      }
+      if (readChunk.header.firstTime > to) {                                // A slot's chunks are in time order, nothing further is in range.
+        file.close();
+        return visited;
+      }
+      if (file.read(readChunk.data, sizeof(readChunk.data)) != sizeof(readChunk.data)) {
+        break;
+      }
+      visited++;
+      if (!visitor(readChunk, context)) {
+        file.close();
+        return visited;
+      }
+    }
+    file.close();
+  }
+
+  for (int i = 0; i < segmentChunks; i++) {
+    const SeriesChunkHeader& header = segment[i].header;
+    if (header.slot == index && header.lastTime >= from && header.firstTime <= to) {
+      visited++;
+      if (!visitor(segment[i], context)) {
+        return visited;
+      }
+    }
+  }
+
+  const SeriesChunkHeader& header = encoders[index].chunk.header;
+  if (header.count > 0 && header.lastTime >= from && header.firstTime <= to) {
+    visited++;
+    visitor(encoders[index].chunk, context);
+  }
+  return visited;
+}
+
+bool QuerySeriesVisitor(const SeriesChunk& chunk, void* context) {
+  SeriesQuery& query = *(SeriesQuery*) context;
+  SeriesCursor cursor;
+  SeriesSample sample;
+  BeginSeriesCursor(cursor, chunk);
+  while (NextSeriesSample(cursor, sample) && sample.time <= query.to) {
+    if (sample.time >= query.from) {
+      query.samples[query.count++] = sample;
+      if (query.count == query.maxSamples) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool SummariseSeriesVisitor(const SeriesChunk& chunk, void* context) {
+  SeriesQuery& query = *(SeriesQuery*) context;
+  const SeriesChunkHeader& header = chunk.header;
+  if (header.firstTime >= query.from && header.lastTime <= query.to && GetSeriesBucket(query, header.firstTime) == GetSeriesBucket(query, header.lastTime)) {
+    int bucket = GetSeriesBucket(query, header.firstTime);
+    query.lowest[bucket] = min(query.lowest[bucket], header.lowest);
+    query.highest[bucket] = max(query.highest[bucket], header.highest);
+    return true;
+  }
+
+  SeriesCursor cursor;
+  SeriesSample sample;
+  BeginSeriesCursor(cursor, chunk);
+  while (NextSeriesSample(cursor, sample) && sample.time <= query.to) {
+    if (sample.time >= query.from) {
+      int bucket = GetSeriesBucket(query, sample.time);
+      query.lowest[bucket] = min(query.lowest[bucket], sample.value);
+      query.highest[bucket] = max(query.highest[bucket], sample.value);
+    }
+  }
+  return true;
+}
+
+int GetSeriesBucket(const SeriesQuery& query, uint32_t time) {
+  return (uint64_t) (time - query.from) * query.buckets / ((uint64_t) query.to - query.from + 1);
+}
+
+/*
+* Logs how much of the filesystem is in use and how far back each slot's history goes.
+*/
+void ReportSeries() {
+  if (!seriesReady) {
+    return;
+  }
+
+  LOG_REPORT("Series store using %u of %u KB in %u files", (unsigned int) (LittleFS.usedBytes() / 1024), (unsigned int) (LittleFS.totalBytes() / 1024), (unsigned int) segmentCount);
+  unsigned int chunks[SERIES_MAX_SLOTS] = { 0 };
+  uint32_t oldest[SERIES_MAX_SLOTS] = { 0 };
+  for (uint32_t number = firstSegment; number < firstSegment + segmentCount; number++) {
+    char path[32];
+    GetSeriesSegmentPath(path, sizeof(path), number);
+    File file = LittleFS.open(path, FILE_READ);
+    SeriesChunkHeader header;
+    while (file && file.read((uint8_t*) &header, sizeof(header)) == sizeof(header) && header.magic == SERIES_CHUNK_MAGIC) {
+      if (header.slot < SERIES_MAX_SLOTS && chunks[header.slot]++ == 0) {
+        oldest[header.slot] = header.firstTime;
+      }
+      file.seek(file.position() + sizeof(SeriesChunk::data));
+    }
+    file.close();
+  }
+
+  for (int i = 0; i < SERIES_MAX_SLOTS; i++) {
+    if (chunks[i] > 0) {
+      LOG_REPORT("  Index %d: %u chunks, oldest sample at %lu", i, chunks[i], (unsigned long) oldest[i]);
+    }
+  }
+}
+
+/*
+* Writes the chunks waiting in RAM to a new file in a single write, so LittleFS lays them out once rather than copying a partly
+* filled block each time one is appended. Chunks are whole multiples of the LittleFS page size, so only whole pages are programmed.
+* The chunks are let go either way. Returns false if they couldn't be written.
+*/
+bool WriteSeriesSegment() {
+  int chunks = segmentChunks;
+  segmentChunks = 0;
+  if (chunks == 0) {
+    return true;
+  }
+  if (!MakeSeriesRoom(chunks * sizeof(SeriesChunk))) {
+    LOG_WARNING("Series store full, dropping %d chunks", chunks);
+    return false;
+  }
+
+  char path[32];
+  GetSeriesSegmentPath(path, sizeof(path), firstSegment + segmentCount);
+  segmentCount++;                                                           // Counted even if the write fails, so the next file never reuses a partly written one's number.
+  File file = LittleFS.open(path, FILE_WRITE);
+  size_t written = file ? file.write((const uint8_t*) segment, chunks * sizeof(SeriesChunk)) : 0;
+  file.close();
+  if (written != chunks * sizeof(SeriesChunk)) {
+    LOG_ERROR("Unable to write %s", path);
+    return false;
+  }
+
+  LOG_DEBUG("Wrote %d chunks to %s", chunks, path);
+  return true;
+}
+
+/*
+* Deletes the oldest files until there is room for a file of the given size with SERIES_RESERVE_BYTES still free.
+* Returns false if there is nothing left to delete.
+*/
+bool MakeSeriesRoom(size_t bytes) {
+  while (LittleFS.totalBytes() - LittleFS.usedBytes() < SERIES_RESERVE_BYTES + bytes) {
+    if (segmentCount == 0) {
+      return false;
+    }
+
+    char path[32];
+    GetSeriesSegmentPath(path, sizeof(path), firstSegment);
+    LittleFS.remove(path);
+    LOG_DEBUG("Deleted %s to make room", path);
+    firstSegment++;
+    segmentCount--;
+  }
+  return true;
+}
+
+void GetSeriesSegmentPath(char* path, int size, uint32_t number) {
+  snprintf(path, size, "%s/%06lu", SERIES_PATH, (unsigned long) number);
+}
+
+/*
+* Reads the number from a file name written by GetSeriesSegmentPath(). Returns false for anything else.
+*/
+bool ParseSeriesSegmentName(const char* name, uint32_t& number) {
+  if (name[0] < '0' || name[0] > '9' || strspn(name, "0123456789") != strlen(name)) {
+    return false;
+  }
+  number = strtoul(name, nullptr, 10);
+  return true;
+}
+
+/*
+* Empties the encoder's chunk, ready for its first sample.
+*/
+void ResetSeriesEncoder(SeriesEncoder& encoder) {
+  memset(&encoder.chunk, 0, sizeof(encoder.chunk));
+  encoder.bits = 0;
+  encoder.lastTime = 0;
+  encoder.lastValue = 0;
+  encoder.timeDelta = SERIES_SAMPLE_SECONDS;                                // Samples taken on schedule then cost a single bit of time.
+  encoder.valueDelta = 0;
+}
+
+/*
+* Adds a sample to the encoder's chunk. The first is held in the header, the rest as the change in the time and value deltas.
+* Returns false, leaving the chunk unchanged, if the chunk may not have room for it.
+*/
+bool EncodeSeriesSample(SeriesEncoder& encoder, uint32_t time, int32_t value) {
+  SeriesChunkHeader& header = encoder.chunk.header;
+  if (header.count == 0) {
+    header = { SERIES_CHUNK_MAGIC, 0, 1, time, time, value, value, value };
+  }
+  else {
+    if (encoder.bits + seriesMaxSampleBits > seriesDataBits || header.count == UINT16_MAX) {
+      return false;
+    }
+    int64_t timeDelta = (int64_t) time - encoder.lastTime;
+    int64_t valueDelta = (int64_t) value - encoder.lastValue;
+    WriteSeriesField(encoder.chunk.data, encoder.bits, timeDelta - encoder.timeDelta, time, seriesTimeWidths);
+    WriteSeriesField(encoder.chunk.data, encoder.bits, valueDelta - encoder.valueDelta, (uint32_t) value, seriesValueWidths);
+    encoder.timeDelta = timeDelta;
+    encoder.valueDelta = valueDelta;
+
+    header.count++;
+    header.lastTime = time;
+    header.lowest = min(header.lowest, value);
+    header.highest = max(header.highest, value);
+  }
+
+  encoder.lastTime = time;
+  encoder.lastValue = value;
+  return true;
+}
+
+void BeginSeriesCursor(SeriesCursor& cursor, const SeriesChunk& chunk) {
+  cursor = { &chunk, 0, 0, chunk.header.firstTime, chunk.header.firstValue, SERIES_SAMPLE_SECONDS, 0 };
+}
+
+/*
+* Reads the next sample from the cursor's chunk. Returns false once every sample has been read.
+*/
+bool NextSeriesSample(SeriesCursor& cursor, SeriesSample& sample) {
+  const SeriesChunk& chunk = *cursor.chunk;
+  if (cursor.position >= chunk.header.count) {
+    return false;
+  }
+
+  if (cursor.position > 0) {
+    bool raw;
+    int64_t field = ReadSeriesField(chunk.data, cursor.bits, seriesTimeWidths, raw);
+    uint32_t time = raw ? (uint32_t) field : (uint32_t) (cursor.time + cursor.timeDelta + field);
+    field = ReadSeriesField(chunk.data, cursor.bits, seriesValueWidths, raw);
+    int32_t value = raw ? (int32_t) (uint32_t) field : (int32_t) (cursor.value + cursor.valueDelta + field);
+    cursor.timeDelta = (int64_t) time - cursor.time;
+    cursor.valueDelta = (int64_t) value - cursor.value;
+    cursor.time = time;
+    cursor.value = value;
+  }
+
+  cursor.position++;
+  sample = { cursor.time, cursor.value };
+  return true;
+}
+
+/*
+* Writes a delta-of-delta, zigzagged so small negative changes are small too, with the shortest code that fits it (see seriesTimeWidths).
+* Those that don't fit any are written as raw, the time or value itself.
+*/
+void WriteSeriesField(uint8_t* data, uint16_t& bits, int64_t change, uint32_t raw, const uint8_t* widths) {
+  uint64_t zigzag = ((uint64_t) change << 1) ^ (uint64_t) (change >> 63);
+  if (zigzag == 0) {
+    WriteSeriesBits(data, bits, 0, 1);
+    return;
+  }
+  for (int code = 0; code < 3; code++) {
+    if (zigzag < (1ULL << widths[code])) {
+      WriteSeriesBits(data, bits, (1 << (code + 2)) - 2, code + 2);          // '10', '110' or '1110'.
+      WriteSeriesBits(data, bits, zigzag, widths[code]);
+      return;
+    }
+  }
+  WriteSeriesBits(data, bits, 0x0F, 4);
+  WriteSeriesBits(data, bits, raw, 32);
+}
+
+/*
+* Reads a field written by WriteSeriesField(), returning the delta-of-delta, or the time or value itself if raw is set.
+*/
+int64_t ReadSeriesField(const uint8_t* data, uint16_t& bits, const uint8_t* widths, bool& raw) {
+  int ones = 0;
+  while (ones < 4 && ReadSeriesBits(data, bits, 1) == 1) {
+    ones++;
+  }
+  raw = ones == 4;
+  if (ones == 0) {
+    return 0;
+  }
+  if (raw) {
+    return ReadSeriesBits(data, bits, 32);
+  }
+  uint64_t zigzag = ReadSeriesBits(data, bits, widths[ones - 1]);
+  return (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+}
+
+/*
+* Writes the low count bits of value (up to 32), most significant first. Data must be zeroed ahead of being written.
+*/
+void WriteSeriesBits(uint8_t* data, uint16_t& bits, uint32_t value, int count) {
+  for (int i = count - 1; i >= 0 && bits < seriesDataBits; i--, bits++) {
+    if ((value >> i) & 1) {
+      data[bits >> 3] |= 0x80 >> (bits & 7);
+    }
+  }
+}
+
+/*
+* Reads count bits (up to 32), most significant first. Bits past the end of a chunk's data read as 0.
+*/
+uint32_t ReadSeriesBits(const uint8_t* data, uint16_t& bits, int count) {
+  uint32_t value = 0;
+  for (int i = 0; i < count; i++, bits++) {
+    value <<= 1;
+    if (bits < seriesDataBits) {
+      value |= (data[bits >> 3] >> (7 - (bits & 7))) & 1;
+    }
+  }
+  return value;
+}
\ No newline at end of file
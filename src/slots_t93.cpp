@@ -0,0 +1,165 @@
+#include <Arduino.h>
+
+#include "globals_t93.h"
+#include "secrets_t93.h"
+#include "log_t93.h"
+#include "slots_t93.h"
+
+#define LOG_MODULE SLOTS
+
+static char slotArena[SLOT_ARENA_SIZE];             // Every slot's label, then every slot's value, each null terminated and packed end to end.
+static uint16_t labelOffsets[MAX_VALUE_SLOTS];      // Where each slot's label starts in slotArena.
+static uint16_t valueOffsets[MAX_VALUE_SLOTS];      // Where each slot's value starts in slotArena.
+static int arenaUsed = 0;
+static int slotCount = 0;
+
+/*
+* Creates a slot for each label in the secrets file (at least one), ready for values to arrive.
+* Must follow InitializeEEPROM(). If the selection restored from EEPROM is beyond the labelled slots, slots are made up to it,
+* so it is kept until the first payload shows how many values there are.
+*/
+void InitializeSlots() {
+  LOG_INFO("Initializing value slots");
+  arenaUsed = 0;
+  slotCount = 0;
+  int selectedSlots = _selectedValueIndex >= 0 && _selectedValueIndex < MAX_VALUE_SLOTS ? _selectedValueIndex + 1 : 0;
+  SetSlotCount(max(LEN(_valueLabel), selectedSlots));
+}
+
+int GetSlotCount() {
+  return slotCount;
+}
+
+/*
+* Grows or shrinks the number of slots to match the number of values received, within 1 and MAX_VALUE_SLOTS.
+* Slots beyond those labelled in the secrets file are given a generated label. If the selected slot no longer exists, the first is selected.
+* Returns true if the number of slots changed.
+*/
+bool SetSlotCount(int count) {
+  count = constrain(count, 1, MAX_VALUE_SLOTS);
+  if (count == slotCount) {
+    return false;
+  }
+
+  while (slotCount < count && AddSlot()) {}
+  while (slotCount > count) {
+    RemoveSlot();
+  }
+
+  if (_selectedValueIndex < 0 || _selectedValueIndex >= slotCount) {
+    _selectedValueIndex = 0;
+    _currentValueUpdated[_selectedValueIndex] = true;                       // Show the newly selected value in place of the one that's gone.
+  }
+
+  LOG_INFO("Value slots: %d, using %d of %d arena bytes", slotCount, arenaUsed, SLOT_ARENA_SIZE);
+  return true;
+}
+
+const char* GetSlotLabel(int index) {
+  return slotArena + labelOffsets[index];
+}
+
+const char* GetSlotValue(int index) {
+  return slotArena + valueOffsets[index];
+}
+
+/*
+* Replaces the value held for the given slot, moving the values after it along the arena to fit.
+* Values are truncated to MAX_VALUE_LENGTH, or to the space remaining if the arena is full.
+*/
+void SetSlotValue(int index, const char* value) {
+  int offset = valueOffsets[index];
+  int oldSize = strlen(slotArena + offset) + 1;
+  int newSize = min((int) strlen(value), MAX_VALUE_LENGTH - 1) + 1;
+  int available = SLOT_ARENA_SIZE - arenaUsed + oldSize;
+  if (newSize > available) {
+    LOG_WARNING("Slot arena full, truncating value for index %d", index);
+    newSize = available;
+  }
+
+  ResizeArenaEntry(offset, oldSize, newSize);
+  memcpy(slotArena + offset, value, newSize - 1);
+  slotArena[offset + newSize - 1] = '\0';
+}
+
+/*
+* The text shown when the given slot is selected, one row at a time. Slots without a summary in the secrets file show their label.
+*/
+const char* GetSlotSummary(int index, int row) {
+  if (index < LEN(_valueSelectionSummary)) {
+    return _valueSelectionSummary[index][row];
+  }
+  return row == 0 ? GetSlotLabel(index) : "";
+}
+
+int GetSlotArenaUsed() {
+  return arenaUsed;
+}
+
+/*
+* Appends a slot with an empty value. Its label is inserted after the existing labels, moving the values along to make room.
+* The slot's fetch time, stale flag and history are left as they were, so a slot dropped and then added back (e.g. around a payload
+* with fewer values) carries on where it left off, and the payload that adds it fills in its value.
+* Returns false if there are already MAX_VALUE_SLOTS slots or the arena has no room for it.
+*/
+bool AddSlot() {
+  int index = slotCount;
+  if (index >= MAX_VALUE_SLOTS) {
+    return false;
+  }
+  char label[MAX_VALUE_LENGTH];
+  if (index < LEN(_valueLabel)) {
+    strncpy(label, _valueLabel[index], MAX_VALUE_LENGTH - 1);
+    label[MAX_VALUE_LENGTH - 1] = '\0';
+  }
+  else {
+    snprintf(label, MAX_VALUE_LENGTH, "Value %d", index + 1);
+  }
+
+  int labelSize = strlen(label) + 1;
+  if (arenaUsed + labelSize + 1 > SLOT_ARENA_SIZE) {                        // The label plus an empty value.
+    LOG_WARNING("Slot arena full, unable to add slot");
+    return false;
+  }
+
+  int labelsEnd = slotCount > 0 ? valueOffsets[0] : 0;
+  ResizeArenaEntry(labelsEnd, 0, labelSize);
+  memcpy(slotArena + labelsEnd, label, labelSize);
+  labelOffsets[index] = labelsEnd;
+  valueOffsets[index] = arenaUsed;
+  slotArena[arenaUsed++] = '\0';
+  slotCount++;
+  return true;
+}
+
+/*
+* Removes the last slot, closing the gaps its label and value leave in the arena.
+*/
+void RemoveSlot() {
+  int index = --slotCount;                                                  // No longer counted, so its offsets aren't moved by the resizes below.
+  ResizeArenaEntry(valueOffsets[index], strlen(GetSlotValue(index)) + 1, 0);
+  ResizeArenaEntry(labelOffsets[index], strlen(GetSlotLabel(index)) + 1, 0);
+}
+
+/*
+* Changes the size of the entry at offset from oldSize to newSize bytes, moving everything after it and updating the offset tables.
+* Returns false, leaving the arena unchanged, if there isn't room.
+*/
+bool ResizeArenaEntry(int offset, int oldSize, int newSize) {
+  if (arenaUsed - oldSize + newSize > SLOT_ARENA_SIZE) {
+    return false;
+  }
+
+  int end = offset + oldSize;
+  memmove(slotArena + offset + newSize, slotArena + end, arenaUsed - end);
+  arenaUsed += newSize - oldSize;
+  for (int i = 0; i < slotCount; i++) {
+    if (labelOffsets[i] >= end) {
+      labelOffsets[i] += newSize - oldSize;
+    }
+    if (valueOffsets[i] >= end) {
+      valueOffsets[i] += newSize - oldSize;
+    }
+  }
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include <WiFi.h>
+#include <elapsedMillis.h>
+#include "lwip/sockets.h"
+
+#include "globals_t93.h"
+#include "log_t93.h"
+#include "tls_t93.h"
+
+#define LOG_MODULE TLS
+
+static const int tlsCipherSuites[] = {                                      // ECDHE for forward secrecy, AES-GCM as the ESP32 has AES and SHA hardware.
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+  0
+};
+
+#if defined(MBEDTLS_ECP_C)
+static const mbedtls_ecp_group_id tlsCurves[] = {                           // The cheapest curves to compute on, in order of preference.
+  MBEDTLS_ECP_DP_CURVE25519,
+  MBEDTLS_ECP_DP_SECP256R1,
+  MBEDTLS_ECP_DP_NONE
+};
+#endif
+
+LeanTLSClient::LeanTLSClient() {
+  _initialized = false;
+  _connected = false;
+  _peeked = -1;
+  _heapAtConnect = 0;
+  _lowestHeap = 0;
+  _deadline = 0;
+  _hasDeadline = false;
+  _expired = false;
+  _socket.fd = -1;
+}
+
+LeanTLSClient::~LeanTLSClient() {
+  stop();
+}
+
+int LeanTLSClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, nullptr, TLS_CONNECT_TIMEOUT_MS);
+}
+
+int LeanTLSClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+  return connect(ip, port, nullptr, timeout);
+}
+
+int LeanTLSClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, TLS_CONNECT_TIMEOUT_MS);
+}
+
+int LeanTLSClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  IPAddress address;
+  if (!WiFi.hostByName(host, address)) {
+    return 0;
+  }
+  return connect(address, port, host, timeout);
+}
+
+/*
+* Opens a TCP connection to ip and completes the TLS handshake with the reduced profile.
+* Returns 1 once the connection is ready for use, 0 if any step failed (in which case everything allocated has been released).
+*/
+int LeanTLSClient::connect(IPAddress ip, uint16_t port, const char* host, int32_t timeout) {
+  return connectSocket(ip, port, timeout) && handshake(host) ? 1 : 0;
+}
+
+/*
+* Opens a TCP connection to ip, waiting up to timeout milliseconds (less if the deadline is sooner) for it to be accepted.
+* Returns false if it failed, in which case everything allocated has been released.
+*/
+bool LeanTLSClient::connectSocket(IPAddress ip, uint16_t port, int32_t timeout) {
+  stop();
+  _expired = false;
+  _heapAtConnect = ESP.getFreeHeap();
+  _lowestHeap = _heapAtConnect;
+
+  mbedtls_ssl_init(&_ssl);
+  mbedtls_ssl_config_init(&_config);
+  mbedtls_ctr_drbg_init(&_drbg);
+  mbedtls_entropy_init(&_entropy);
+  mbedtls_net_init(&_socket);
+  _initialized = true;
+
+  if (_hasDeadline) {
+    timeout = constrain((long) (_deadline - millis()), 0L, (long) timeout);
+  }
+  if (!openSocket(ip, port, timeout)) {
+    LOG_WARNING("TCP connection failed");
+    stop();
+    _expired = _hasDeadline && (long) (millis() - _deadline) >= 0;
+    return false;
+  }
+  return true;
+}
+
+/*
+* Completes the TLS handshake over the socket opened by connectSocket(), sending host (if not nullptr) for SNI.
+* Gives up after TLS_HANDSHAKE_TIMEOUT_MS or at the deadline, whichever is sooner.
+* Returns false if it failed, in which case everything allocated has been released.
+*/
+bool LeanTLSClient::handshake(const char* host) {
+  if (!_initialized || _connected) {
+    return false;
+  }
+
+  int result = mbedtls_ctr_drbg_seed(&_drbg, mbedtls_entropy_func, &_entropy, nullptr, 0);
+  if (result == 0) {
+    result = mbedtls_ssl_config_defaults(&_config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (result != 0) {
+    LOG_ERROR("Configuration failed (-0x%04X)", -result);
+    stop();
+    return false;
+  }
+
+  mbedtls_ssl_conf_authmode(&_config, MBEDTLS_SSL_VERIFY_NONE);            // The endpoint being hit is an https endpoint, but it doesn't require certs etc.
+  mbedtls_ssl_conf_rng(&_config, mbedtls_ctr_drbg_random, &_drbg);
+  mbedtls_ssl_conf_min_version(&_config, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);  // TLS 1.2, the only version offering the suites above.
+  mbedtls_ssl_conf_ciphersuites(&_config, tlsCipherSuites);
+#if defined(MBEDTLS_ECP_C)
+  mbedtls_ssl_conf_curves(&_config, tlsCurves);
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+  mbedtls_ssl_conf_max_frag_len(&_config, TLS_MAX_FRAGMENT_CODE);           // Servers are free to ignore this, in which case records of up to 16 KB still arrive.
+#endif
+
+  result = mbedtls_ssl_setup(&_ssl, &_config);                              // Allocates the record buffers.
+  if (result == 0 && host != nullptr) {
+    result = mbedtls_ssl_set_hostname(&_ssl, host);
+  }
+  if (result != 0) {
+    LOG_ERROR("Setup failed (-0x%04X)", -result);
+    stop();
+    return false;
+  }
+  mbedtls_ssl_set_bio(&_ssl, this, sendRecord, receiveRecord, nullptr);
+  sampleHeap();
+
+  elapsedMillis timer = 0;
+  while ((result = mbedtls_ssl_handshake(&_ssl)) != 0) {
+    if (result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      LOG_WARNING("Handshake failed (-0x%04X)", -result);
+      stop();
+      return false;
+    }
+    if (timer > TLS_HANDSHAKE_TIMEOUT_MS || checkDeadline()) {
+      LOG_WARNING("Handshake timed out");
+      stop();
+      return false;
+    }
+    delay(1);
+  }
+  sampleHeap();
+
+  _connected = true;
+  LOG_INFO("Connected using %s, %d byte records, %u bytes of heap in use (peak %u)",
+    mbedtls_ssl_get_ciphersuite(&_ssl), mbedtls_ssl_get_max_out_record_payload(&_ssl), _heapAtConnect - ESP.getFreeHeap(), heapPeak());
+  return true;
+}
+
+size_t LeanTLSClient::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t LeanTLSClient::write(const uint8_t* buffer, size_t size) {
+  if (!_connected || checkDeadline()) {
+    return 0;
+  }
+
+  size_t written = 0;
+  elapsedMillis timer = 0;
+  while (written < size) {
+    int result = mbedtls_ssl_write(&_ssl, buffer + written, size - written);
+    if (result > 0) {
+      written += result;
+      timer = 0;
+    }
+    else if ((result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) || timer > TLS_CONNECT_TIMEOUT_MS || checkDeadline()) {
+      stop();
+      break;
+    }
+  }
+  sampleHeap();
+  return written;
+}
+
+int LeanTLSClient::available() {
+  if (!_connected || checkDeadline()) {
+    return 0;
+  }
+  int pending = pendingBytes();
+  if (pending < 0) {
+    stop();
+    return _peeked >= 0 ? 1 : 0;
+  }
+  return pending + (_peeked >= 0 ? 1 : 0);
+}
+
+int LeanTLSClient::read() {
+  uint8_t data = 0;
+  return read(&data, 1) == 1 ? data : -1;
+}
+
+int LeanTLSClient::read(uint8_t* buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  int peeked = 0;
+  if (_peeked >= 0) {
+    buffer[0] = _peeked;
+    _peeked = -1;
+    if (--size == 0) {
+      return 1;
+    }
+    buffer++;
+    peeked = 1;
+  }
+
+  if (!_connected || checkDeadline()) {
+    return peeked > 0 ? peeked : -1;
+  }
+  int result = mbedtls_ssl_read(&_ssl, buffer, size);
+  if (result == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return peeked > 0 ? peeked : -1;
+  }
+  if (result <= 0) {                                                        // Closed by the server, or an error.
+    stop();
+    return peeked > 0 ? peeked : -1;
+  }
+  return result + peeked;
+}
+
+int LeanTLSClient::peek() {
+  if (_peeked < 0) {
+    _peeked = read();
+  }
+  return _peeked;
+}
+
+void LeanTLSClient::flush() {
+}
+
+/*
+* Closes the connection and frees everything mbedTLS allocated for it, logging the heap peak the connection reached.
+*/
+void LeanTLSClient::stop() {
+  _peeked = -1;
+  if (!_initialized) {
+    return;
+  }
+
+  if (_connected) {
+    mbedtls_ssl_close_notify(&_ssl);
+    LOG_DEBUG("Connection closed, heap peak %u bytes", heapPeak());
+  }
+  _connected = false;
+  mbedtls_net_free(&_socket);                                               // Closes the socket.
+  mbedtls_ssl_free(&_ssl);
+  mbedtls_ssl_config_free(&_config);
+  mbedtls_ctr_drbg_free(&_drbg);
+  mbedtls_entropy_free(&_entropy);
+  _initialized = false;
+}
+
+/*
+* Reports whether the connection is still open, noticing if the server has closed it since the last read.
+*/
+uint8_t LeanTLSClient::connected() {
+  if (_connected) {
+    available();
+  }
+  return _connected;
+}
+
+/*
+* The most heap the current (or last) connection has had in use at any one time, as sampled around each record sent and received.
+*/
+size_t LeanTLSClient::heapPeak() {
+  return _heapAtConnect > _lowestHeap ? _heapAtConnect - _lowestHeap : 0;
+}
+
+/*
+* Sets the millis() after which the connection is closed (or the connection attempt abandoned), for bounding how long a request can take.
+*/
+void LeanTLSClient::setDeadline(unsigned long deadline) {
+  _deadline = deadline;
+  _hasDeadline = true;
+  _expired = false;
+}
+
+/*
+* Removes the deadline, so the connection can stay open between requests.
+*/
+void LeanTLSClient::clearDeadline() {
+  _hasDeadline = false;
+}
+
+/*
+* Whether the connection was closed (or the connection attempt abandoned) for passing the deadline.
+*/
+bool LeanTLSClient::expired() {
+  return _expired;
+}
+
+/*
+* Closes the connection if the deadline has passed. Returns true if it has.
+*/
+bool LeanTLSClient::checkDeadline() {
+  if (!_hasDeadline || (long) (millis() - _deadline) < 0) {
+    return false;
+  }
+  if (_initialized) {
+    LOG_DEBUG("Deadline passed, closing connection");
+    stop();
+  }
+  _expired = true;
+  return true;
+}
+
+/*
+* Opens a non blocking TCP socket to ip, waiting up to timeout milliseconds for the connection to be accepted.
+*/
+bool LeanTLSClient::openSocket(IPAddress ip, uint16_t port, int32_t timeout) {
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return false;
+  }
+  _socket.fd = fd;
+  mbedtls_net_set_nonblock(&_socket);
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = (uint32_t) ip;
+
+  if (::connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+    return false;
+  }
+
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(fd, &writable);
+  struct timeval wait = { timeout / 1000, (timeout % 1000) * 1000 };
+  if (select(fd + 1, nullptr, &writable, nullptr, &wait) <= 0) {
+    return false;
+  }
+
+  int error = 0;
+  socklen_t length = sizeof(error);
+  getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+  return error == 0;
+}
+
+/*
+* Processes any records that have arrived and returns the number of decrypted bytes ready to read, or -1 if the connection has failed or been closed.
+*/
+int LeanTLSClient::pendingBytes() {
+  int result = mbedtls_ssl_read(&_ssl, nullptr, 0);
+  if (result < 0 && result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    return -1;
+  }
+  return mbedtls_ssl_get_bytes_avail(&_ssl);
+}
+
+void LeanTLSClient::sampleHeap() {
+  size_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < _lowestHeap) {
+    _lowestHeap = freeHeap;
+  }
+}
+
+/*
+* mbedTLS I/O callbacks, passing records to and from the socket and sampling the heap along the way so the handshake's peak is seen.
+*/
+int LeanTLSClient::sendRecord(void* context, const unsigned char* buffer, size_t length) {
+  LeanTLSClient* client = (LeanTLSClient*) context;
+  client->sampleHeap();
+  return mbedtls_net_send(&client->_socket, buffer, length);
+}
+
+int LeanTLSClient::receiveRecord(void* context, unsigned char* buffer, size_t length) {
+  LeanTLSClient* client = (LeanTLSClient*) context;
+  client->sampleHeap();
+  return mbedtls_net_recv(&client->_socket, buffer, length);
+}
\ No newline at end of file
@@ -8,37 +8,36 @@
 #include "globals_t93.h"
 #include "lcd_t93.h"
 #include "secrets_t93.h"
+#include "health_t93.h"
+#include "series_t93.h"
+#include "log_t93.h"
 #include "wifi_t93.h"
 
+#define LOG_MODULE WIFI
+
 /*
 * Initializes the WiFi on the ESP. Attempts to connect using saved WiFi name and password.
 * If connection fails, a fallback hotspot is spun up, including a configuration web portal.
 * This method can also be used to attempt WiFi reconnections.
 */
 void InitializeWiFi() {
-  DEBUG_SERIAL.println("Initializing WiFi");
+  LOG_INFO("Initializing WiFi");
   WriteToLCD("WiFi connecting");
   WiFi.mode(WIFI_STA);
 
   // Attempt connection using stored WiFi configuration.
   // This allows us to resolve connection drops without invoking WiFiManager.
-  WiFi.reconnect();
-  elapsedMillis timer = 0;
-  while (timer < WIFI_RECONN_TIMEOUT * 1000) {
-    if (IsWiFiConnected()) {
-      DEBUG_SERIAL.println("WiFi connected!");
-      WriteToLCD("WiFi connected!");
-      return;
-    }
-    delay(100);
+  if (ReconnectWiFi()) {
+    WriteToLCD("WiFi connected!");
+    return;
   }
 
   // WiFi auto-connection wasn't successful. Spin up portal for config.
-  DEBUG_SERIAL.println("WiFi connection failed");
+  LOG_WARNING("WiFi connection failed");
   WriteToLCD("Automatic WiFi", "reconnect failed");
   delay(3000);
 
-  DEBUG_SERIAL.println("Invoking WiFi configuration portal");
+  LOG_INFO("Invoking WiFi configuration portal");
   WriteToLCD("Generating WiFi", "config portal");
   delay(3000);
 
@@ -54,10 +53,11 @@ void InitializeWiFi() {
   sprintf(passwordText, "Pass: %s", SECRET_WIFI_PASSWORD);      // Build the text to be displayed on the LCD and store in the char[].
   
   // Non-blocking WiFi Manager instance to allow us to refresh the display while the portal is active.
-  timer = 0;
+  elapsedMillis timer = 0;
   int messageCount = 0;
   while (!IsWiFiConnected()) {
     wifiManager.process();
+    ReportHeartbeat(HeartbeatLoop);
 
     // Non-blocking LCD printing. Allows WifiManager to process quickly, only updating the LCD every 2-6-2-6 seconds.
     if (timer > 16000) {
@@ -82,17 +82,41 @@ void InitializeWiFi() {
     }
   }
 
-  DEBUG_SERIAL.println("WiFi connected!");
+  LOG_INFO("WiFi connected!");
   WriteToLCD("WiFi connected!");
-  DEBUG_SERIAL.println("WiFi initialized");
+  LOG_INFO("WiFi initialized");
+}
+
+/*
+* Attempts to reconnect using the saved WiFi configuration for up to WIFI_RECONN_TIMEOUT. Returns true if connected.
+* Unlike InitializeWiFi() this never opens the configuration portal and leaves the display alone, so a value on display stays there.
+*/
+bool ReconnectWiFi() {
+  LOG_INFO("Reconnecting WiFi");
+  WiFi.reconnect();
+  elapsedMillis timer = 0;
+  while (timer < WIFI_RECONN_TIMEOUT * 1000) {
+    ReportHeartbeat(HeartbeatLoop);                             // Waiting here is progress, not loop() stalling.
+    if (IsWiFiConnected()) {
+      LOG_INFO("WiFi connected!");
+      return true;
+    }
+    delay(100);
+  }
+  LOG_WARNING("WiFi reconnect timed out");
+  return false;
 }
 
 /*
 * Called when the ESP cannot connect to saved WiFi, the portal timed out and no clients were connected to the AP.
+* The values held are kept for the restart, as for any other (see SaveWarmStart()).
 */
 void PortalTimeoutCallback() {
-  DEBUG_SERIAL.println("WiFi config portal timeout - rebooting ESP");
+  LOG_ERROR("WiFi config portal timeout - rebooting ESP");
   WriteToLCD("WiFi timeout", "rebooting...");
+  SaveWarmStart(FaultNone);                                     // Not a health fault, so nothing is reported for it after the restart.
+  FlushSeries();
+  FlushLog(1000);
   ESP.restart();
 }
 
@@ -0,0 +1,225 @@
+#ifndef _T93_NATIVE_ARDUINO_h
+#define _T93_NATIVE_ARDUINO_h
+
+// Just enough of the ESP32 Arduino core for the firmware's hardware independent modules to build and run on the host ([env:native]).
+// Tasks are threads, the heap is the host's (see heap_hooks.h) and millis() can be moved forward by tests with AdvanceMillis().
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+typedef uint8_t byte;
+typedef unsigned int UBaseType_t;
+typedef int BaseType_t;
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+
+#define pdMS_TO_TICKS(ms)     (ms)
+#define pdPASS                1
+#define portMAX_DELAY         0xFFFFFFFF
+#define tskIDLE_PRIORITY      0
+#define MALLOC_CAP_DEFAULT    0
+#define MALLOC_CAP_8BIT       0
+#define NATIVE_HEAP_SIZE      327680  // What heap_caps_get_info() reports the heap as totalling, roughly the ESP32's DRAM.
+
+inline std::atomic<long> nativeMillisSkipped(0);     // How far AdvanceMillis() has moved millis() ahead of the host's clock.
+inline std::atomic<long> nativeHeapUsed(0);          // Tracked by heap_hooks.h when a test includes it, otherwise always 0.
+inline std::atomic<long> nativeHeapPeak(0);          // The most nativeHeapUsed has been since heap_caps_get_info() was last called.
+inline std::atomic<long> nativeHeapBlocks(0);
+
+inline uint64_t NativeNanos() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+  return (unsigned long) (NativeNanos() / 1000000) + nativeMillisSkipped.load();
+}
+
+inline unsigned long micros() {
+  return (unsigned long) (NativeNanos() / 1000) + nativeMillisSkipped.load() * 1000UL;
+}
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/*
+* Moves millis() forward without waiting, for tests of timeouts and spacing.
+*/
+inline void AdvanceMillis(unsigned long ms) {
+  nativeMillisSkipped += ms;
+}
+
+inline uint32_t getCpuFreqMHz() {
+  return 1000;                                      // ESP.getCycleCount() counts nanoseconds, so this turns cycles back into time.
+}
+
+inline uint32_t esp_random() {
+  static std::mt19937 generator(std::random_device{}());
+  return generator();
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t, void* parameter, UBaseType_t, TaskHandle_t*, int) {
+  std::thread(task, parameter).detach();
+  return pdPASS;
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+  return 0;                                         // Host threads have no stack watermark, stack growth always reads as 0.
+}
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+/*
+* Unlike on the ESP32, where it is the least free heap since boot, minimum_free_bytes is the least since the last call.
+* So a call either side of some code gives the most heap it had allocated at once.
+*/
+inline void heap_caps_get_info(multi_heap_info_t* info, uint32_t) {
+  long used = nativeHeapUsed.load();
+  long peak = nativeHeapPeak.exchange(used);
+  memset(info, 0, sizeof(*info));
+  info->total_free_bytes = NATIVE_HEAP_SIZE - used;
+  info->total_allocated_bytes = used;
+  info->largest_free_block = NATIVE_HEAP_SIZE - used;
+  info->minimum_free_bytes = NATIVE_HEAP_SIZE - max(peak, used);
+  info->allocated_blocks = nativeHeapBlocks.load();
+}
+
+inline size_t heap_caps_get_free_size(uint32_t) {
+  return NATIVE_HEAP_SIZE - nativeHeapUsed.load();
+}
+
+inline size_t heap_caps_get_largest_free_block(uint32_t capabilities) {
+  return heap_caps_get_free_size(capabilities);
+}
+
+class String {
+  public:
+    String() {}
+    String(const char* text) : _text(text != nullptr ? text : "") {}
+    String(int value) : _text(std::to_string(value)) {}
+    const char* c_str() const { return _text.c_str(); }
+    unsigned int length() const { return _text.length(); }
+    bool isEmpty() const { return _text.empty(); }
+    bool operator==(const char* text) const { return _text == text; }
+    bool equalsIgnoreCase(const String& other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+
+  private:
+    std::string _text;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+
+    virtual size_t write(const uint8_t* data, size_t size) {
+      size_t written = 0;
+      while (written < size && write(data[written]) == 1) {
+        written++;
+      }
+      return written;
+    }
+
+    size_t write(const char* text) { return write((const uint8_t*) text, strlen(text)); }
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t println(const char* text) { return print(text) + println(); }
+    size_t println(int value) { return print(value) + println(); }
+    size_t println() { return write("\r\n"); }
+    virtual void flush() {}
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+      char line[256];
+      va_list args;
+      va_start(args, format);
+      int length = vsnprintf(line, sizeof(line), format, args);
+      va_end(args);
+      return length > 0 ? write((const uint8_t*) line, min((size_t) length, sizeof(line) - 1)) : 0;
+    }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long) {}
+};
+
+// Serial output goes to stdout.
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t data) override { return fwrite(&data, 1, 1, stdout); }
+    size_t write(const uint8_t* data, size_t size) override { return fwrite(data, 1, size, stdout); }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() { return 4096; }
+    void flush() override { fflush(stdout); }
+};
+
+inline HardwareSerial Serial;
+
+class IPAddress {
+  public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address(a | (b << 8) | (c << 16) | ((uint32_t) d << 24)) {}
+    operator uint32_t() const { return _address; }
+    uint8_t operator[](int index) const { return _address >> (index * 8); }
+
+  private:
+    uint32_t _address;              // In network order, as lwIP keeps it.
+};
+
+class EspClass {
+  public:
+    uint32_t getCycleCount() { return (uint32_t) NativeNanos(); }
+    uint32_t getFreeHeap() { return heap_caps_get_free_size(MALLOC_CAP_DEFAULT); }
+    uint32_t getMaxAllocHeap() { return getFreeHeap(); }
+    void restart() { exit(0); }
+};
+
+inline EspClass ESP;
+
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}   // The host's clock is already set.
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#ifndef _T93_NATIVE_LITTLEFS_h
+#define _T93_NATIVE_LITTLEFS_h
+
+// LittleFS over a scratch directory on the host. Sizes are counted in whole 4 KB blocks, as LittleFS allocates them on the ESP32.
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_READ             "r"
+#define FILE_WRITE            "w"
+#define FILE_APPEND           "a"
+#define NATIVE_FS_BLOCK       4096
+#define NATIVE_FS_BLOCKS      32    // 128 KB, the size of the partition in partitions/dual_ota.csv.
+
+inline std::atomic<int> nativeFileWrites(0);        // Files opened for writing since the filesystem was mounted.
+
+namespace fs {
+
+class File : public Stream {
+  public:
+    File() {}
+    File(const std::string& path, const std::string& name, FILE* file, DIR* directory) : _path(path), _name(name), _file(file), _directory(directory) {}
+
+    File(const File& other) = delete;
+    File& operator=(const File& other) = delete;
+    File(File&& other) { *this = std::move(other); }
+    File& operator=(File&& other) {
+      close();
+      std::swap(_path, other._path);
+      std::swap(_name, other._name);
+      std::swap(_file, other._file);
+      std::swap(_directory, other._directory);
+      return *this;
+    }
+    ~File() { close(); }
+
+    size_t write(uint8_t data) override { return write(&data, 1); }
+    size_t write(const uint8_t* data, size_t size) override { return _file != nullptr ? fwrite(data, 1, size, _file) : 0; }
+    int available() override { return _file != nullptr ? size() - position() : 0; }
+    int read() override { uint8_t data; return read(&data, 1) == 1 ? data : -1; }
+    int peek() override { int data = read(); if (data >= 0) { seek(position() - 1); } return data; }
+    size_t read(uint8_t* data, size_t size) { return _file != nullptr ? fread(data, 1, size, _file) : 0; }
+    bool seek(uint32_t position) { return _file != nullptr && fseek(_file, position, SEEK_SET) == 0; }
+    size_t position() const { return _file != nullptr ? ftell(_file) : 0; }
+    const char* name() const { return _name.c_str(); }
+    bool isDirectory() const { return _directory != nullptr; }
+    operator bool() const { return _file != nullptr || _directory != nullptr; }
+
+    size_t size() const {
+      struct stat status;
+      if (_file != nullptr) {
+        fflush(_file);
+      }
+      return stat(_path.c_str(), &status) == 0 ? status.st_size : 0;
+    }
+
+    void close() {
+      if (_file != nullptr) {
+        fclose(_file);
+      }
+      if (_directory != nullptr) {
+        closedir(_directory);
+      }
+      _file = nullptr;
+      _directory = nullptr;
+    }
+
+    File openNextFile(const char* mode = FILE_READ) {
+      struct dirent* entry;
+      while (_directory != nullptr && (entry = readdir(_directory)) != nullptr) {
+        if (entry->d_type == DT_REG) {
+          std::string path = _path + "/" + entry->d_name;
+          return File(path, entry->d_name, fopen(path.c_str(), mode[0] == 'r' ? "rb" : "ab"), nullptr);
+        }
+      }
+      return File();
+    }
+
+  private:
+    std::string _path;
+    std::string _name;
+    FILE* _file = nullptr;
+    DIR* _directory = nullptr;
+};
+
+class LittleFSFS {
+  public:
+    /*
+    * Mounts a fresh, empty filesystem in a scratch directory.
+    */
+    bool begin(bool = false) {
+      if (_root.empty()) {
+        char root[] = "/tmp/t93-littlefs-XXXXXX";
+        if (mkdtemp(root) == nullptr) {
+          return false;
+        }
+        _root = root;
+      }
+      nativeFileWrites = 0;
+      return true;
+    }
+
+    void end() {
+      if (!_root.empty()) {
+        std::string command = "rm -rf " + _root;
+        system(command.c_str());
+        _root.clear();
+      }
+    }
+
+    size_t totalBytes() { return NATIVE_FS_BLOCKS * NATIVE_FS_BLOCK; }
+    size_t usedBytes() { return (countBlocks(_root) + 2) * NATIVE_FS_BLOCK; }   // Plus the superblock pair.
+    bool mkdir(const char* path) { return ::mkdir((_root + path).c_str(), 0755) == 0; }
+    bool remove(const char* path) { return unlink((_root + path).c_str()) == 0; }
+    bool exists(const char* path) { struct stat status; return stat((_root + path).c_str(), &status) == 0; }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+      std::string fullPath = _root + path;
+      std::string name = strrchr(path, '/') != nullptr ? strrchr(path, '/') + 1 : path;
+      struct stat status;
+      if (mode[0] == 'r' && stat(fullPath.c_str(), &status) == 0 && S_ISDIR(status.st_mode)) {
+        return File(fullPath, name, nullptr, opendir(fullPath.c_str()));
+      }
+      if (mode[0] != 'r') {
+        nativeFileWrites++;
+      }
+      return File(fullPath, name, fopen(fullPath.c_str(), mode[0] == 'r' ? "rb" : mode[0] == 'w' ? "wb" : "ab"), nullptr);
+    }
+
+  private:
+    /*
+    * Blocks used by the files in a directory and those below it, each directory taking a block of its own.
+    */
+    size_t countBlocks(const std::string& path) {
+      DIR* directory = opendir(path.c_str());
+      if (directory == nullptr) {
+        return 0;
+      }
+      size_t blocks = 1;
+      struct dirent* entry;
+      while ((entry = readdir(directory)) != nullptr) {
+        std::string entryPath = path + "/" + entry->d_name;
+        struct stat status;
+        if (entry->d_name[0] == '.' || stat(entryPath.c_str(), &status) != 0) {
+          continue;
+        }
+        blocks += S_ISDIR(status.st_mode) ? countBlocks(entryPath) : (status.st_size + NATIVE_FS_BLOCK - 1) / NATIVE_FS_BLOCK;
+      }
+      closedir(directory);
+      return blocks;
+    }
+
+    std::string _root;
+};
+
+}
+
+using fs::File;
+
+inline fs::LittleFSFS LittleFS;
+
+#endif
\ No newline at end of file
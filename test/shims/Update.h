@@ -0,0 +1,65 @@
+#ifndef _T93_NATIVE_UPDATE_h
+#define _T93_NATIVE_UPDATE_h
+
+// The Arduino core's Update, flashing into memory. What has been written can be checked in Update.written.
+
+#include <Arduino.h>
+#include <vector>
+
+#define UPDATE_SIZE_UNKNOWN   0xFFFFFFFF
+#define NATIVE_APP_PARTITION  0x1E0000  // The size of each app partition in partitions/dual_ota.csv.
+
+class UpdateClass {
+  public:
+    /*
+    * Starts an update of the given size, or of up to the whole partition if unknown.
+    */
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN) {
+      written.clear();
+      _capacity = size == UPDATE_SIZE_UNKNOWN ? NATIVE_APP_PARTITION : size;
+      _error = _capacity <= NATIVE_APP_PARTITION ? nullptr : "Not Enough Space";
+      _started = _error == nullptr;
+      return _started;
+    }
+
+    size_t write(uint8_t* data, size_t size) {
+      if (!_started || _error != nullptr) {
+        return 0;
+      }
+      size_t count = min(size, _capacity - written.size());
+      if (count < size) {
+        _error = "Not Enough Space";
+      }
+      written.insert(written.end(), data, data + count);
+      return count;
+    }
+
+    bool end(bool evenIfRemaining = false) {
+      if (_started && _error == nullptr && !evenIfRemaining && written.size() < _capacity) {
+        _error = "Bad Size Given";
+      }
+      bool ended = _started && _error == nullptr && !written.empty();
+      _started = false;
+      return ended;
+    }
+
+    void abort() {
+      _started = false;
+      _error = "Aborted";
+    }
+
+    bool hasError() { return _error != nullptr; }
+    uint8_t getError() { return _error != nullptr ? 1 : 0; }
+    const char* errorString() { return _error != nullptr ? _error : "No Error"; }
+
+    std::vector<uint8_t> written;   // Everything flashed since begin().
+
+  private:
+    size_t _capacity = 0;
+    const char* _error = nullptr;
+    bool _started = false;
+};
+
+inline UpdateClass Update;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef _T93_NATIVE_WIFI_h
+#define _T93_NATIVE_WIFI_h
+
+#include <Arduino.h>
+
+#define WL_CONNECTED          3
+#define WL_DISCONNECTED       6
+
+// Always connected, with a MAC address tests can set.
+class WiFiClass {
+  public:
+    int status() { return WL_CONNECTED; }
+    void macAddress(uint8_t* mac) { memcpy(mac, _mac, sizeof(_mac)); }
+    void setMacAddress(const uint8_t* mac) { memcpy(_mac, mac, sizeof(_mac)); }
+
+  private:
+    uint8_t _mac[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01 };
+};
+
+inline WiFiClass WiFi;
+
+#endif
\ No newline at end of file
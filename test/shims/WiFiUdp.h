@@ -0,0 +1,111 @@
+#ifndef _T93_NATIVE_WIFIUDP_h
+#define _T93_NATIVE_WIFIUDP_h
+
+// UDP over POSIX sockets. Multicast stays on the loopback interface, so every socket in the group on this host hears every packet.
+
+#include <WiFi.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NATIVE_UDP_SIZE       1500
+
+class WiFiUDP : public Stream {
+  public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t beginMulticast(IPAddress group, uint16_t port) {
+      stop();
+      _socket = socket(AF_INET, SOCK_DGRAM, 0);
+      int enable = 1;
+      setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+      setsockopt(_socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+      struct sockaddr_in address = {};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_ANY);
+      struct ip_mreq membership = {};
+      membership.imr_multiaddr.s_addr = (uint32_t) group;
+      membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+      struct in_addr interface = { htonl(INADDR_LOOPBACK) };
+      unsigned char loop = 1;
+      if (bind(_socket, (struct sockaddr*) &address, sizeof(address)) != 0
+        || setsockopt(_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0
+        || setsockopt(_socket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0
+        || setsockopt(_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0) {
+        stop();
+        return 0;
+      }
+      return 1;
+    }
+
+    void stop() {
+      if (_socket >= 0) {
+        close(_socket);
+      }
+      _socket = -1;
+      _received = 0;
+      _position = 0;
+    }
+
+    /*
+    * Takes the next datagram, returning its size or 0 if none is waiting.
+    */
+    int parsePacket() {
+      ssize_t size = _socket >= 0 ? recv(_socket, _packet, sizeof(_packet), MSG_DONTWAIT) : -1;
+      _received = size > 0 ? size : 0;
+      _position = 0;
+      return _received;
+    }
+
+    int read(uint8_t* data, size_t size) {
+      size_t count = min(size, _received - _position);
+      memcpy(data, _packet + _position, count);
+      _position += count;
+      return count;
+    }
+
+    int read() override { uint8_t data; return read(&data, 1) == 1 ? data : -1; }
+    int peek() override { return _position < _received ? _packet[_position] : -1; }
+    int available() override { return _received - _position; }
+
+    int beginPacket(IPAddress destination, uint16_t port) {
+      _destination = destination;
+      _port = port;
+      _sending = 0;
+      return 1;
+    }
+
+    size_t write(uint8_t data) override { return write(&data, 1); }
+
+    size_t write(const uint8_t* data, size_t size) override {
+      size_t count = min(size, sizeof(_outgoing) - _sending);
+      memcpy(_outgoing + _sending, data, count);
+      _sending += count;
+      return count;
+    }
+
+    using Print::write;
+
+    int endPacket() {
+      struct sockaddr_in address = {};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(_port);
+      address.sin_addr.s_addr = (uint32_t) _destination;
+      return _socket >= 0 && sendto(_socket, _outgoing, _sending, 0, (struct sockaddr*) &address, sizeof(address)) == (ssize_t) _sending;
+    }
+
+  private:
+    int _socket = -1;
+    uint8_t _packet[NATIVE_UDP_SIZE];
+    size_t _received = 0;
+    size_t _position = 0;
+    uint8_t _outgoing[NATIVE_UDP_SIZE];
+    size_t _sending = 0;
+    IPAddress _destination;
+    uint16_t _port = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef _T93_NATIVE_WIRE_h
+#define _T93_NATIVE_WIRE_h
+
+#include <Arduino.h>
+
+// Declarations only. No native test drives the I2C bus, the LCD modules aren't built for the host.
+class TwoWire {
+  public:
+    void begin();
+    void setClock(uint32_t);
+    void beginTransmission(uint8_t);
+    uint8_t endTransmission();
+};
+
+extern TwoWire Wire;
+
+#endif
\ No newline at end of file
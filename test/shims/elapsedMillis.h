@@ -0,0 +1,17 @@
+#ifndef _T93_NATIVE_ELAPSEDMILLIS_h
+#define _T93_NATIVE_ELAPSEDMILLIS_h
+
+#include <Arduino.h>
+
+class elapsedMillis {
+  public:
+    elapsedMillis() : _start(millis()) {}
+    elapsedMillis(unsigned long value) : _start(millis() - value) {}
+    operator unsigned long() const { return millis() - _start; }
+    elapsedMillis& operator=(unsigned long value) { _start = millis() - value; return *this; }
+
+  private:
+    unsigned long _start;
+};
+
+#endif
\ No newline at end of file
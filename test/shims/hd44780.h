@@ -0,0 +1,21 @@
+#ifndef _T93_NATIVE_HD44780_h
+#define _T93_NATIVE_HD44780_h
+
+#include <Arduino.h>
+
+// Declarations only, so globals_t93.h can be included. No native test drives an LCD.
+class hd44780 : public Print {
+  public:
+    int begin(uint8_t, uint8_t);
+    int clear();
+    int home();
+    int setCursor(uint8_t, uint8_t);
+    int createChar(uint8_t, const uint8_t*);
+    int scrollDisplayLeft();
+    int backlight();
+    int noBacklight();
+    size_t write(uint8_t) override;
+    using Print::write;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef _T93_NATIVE_HD44780_I2CEXP_h
+#define _T93_NATIVE_HD44780_I2CEXP_h
+
+#include <hd44780.h>
+
+class hd44780_I2Cexp : public hd44780 {
+  public:
+    hd44780_I2Cexp();
+    hd44780_I2Cexp(uint8_t);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef _T93_NATIVE_HEAP_HOOKS_h
+#define _T93_NATIVE_HEAP_HOOKS_h
+
+// Counts the host heap in use for heap_caps_get_info(), by wrapping glibc's allocator. Include from one file of a test only.
+// Without glibc the heap isn't tracked and always reads as unused.
+
+#include <Arduino.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+extern "C" {
+
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void __libc_free(void*);
+
+inline void NativeHeapAllocated(void* block) {
+  if (block != nullptr) {
+    long used = nativeHeapUsed += malloc_usable_size(block);
+    nativeHeapBlocks++;
+    long peak = nativeHeapPeak.load();
+    while (used > peak && !nativeHeapPeak.compare_exchange_weak(peak, used)) {}
+  }
+}
+
+inline void NativeHeapFreed(void* block) {
+  if (block != nullptr) {
+    nativeHeapUsed -= malloc_usable_size(block);
+    nativeHeapBlocks--;
+  }
+}
+
+void* malloc(size_t size) {
+  void* block = __libc_malloc(size);
+  NativeHeapAllocated(block);
+  return block;
+}
+
+void* calloc(size_t count, size_t size) {
+  void* block = __libc_calloc(count, size);
+  NativeHeapAllocated(block);
+  return block;
+}
+
+void* realloc(void* block, size_t size) {
+  NativeHeapFreed(block);
+  void* moved = __libc_realloc(block, size);
+  NativeHeapAllocated(moved != nullptr || size == 0 ? moved : block);
+  return moved;
+}
+
+void free(void* block) {
+  NativeHeapFreed(block);
+  __libc_free(block);
+}
+
+}
+#endif
+
+#endif
\ No newline at end of file
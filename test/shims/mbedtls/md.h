@@ -0,0 +1,62 @@
+#ifndef _T93_NATIVE_MD_h
+#define _T93_NATIVE_MD_h
+
+// mbedtls' message digest interface, for HMAC-SHA256 only.
+
+#include "mbedtls/sha256.h"
+
+typedef enum {
+  MBEDTLS_MD_NONE = 0,
+  MBEDTLS_MD_SHA256 = 6
+} mbedtls_md_type_t;
+
+typedef struct {
+  mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+inline const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type) {
+  static const mbedtls_md_info_t sha256 = { MBEDTLS_MD_SHA256 };
+  return type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+/*
+* HMAC (RFC 2104) of input under key, written to output (32 bytes).
+*/
+inline int mbedtls_md_hmac(const mbedtls_md_info_t* info, const unsigned char* key, size_t keyLength, const unsigned char* input, size_t inputLength,
+  unsigned char* output) {
+  if (info == nullptr) {
+    return -1;
+  }
+
+  uint8_t block[64] = {};
+  mbedtls_sha256_context context;
+  if (keyLength > sizeof(block)) {
+    mbedtls_sha256_starts_ret(&context, 0);
+    mbedtls_sha256_update_ret(&context, key, keyLength);
+    mbedtls_sha256_finish_ret(&context, block);
+  }
+  else {
+    memcpy(block, key, keyLength);
+  }
+
+  uint8_t pad[64];
+  uint8_t inner[32];
+  for (int i = 0; i < 64; i++) {
+    pad[i] = block[i] ^ 0x36;
+  }
+  mbedtls_sha256_starts_ret(&context, 0);
+  mbedtls_sha256_update_ret(&context, pad, sizeof(pad));
+  mbedtls_sha256_update_ret(&context, input, inputLength);
+  mbedtls_sha256_finish_ret(&context, inner);
+
+  for (int i = 0; i < 64; i++) {
+    pad[i] = block[i] ^ 0x5C;
+  }
+  mbedtls_sha256_starts_ret(&context, 0);
+  mbedtls_sha256_update_ret(&context, pad, sizeof(pad));
+  mbedtls_sha256_update_ret(&context, inner, sizeof(inner));
+  mbedtls_sha256_finish_ret(&context, output);
+  return 0;
+}
+
+#endif
\ No newline at end of file
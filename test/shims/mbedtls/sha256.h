@@ -0,0 +1,107 @@
+#ifndef _T93_NATIVE_SHA256_h
+#define _T93_NATIVE_SHA256_h
+
+// mbedtls' SHA-256 interface (the 2.x _ret functions the ESP32 Arduino core ships), implemented directly from FIPS 180-4.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+  uint32_t state[8];
+  uint64_t length;                  // Bytes hashed so far.
+  uint8_t block[64];
+} mbedtls_sha256_context;
+
+inline void mbedtls_sha256_init(mbedtls_sha256_context* context) {
+  memset(context, 0, sizeof(*context));
+}
+
+inline void mbedtls_sha256_free(mbedtls_sha256_context* context) {
+  memset(context, 0, sizeof(*context));
+}
+
+inline int mbedtls_sha256_starts_ret(mbedtls_sha256_context* context, int is224) {
+  static const uint32_t initial[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+  if (is224) {
+    return -1;                      // Only SHA-256 is needed.
+  }
+  memcpy(context->state, initial, sizeof(initial));
+  context->length = 0;
+  return 0;
+}
+
+inline void mbedtls_sha256_block(mbedtls_sha256_context* context, const uint8_t* block) {
+  static const uint32_t k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+  auto rotate = [](uint32_t value, int bits) { return (value >> bits) | (value << (32 - bits)); };
+
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) | ((uint32_t) block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  uint32_t v[8];
+  memcpy(v, context->state, sizeof(v));
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = v[7] + (rotate(v[4], 6) ^ rotate(v[4], 11) ^ rotate(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+    uint32_t t2 = (rotate(v[0], 2) ^ rotate(v[0], 13) ^ rotate(v[0], 22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+    memmove(v + 1, v, sizeof(uint32_t) * 7);
+    v[4] += t1;
+    v[0] = t1 + t2;
+  }
+  for (int i = 0; i < 8; i++) {
+    context->state[i] += v[i];
+  }
+}
+
+inline int mbedtls_sha256_update_ret(mbedtls_sha256_context* context, const unsigned char* data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    context->block[context->length++ % 64] = data[i];
+    if (context->length % 64 == 0) {
+      mbedtls_sha256_block(context, context->block);
+    }
+  }
+  return 0;
+}
+
+inline int mbedtls_sha256_finish_ret(mbedtls_sha256_context* context, unsigned char* output) {
+  uint64_t bits = context->length * 8;
+  uint8_t padding = 0x80;
+  mbedtls_sha256_update_ret(context, &padding, 1);
+  padding = 0;
+  while (context->length % 64 != 56) {
+    mbedtls_sha256_update_ret(context, &padding, 1);
+  }
+  for (int i = 7; i >= 0; i--) {
+    uint8_t lengthByte = bits >> (i * 8);
+    mbedtls_sha256_update_ret(context, &lengthByte, 1);
+  }
+  for (int i = 0; i < 32; i++) {
+    output[i] = context->state[i / 4] >> (24 - (i % 4) * 8);
+  }
+  return 0;
+}
+
+inline int mbedtls_sha256_ret(const unsigned char* input, size_t size, unsigned char* output, int is224) {
+  mbedtls_sha256_context context;
+  mbedtls_sha256_init(&context);
+  mbedtls_sha256_starts_ret(&context, is224);
+  mbedtls_sha256_update_ret(&context, input, size);
+  mbedtls_sha256_finish_ret(&context, output);
+  mbedtls_sha256_free(&context);
+  return 0;
+}
+
+#endif
\ No newline at end of file
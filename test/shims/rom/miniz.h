@@ -0,0 +1,101 @@
+#ifndef _T93_NATIVE_MINIZ_h
+#define _T93_NATIVE_MINIZ_h
+
+// The ESP32 ROM's tinfl interface, implemented with the host's zlib (link with -lz).
+// zlib keeps its own window, so unlike tinfl the output buffer isn't read back for references. Its contents are the same either way.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <zlib.h>
+
+typedef unsigned char mz_uint8;
+typedef uint32_t mz_uint32;
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+#define TINFL_LZ_DICT_SIZE    32768
+#define TINFL_ARENA_SIZE      (48 * 1024) // Holds zlib's state and window, so freeing the decompressor frees everything.
+
+typedef struct {
+  mz_uint32 m_state;                // 0 until the first call has set up the stream, as tinfl_init() leaves it.
+  int m_result;                     // The status once the stream has ended or failed, which every later call returns.
+  z_stream m_stream;
+  size_t m_arena_used;
+  alignas(16) uint8_t m_arena[TINFL_ARENA_SIZE];
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+inline voidpf tinfl_arena_alloc(voidpf opaque, uInt items, uInt size) {
+  tinfl_decompressor* r = (tinfl_decompressor*) opaque;
+  size_t bytes = ((size_t) items * size + 15) & ~(size_t) 15;
+  if (r->m_arena_used + bytes > sizeof(r->m_arena)) {
+    return Z_NULL;
+  }
+  voidpf block = r->m_arena + r->m_arena_used;
+  r->m_arena_used += bytes;
+  return block;
+}
+
+inline void tinfl_arena_free(voidpf, voidpf) {}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* pIn_buf_next, size_t* pIn_buf_size, mz_uint8* pOut_buf_start,
+  mz_uint8* pOut_buf_next, size_t* pOut_buf_size, const mz_uint32 decomp_flags) {
+  (void) pOut_buf_start;
+  if (r->m_state == 0) {
+    memset(&r->m_stream, 0, sizeof(r->m_stream));
+    r->m_arena_used = 0;
+    r->m_stream.zalloc = tinfl_arena_alloc;
+    r->m_stream.zfree = tinfl_arena_free;
+    r->m_stream.opaque = r;
+    if (inflateInit2(&r->m_stream, decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER ? 15 : -15) != Z_OK) {
+      return TINFL_STATUS_BAD_PARAM;
+    }
+    r->m_state = 1;
+    r->m_result = TINFL_STATUS_NEEDS_MORE_INPUT;
+  }
+  if (r->m_result <= TINFL_STATUS_DONE) {
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    return (tinfl_status) r->m_result;
+  }
+
+  r->m_stream.next_in = (Bytef*) pIn_buf_next;
+  r->m_stream.avail_in = *pIn_buf_size;
+  r->m_stream.next_out = pOut_buf_next;
+  r->m_stream.avail_out = *pOut_buf_size;
+  int result = *pOut_buf_size > 0 ? inflate(&r->m_stream, Z_NO_FLUSH) : Z_BUF_ERROR;
+  *pIn_buf_size -= r->m_stream.avail_in;
+  *pOut_buf_size -= r->m_stream.avail_out;
+
+  if (result == Z_STREAM_END) {
+    r->m_result = TINFL_STATUS_DONE;
+  }
+  else if (result != Z_OK && result != Z_BUF_ERROR) {
+    r->m_result = TINFL_STATUS_FAILED;
+  }
+  else if (r->m_stream.avail_out == 0) {
+    return TINFL_STATUS_HAS_MORE_OUTPUT;          // zlib can't say whether it has more, so assume it does as tinfl would if it did.
+  }
+  else {
+    return TINFL_STATUS_NEEDS_MORE_INPUT;
+  }
+  return (tinfl_status) r->m_result;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef _T93_NATIVE_SECRETS_h
+#define _T93_NATIVE_SECRETS_h
+
+// Stands in for include/secrets_t93.h, which isn't committed. The fleet key and the labels (as in include/secrets.h.sample) are used on the host.
+#define SECRET_FLEET_KEY "Native Test Fleet Key"
+
+const char _valueLabel[][MAX_VALUE_LENGTH] = {
+  "Title 1",
+  "Title 2",
+  "Title 3"
+};
+
+const char _valueSelectionSummary[][2][17] = {
+  { "A description", "for title 1" },
+  { "A description", "for title 2" },
+  { "A description", "for title 3" }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <unity.h>
+#include <heap_hooks.h>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+#include "payload_t93.h"
+#include "log_t93.h"
+#include "series_t93.h"
+#include "bench_t93.h"
+
+void setUp() {}
+void tearDown() {}
+
+/*
+* The baseline pipeline should find every value in a generated payload that fits the response buffer, with the asterisk stripped.
+*/
+void test_baseline_pipeline_splits_generated_payloads() {
+  static char payload[BENCH_MAX_PAYLOAD];
+  static char* values[BENCH_MAX_PAYLOAD / 2];
+
+  for (int a = AsteriskAbsent; a <= AsteriskLast; a++) {
+    int length = GenerateBenchPayload(payload, 8, 7, static_cast<BenchAsteriskPosition>(a));
+    TEST_ASSERT_EQUAL(8, BaselinePayloadPipeline(payload, values, LEN(values)));
+    TEST_ASSERT_EQUAL(7, strlen(values[0]));
+    TEST_ASSERT_EQUAL(7, strlen(values[7]));
+    TEST_ASSERT_TRUE(length < RESPONSE_BUFFER_SIZE);
+  }
+
+  GenerateBenchPayload(payload, 32, 15, AsteriskFirst);
+  TEST_ASSERT_EQUAL(-1, BaselinePayloadPipeline(payload, values, LEN(values)));   // Larger than the response buffer.
+}
+
+/*
+* Logs the payload pipeline timings, with the exact peak heap the host can measure.
+*/
+void test_payload_benchmark() {
+  RunPayloadBenchmark();
+}
+
+/*
+* A series polled on schedule that barely changes fits far more than SERIES_SEAL_MINUTES of samples in a chunk,
+* so it should be written as the seal falls due: no file holding a sample older than that when its last sample was taken.
+*/
+void test_bench_series_seals_on_schedule() {
+  BenchSeries series;
+  TEST_ASSERT_TRUE(EncodeBenchSeries(SeriesFlat, series));
+
+  int samples = 0;
+  for (int f = 0; f < series.fileCount; f++) {
+    int first = f == 0 ? 0 : series.fileEnds[f - 1];
+    TEST_ASSERT_TRUE(series.fileEnds[f] > first);
+    TEST_ASSERT_TRUE(series.fileEnds[f] - first <= SERIES_SEGMENT_CHUNKS);
+    const SeriesChunkHeader& last = series.chunks[series.fileEnds[f] - 1].header;
+    TEST_ASSERT_TRUE(last.lastTime - series.chunks[first].header.firstTime <= SERIES_SEAL_MINUTES * 60UL + SERIES_SAMPLE_SECONDS);
+  }
+  for (int c = 0; c < series.chunkCount; c++) {
+    samples += series.chunks[c].header.count;
+  }
+  TEST_ASSERT_EQUAL(series.chunkCount, series.fileEnds[series.fileCount - 1]);
+  TEST_ASSERT_EQUAL(SERIES_BENCH_SAMPLES, samples);
+  TEST_ASSERT_TRUE(series.fileCount > SERIES_BENCH_SAMPLES * SERIES_SAMPLE_SECONDS / (SERIES_SEAL_MINUTES * 60) - 1);
+  FreeBenchSeries(series);
+}
+
+/*
+* Logs the series store's encoding sizes and timings, which don't depend on the hardware. Flash timings are left to RunSeriesBenchmark() on the ESP32.
+*/
+void test_series_encoding_benchmark() {
+  RunSeriesEncodingBenchmark();
+}
+
+int main(int argc, char** argv) {
+  InitializeLogging();                                                      // The benchmarks report through the log, written out by its drain task.
+  UNITY_BEGIN();
+  RUN_TEST(test_baseline_pipeline_splits_generated_payloads);
+  RUN_TEST(test_payload_benchmark);
+  RUN_TEST(test_bench_series_seals_on_schedule);
+  RUN_TEST(test_series_encoding_benchmark);
+  return UNITY_END();
+}
\ No newline at end of file
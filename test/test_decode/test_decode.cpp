@@ -0,0 +1,212 @@
+#include <unity.h>
+#include <zlib.h>
+#include <vector>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+#include "decode_t93.h"
+
+// Bodies are compressed here with the host's zlib, and decoded by PayloadDecoder through the zlib-backed tinfl in test/shims.
+
+static std::vector<uint8_t> payload;                // A typical API response, repetitive enough for deflate to use back references.
+static std::vector<uint8_t> image;                  // A body several times the inflate window, as a firmware image would be.
+
+/*
+* Compresses data with the given zlib windowBits: 15 for zlib, -15 for raw deflate, 31 for gzip. header adds optional gzip header fields.
+*/
+static std::vector<uint8_t> Compress(const std::vector<uint8_t>& data, int windowBits, gz_header* header = nullptr) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY);
+  if (header != nullptr) {
+    deflateSetHeader(&stream, header);
+  }
+  std::vector<uint8_t> compressed(deflateBound(&stream, data.size()) + 64);
+  stream.next_in = (Bytef*) data.data();
+  stream.avail_in = data.size();
+  stream.next_out = compressed.data();
+  stream.avail_out = compressed.size();
+  deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return compressed;
+}
+
+/*
+* Decodes body into buffer in two writes, split at the given offset. Returns whether the decoder finished successfully.
+*/
+static bool DecodeSplit(ContentEncoding encoding, const std::vector<uint8_t>& body, size_t split, char* buffer) {
+  PayloadDecoder decoder(buffer, RESPONSE_BUFFER_SIZE);
+  if (!decoder.begin(encoding, body.size())) {
+    return false;
+  }
+  decoder.write(body.data(), split);
+  decoder.write(body.data() + split, body.size() - split);
+  return decoder.finish();
+}
+
+/*
+* Decodes body split at every byte offset, checking the payload comes out whole each time.
+*/
+static void CheckEverySplit(ContentEncoding encoding, const std::vector<uint8_t>& body) {
+  char buffer[RESPONSE_BUFFER_SIZE];
+  char message[64];
+  for (size_t split = 0; split <= body.size(); split++) {
+    snprintf(message, sizeof(message), "split at %u of %u", (unsigned int) split, (unsigned int) body.size());
+    memset(buffer, 0x55, sizeof(buffer));
+    TEST_ASSERT_TRUE_MESSAGE(DecodeSplit(encoding, body, split, buffer), message);
+    TEST_ASSERT_EQUAL_MESSAGE(payload.size(), strlen(buffer), message);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(payload.data(), buffer, payload.size(), message);
+  }
+
+  PayloadDecoder decoder(buffer, sizeof(buffer));                           // And a byte at a time.
+  decoder.begin(encoding, body.size());
+  for (size_t i = 0; i < body.size(); i++) {
+    TEST_ASSERT_EQUAL(1, decoder.write(body[i]));
+  }
+  TEST_ASSERT_TRUE(decoder.finish());
+  TEST_ASSERT_EQUAL_MEMORY(payload.data(), buffer, payload.size());
+}
+
+// Collects what a streaming decoder passes on.
+class CollectingSink : public Print {
+  public:
+    size_t write(uint8_t data) override { received.push_back(data); return 1; }
+    size_t write(const uint8_t* data, size_t size) override { received.insert(received.end(), data, data + size); return size; }
+    using Print::write;
+
+    std::vector<uint8_t> received;
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_identity_split_at_every_offset() {
+  CheckEverySplit(EncodingIdentity, payload);
+}
+
+void test_gzip_split_at_every_offset() {
+  CheckEverySplit(EncodingGzip, Compress(payload, 31));
+}
+
+void test_gzip_optional_header_fields_split_at_every_offset() {
+  static uint8_t extra[] = { 'T', '9', 4, 0, 1, 2, 3, 4 };
+  gz_header header;
+  memset(&header, 0, sizeof(header));
+  header.extra = extra;
+  header.extra_len = sizeof(extra);
+  header.name = (Bytef*) "payload.txt";
+  header.comment = (Bytef*) "counter values";
+  header.hcrc = 1;
+  CheckEverySplit(EncodingGzip, Compress(payload, 31, &header));
+}
+
+void test_zlib_split_at_every_offset() {
+  CheckEverySplit(EncodingDeflate, Compress(payload, 15));
+}
+
+void test_raw_deflate_split_at_every_offset() {
+  CheckEverySplit(EncodingDeflate, Compress(payload, -15));
+}
+
+/*
+* Streams a body several times the window through it, split throughout, for each encoding.
+*/
+void test_streamed_body_split_throughout() {
+  static uint8_t window[TINFL_LZ_DICT_SIZE];
+  const int windowBits[] = { 31, 15, -15 };
+  const ContentEncoding encodings[] = { EncodingGzip, EncodingDeflate, EncodingDeflate };
+
+  for (int e = 0; e < 3; e++) {
+    std::vector<uint8_t> body = Compress(image, windowBits[e]);
+    for (size_t split = 0; split <= body.size(); split += split < 64 ? 1 : 257) {
+      CollectingSink sink;
+      PayloadDecoder decoder(window, sizeof(window), &sink);
+      TEST_ASSERT_TRUE(decoder.begin(encodings[e], body.size()));
+      TEST_ASSERT_EQUAL(split, decoder.write(body.data(), split));
+      TEST_ASSERT_EQUAL(body.size() - split, decoder.write(body.data() + split, body.size() - split));
+      TEST_ASSERT_TRUE(decoder.finish());
+      TEST_ASSERT_EQUAL(image.size(), sink.received.size());
+      TEST_ASSERT_TRUE(sink.received == image);
+    }
+  }
+}
+
+/*
+* A first block of reserved type 3 must fail, both as raw deflate and behind a valid zlib header.
+*/
+void test_corrupt_first_block_fails() {
+  const std::vector<uint8_t> bodies[] = { { 0x07, 0x00, 0x00, 0x00 }, { 0x78, 0x9C, 0x07, 0x00, 0x00 }, { 0x07, 0x00 } };
+  char buffer[RESPONSE_BUFFER_SIZE];
+  for (const std::vector<uint8_t>& body : bodies) {
+    for (size_t split = 0; split <= body.size(); split++) {
+      TEST_ASSERT_FALSE(DecodeSplit(EncodingDeflate, body, split, buffer));
+    }
+  }
+}
+
+void test_truncated_identity_body_fails() {
+  char buffer[RESPONSE_BUFFER_SIZE];
+  PayloadDecoder decoder(buffer, sizeof(buffer));
+  decoder.begin(EncodingIdentity, payload.size());
+  decoder.write(payload.data(), payload.size() - 1);
+  TEST_ASSERT_FALSE(decoder.finish());
+
+  PayloadDecoder unknownLength(buffer, sizeof(buffer));                     // Without a Content-Length, whatever arrived is the body.
+  unknownLength.begin(EncodingIdentity);
+  unknownLength.write(payload.data(), payload.size() - 1);
+  TEST_ASSERT_TRUE(unknownLength.finish());
+}
+
+void test_truncated_compressed_body_fails() {
+  char buffer[RESPONSE_BUFFER_SIZE];
+  std::vector<uint8_t> gzip = Compress(payload, 31);
+  for (size_t length = 0; length < gzip.size(); length++) {
+    PayloadDecoder decoder(buffer, sizeof(buffer));
+    decoder.begin(EncodingGzip);
+    decoder.write(gzip.data(), length);
+    TEST_ASSERT_FALSE(decoder.finish());
+  }
+}
+
+void test_oversized_body_overflows() {
+  char buffer[RESPONSE_BUFFER_SIZE];
+  std::vector<uint8_t> large(image.begin(), image.begin() + RESPONSE_BUFFER_SIZE * 2);
+  std::vector<uint8_t> body = Compress(large, 31);
+  PayloadDecoder decoder(buffer, sizeof(buffer));
+  decoder.begin(EncodingGzip, body.size());
+  TEST_ASSERT_TRUE(decoder.write(body.data(), body.size()) < body.size());
+  TEST_ASSERT_TRUE(decoder.overflowed());
+  TEST_ASSERT_FALSE(decoder.finish());
+}
+
+int main(int argc, char** argv) {
+  const char* text = "1045|*23871|998|1045|17|23871|5|404|1045|998|23871|120|120|120|";
+  while (payload.size() + strlen(text) < 320) {
+    payload.insert(payload.end(), text, text + strlen(text));
+  }
+  uint32_t seed = 93;                                                       // Partly random so deflate has work to do, partly repeated so it has references to make.
+  while (image.size() < TINFL_LZ_DICT_SIZE * 3) {
+    seed = seed * 1103515245 + 12345;
+    if (seed % 4 == 0 && image.size() > 1024) {
+      size_t start = image.size() - 1024 + (seed >> 8) % 512;
+      image.insert(image.end(), image.begin() + start, image.begin() + start + 200);
+    }
+    else {
+      image.push_back('0' + (seed >> 16) % 10);
+    }
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_identity_split_at_every_offset);
+  RUN_TEST(test_gzip_split_at_every_offset);
+  RUN_TEST(test_gzip_optional_header_fields_split_at_every_offset);
+  RUN_TEST(test_zlib_split_at_every_offset);
+  RUN_TEST(test_raw_deflate_split_at_every_offset);
+  RUN_TEST(test_streamed_body_split_throughout);
+  RUN_TEST(test_corrupt_first_block_fails);
+  RUN_TEST(test_truncated_identity_body_fails);
+  RUN_TEST(test_truncated_compressed_body_fails);
+  RUN_TEST(test_oversized_body_overflows);
+  return UNITY_END();
+}
\ No newline at end of file
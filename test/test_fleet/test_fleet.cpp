@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <WiFiUdp.h>
+#include <string>
+#include <vector>
+
+#include "globals_t93.h"
+
+#undef FLEET_MODE
+#define FLEET_MODE true                             // Off in the default configuration, this build of fleet_t93 is the fleet's.
+
+#include "../../src/fleet_t93.cpp"
+
+// fleet_t93 is built with the rest of the firmware faked below, and talks to a peer played by this test over loopback multicast.
+// The peer's packets are built and signed with fleet_t93's own functions.
+
+static const uint8_t peerMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };   // Lower than the shim's own MAC, so the peer is the poller.
+static WiFiUDP peerSocket;
+static std::vector<std::string> storedValues;       // What fleet_t93 has stored through StoreFetchedValue(), in order.
+static int slotCount = 0;
+
+bool IsWiFiConnected() { return true; }
+void DrawPollIndicator(bool) {}
+int GetSlotCount() { return slotCount; }
+bool SetSlotCount(int count) { slotCount = count; return true; }
+const char* GetSlotValue(int) { return "0"; }
+bool IsValueStale(int) { return false; }
+void MarkValueFetchFailed(int) {}
+void StoreFetchedValue(int, const char* value) { storedValues.push_back(value); }
+
+/*
+* Builds and signs a packet from the test's peer, as SendFleetPacket() would. values is pipe delimited, for a FleetValues packet.
+*/
+static std::vector<uint8_t> BuildPeerPacket(FleetPacketType type, uint32_t nonce, uint32_t sequence, const char* values = "") {
+  std::vector<uint8_t> packet(FLEET_PACKET_SIZE);
+  memcpy(packet.data(), FLEET_MAGIC, 4);
+  packet[4] = type;
+  memcpy(packet.data() + 5, peerMac, sizeof(peerMac));
+  PutFleetUint32(packet.data() + 11, nonce);
+  PutFleetUint32(packet.data() + 15, sequence);
+  int length = FLEET_HEADER_LENGTH;
+
+  if (type == FleetValues) {
+    int countAt = length++;
+    packet[countAt] = 0;
+    for (const char* value = values; *value != '\0'; ) {
+      int valueLength = strcspn(value, "|");
+      packet[length++] = 0;
+      packet[length++] = valueLength;
+      memcpy(packet.data() + length, value, valueLength);
+      length += valueLength;
+      packet[countAt]++;
+      value += valueLength + (value[valueLength] == '|' ? 1 : 0);
+    }
+  }
+
+  SignFleetPacket(packet.data(), length, packet.data() + length);
+  packet.resize(length + FLEET_TAG_LENGTH);
+  return packet;
+}
+
+static void SendPeerPacket(const std::vector<uint8_t>& packet) {
+  peerSocket.beginPacket(IPAddress(FLEET_GROUP), FLEET_PORT);
+  peerSocket.write(packet.data(), packet.size());
+  TEST_ASSERT_TRUE(peerSocket.endPacket());
+}
+
+/*
+* Sends the packet and lets fleet_t93 process it. Returns the values it stored as a result, pipe delimited.
+*/
+static std::string Deliver(const std::vector<uint8_t>& packet) {
+  storedValues.clear();
+  SendPeerPacket(packet);
+  delay(20);                                                                // Loopback delivery is immediate, this is just margin.
+  ProcessFleet();
+
+  std::string stored;
+  for (const std::string& value : storedValues) {
+    stored += (stored.empty() ? "" : "|") + value;
+  }
+  return stored;
+}
+
+/*
+* Waits for a packet sent by fleet_t93 (rather than the test's peer) and returns it, or an empty packet if none arrives.
+*/
+static std::vector<uint8_t> ReceiveCounterPacket() {
+  uint8_t packet[NATIVE_UDP_SIZE];
+  for (int attempt = 0; attempt < 50; attempt++) {
+    int size = peerSocket.parsePacket();
+    if (size > 0) {
+      peerSocket.read(packet, size);
+      if (memcmp(packet + 5, peerMac, sizeof(peerMac)) != 0) {
+        return std::vector<uint8_t>(packet, packet + size);
+      }
+      continue;
+    }
+    delay(10);
+  }
+  return std::vector<uint8_t>();
+}
+
+static uint32_t peerNonce = 0x93939393;
+static uint32_t peerSequence = 0;
+
+void setUp() {
+  storedValues.clear();
+}
+
+void tearDown() {}
+
+void test_counter_joins_and_sends_signed_heartbeat() {
+  TEST_ASSERT_TRUE(peerSocket.beginMulticast(IPAddress(FLEET_GROUP), FLEET_PORT));
+  InitializeFleet();
+  ProcessFleet();                                                           // Joining announces the counter straight away.
+
+  std::vector<uint8_t> heartbeat = ReceiveCounterPacket();
+  TEST_ASSERT_EQUAL(FLEET_HEADER_LENGTH + FLEET_TAG_LENGTH, heartbeat.size());
+  TEST_ASSERT_EQUAL_MEMORY(FLEET_MAGIC, heartbeat.data(), 4);
+  TEST_ASSERT_EQUAL(FleetHeartbeat, heartbeat[4]);
+  uint8_t tag[FLEET_TAG_LENGTH];
+  SignFleetPacket(heartbeat.data(), FLEET_HEADER_LENGTH, tag);
+  TEST_ASSERT_EQUAL_MEMORY(tag, heartbeat.data() + FLEET_HEADER_LENGTH, FLEET_TAG_LENGTH);
+}
+
+void test_values_from_poller_are_applied() {
+  Deliver(BuildPeerPacket(FleetHeartbeat, peerNonce, ++peerSequence));
+  TEST_ASSERT_FALSE(IsFleetPoller());
+  TEST_ASSERT_EQUAL_STRING("123|45", Deliver(BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "123|45")).c_str());
+  TEST_ASSERT_TRUE(HasRecentFleetValues());
+  TEST_ASSERT_EQUAL(2, slotCount);
+}
+
+void test_bad_tag_is_rejected() {
+  std::vector<uint8_t> packet = BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "666");
+  packet[FLEET_HEADER_LENGTH + 3] = '7';                                    // Altered after signing.
+  TEST_ASSERT_EQUAL_STRING("", Deliver(packet).c_str());
+}
+
+void test_replayed_packet_is_rejected() {
+  std::vector<uint8_t> packet = BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "200");
+  TEST_ASSERT_EQUAL_STRING("200", Deliver(packet).c_str());
+  TEST_ASSERT_EQUAL_STRING("", Deliver(packet).c_str());
+  TEST_ASSERT_EQUAL_STRING("", Deliver(BuildPeerPacket(FleetValues, peerNonce, peerSequence - 1, "199")).c_str());
+}
+
+/*
+* Once the poller's lease lapses the counter takes over, but the lapsed peer's old packets are still replays.
+*/
+void test_replay_after_lease_expiry_is_rejected() {
+  std::vector<uint8_t> packet = BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "300");
+  TEST_ASSERT_EQUAL_STRING("300", Deliver(packet).c_str());
+
+  AdvanceMillis(FLEET_LEASE_MS + 1);
+  ProcessFleet();
+  TEST_ASSERT_TRUE(IsFleetPoller());                                        // Failover.
+  while (ReceiveCounterPacket().size() > 0) {}                              // Drain the counter's heartbeats.
+
+  Deliver(packet);
+  TEST_ASSERT_TRUE(IsFleetPoller());                                        // The replay didn't renew the lapsed lease either.
+}
+
+void test_replay_after_recovery_is_rejected() {
+  std::vector<uint8_t> packet = BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "400");
+  TEST_ASSERT_EQUAL_STRING("400", Deliver(packet).c_str());
+
+  InitializeFleet();                                                        // As PerformRecovery(RecoveryPoller) does.
+  TEST_ASSERT_EQUAL_STRING("", Deliver(packet).c_str());
+  TEST_ASSERT_EQUAL_STRING("401", Deliver(BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "401")).c_str());
+}
+
+/*
+* A restarted peer starts its sequence over under a new nonce. Packets from before it restarted are replays from then on.
+*/
+void test_restarted_peer_is_accepted_and_its_previous_boot_rejected() {
+  std::vector<uint8_t> previousBoot = BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "500");
+  TEST_ASSERT_EQUAL_STRING("500", Deliver(previousBoot).c_str());
+
+  peerNonce++;
+  peerSequence = 0;
+  TEST_ASSERT_EQUAL_STRING("1", Deliver(BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "1")).c_str());
+  TEST_ASSERT_EQUAL_STRING("", Deliver(previousBoot).c_str());
+  TEST_ASSERT_EQUAL_STRING("", Deliver(BuildPeerPacket(FleetValues, peerNonce - 1, 9999, "501")).c_str());
+  TEST_ASSERT_EQUAL_STRING("2", Deliver(BuildPeerPacket(FleetValues, peerNonce, ++peerSequence, "2")).c_str());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counter_joins_and_sends_signed_heartbeat);
+  RUN_TEST(test_values_from_poller_are_applied);
+  RUN_TEST(test_bad_tag_is_rejected);
+  RUN_TEST(test_replayed_packet_is_rejected);
+  RUN_TEST(test_replay_after_lease_expiry_is_rejected);
+  RUN_TEST(test_replay_after_recovery_is_rejected);
+  RUN_TEST(test_restarted_peer_is_accepted_and_its_previous_boot_rejected);
+  return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <unity.h>
+
+#include "globals_t93.h"
+#include "history_t93.h"
+
+// Sample times come from millis(), which the tests move forward with AdvanceMillis() rather than waiting.
+
+static void Record(unsigned long secondsLater, const char* value) {
+  AdvanceMillis(secondsLater * 1000UL);
+  TEST_ASSERT_TRUE(RecordHistorySample(0, value));
+}
+
+void setUp() {
+  ClearHistory(0);
+}
+
+void tearDown() {}
+
+static void CheckParsed(const char* text, int32_t expected) {
+  int32_t value = 0;
+  TEST_ASSERT_TRUE_MESSAGE(ParseHistoryValue(text, &value), text);
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected, value, text);
+}
+
+static void CheckRejected(const char* text) {
+  int32_t value = 93;
+  TEST_ASSERT_FALSE_MESSAGE(ParseHistoryValue(text, &value), text);
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(93, value, text);                        // Left as it was.
+}
+
+void test_parse_plain_and_signed_values() {
+  CheckParsed("0", 0);
+  CheckParsed("1045", 1045);
+  CheckParsed("  1045", 1045);
+  CheckParsed("+17", 17);
+  CheckParsed("-404", -404);
+  CheckParsed("12.75", 12);                                                 // Fractions and suffixes are ignored.
+  CheckParsed("23871 views", 23871);
+  CheckParsed("5k", 5);
+}
+
+void test_parse_thousands_separators() {
+  CheckParsed("1,234,567", 1234567);
+  CheckParsed("-12 345", -12345);
+  CheckParsed("1_000_000", 1000000);
+  CheckParsed("1,234.5", 1234);
+  CheckRejected(",123");                                                    // Separators only count once a digit has been seen.
+  CheckRejected(" ,123");
+}
+
+void test_parse_rejects_non_numbers() {
+  CheckRejected("");
+  CheckRejected("-");
+  CheckRejected("+");
+  CheckRejected("abc");
+  CheckRejected("--1");
+  CheckRejected("n/a 12");
+}
+
+void test_parse_limits() {
+  CheckParsed("2147483647", INT32_MAX);
+  CheckParsed("2,147,483,647", INT32_MAX);
+  CheckParsed("-2147483648", INT32_MIN);
+  CheckRejected("2147483648");
+  CheckRejected("-2147483649");
+  CheckRejected("99999999999999999999999");                                 // Would overflow 64 bits too if not stopped early.
+  CheckRejected("-99 999 999 999 999 999 999");
+}
+
+/*
+* Values fetched more often than HISTORY_SAMPLE_SECONDS replace the newest sample until it is that far from the one before.
+*/
+void test_samples_closer_than_spacing_replace_newest() {
+  Record(0, "100");
+  uint32_t start = GetHistorySample(0, 0).time;
+  TEST_ASSERT_EQUAL(1, GetHistoryCount(0));
+
+  Record(10, "110");                                                        // A second sample is always kept, to have a rate from.
+  TEST_ASSERT_EQUAL(2, GetHistoryCount(0));
+
+  Record(10, "120");
+  TEST_ASSERT_EQUAL(2, GetHistoryCount(0));
+  TEST_ASSERT_EQUAL_INT32(120, GetHistorySample(0, 1).value);
+  TEST_ASSERT_EQUAL_INT32(20, GetHistoryDelta(0));
+
+  Record(HISTORY_SAMPLE_SECONDS - 10, "170");                               // The newest was still under the spacing from the first when this arrived.
+  TEST_ASSERT_EQUAL(2, GetHistoryCount(0));
+  TEST_ASSERT_EQUAL_UINT32(start + (HISTORY_SAMPLE_SECONDS + 10) * 1000UL, GetHistorySample(0, 1).time);
+
+  Record(10, "180");                                                        // The newest is now far enough along to keep.
+  TEST_ASSERT_EQUAL(3, GetHistoryCount(0));
+  TEST_ASSERT_EQUAL_INT32(100, GetHistorySample(0, 0).value);
+  TEST_ASSERT_EQUAL_INT32(170, GetHistorySample(0, 1).value);
+  TEST_ASSERT_EQUAL_INT32(180, GetHistorySample(0, 2).value);
+  TEST_ASSERT_EQUAL_INT32(10, GetHistoryDelta(0));
+
+  int64_t rate;                                                             // 80 across the ring's span.
+  TEST_ASSERT_TRUE(GetHistoryRate(0, &rate));
+  TEST_ASSERT_EQUAL_INT64(80LL * HISTORY_RATE_SCALE * 3600000LL / ((HISTORY_SAMPLE_SECONDS + 20) * 1000LL), rate);
+}
+
+void test_non_numeric_value_leaves_history_unchanged() {
+  Record(0, "5");
+  Record(HISTORY_SAMPLE_SECONDS, "6");
+  AdvanceMillis(HISTORY_SAMPLE_SECONDS * 1000UL);
+  TEST_ASSERT_FALSE(RecordHistorySample(0, "Error"));
+  TEST_ASSERT_EQUAL(2, GetHistoryCount(0));
+  TEST_ASSERT_EQUAL_INT32(6, GetHistorySample(0, 1).value);
+  TEST_ASSERT_EQUAL_INT32(1, GetHistoryDelta(0));
+}
+
+/*
+* Once the ring is full the oldest sample is overwritten, and the rate is measured across what is held.
+*/
+void test_full_ring_keeps_newest_samples_spaced() {
+  for (int i = 0; i < HISTORY_SAMPLES * 2; i++) {
+    char value[12];
+    snprintf(value, sizeof(value), "%d", i * 10);
+    Record(i == 0 ? 0 : HISTORY_SAMPLE_SECONDS, value);
+  }
+
+  TEST_ASSERT_EQUAL(HISTORY_SAMPLES, GetHistoryCount(0));
+  for (int i = 0; i < HISTORY_SAMPLES; i++) {
+    TEST_ASSERT_EQUAL_INT32((HISTORY_SAMPLES + i) * 10, GetHistorySample(0, i).value);
+  }
+  for (int i = 1; i < HISTORY_SAMPLES; i++) {
+    TEST_ASSERT_EQUAL_UINT32(HISTORY_SAMPLE_SECONDS * 1000UL, GetHistorySample(0, i).time - GetHistorySample(0, i - 1).time);
+  }
+
+  char trend[12];                                                           // 10 per HISTORY_SAMPLE_SECONDS.
+  TEST_ASSERT_TRUE(FormatHistoryTrend(0, trend, sizeof(trend)));
+  TEST_ASSERT_EQUAL_STRING("+600/h", trend);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_plain_and_signed_values);
+  RUN_TEST(test_parse_thousands_separators);
+  RUN_TEST(test_parse_rejects_non_numbers);
+  RUN_TEST(test_parse_limits);
+  RUN_TEST(test_samples_closer_than_spacing_replace_newest);
+  RUN_TEST(test_non_numeric_value_leaves_history_unchanged);
+  RUN_TEST(test_full_ring_keeps_newest_samples_spaced);
+  return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include <unity.h>
+#include <zlib.h>
+#include <Update.h>
+#include <vector>
+
+#include "globals_t93.h"
+#include "enums_t93.h"
+#include "decode_t93.h"
+#include "image_t93.h"
+
+// Firmware images are compressed here with the host's zlib and streamed through PayloadDecoder into FirmwareWriter, as
+// CheckForFirmwareUpdate() does, with Update flashing into memory (see test/shims/Update.h).
+
+#define TCP_SEGMENT           1460  // How much of the body writeToStream() typically passes on at a time.
+
+static std::vector<uint8_t> image;                  // Stands in for a firmware image, several times the inflate window.
+static uint8_t imageHash[32];
+static uint8_t window[TINFL_LZ_DICT_SIZE];
+
+static std::vector<uint8_t> Compress(const std::vector<uint8_t>& data, int windowBits) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY);
+  std::vector<uint8_t> compressed(deflateBound(&stream, data.size()) + 64);
+  stream.next_in = (Bytef*) data.data();
+  stream.avail_in = data.size();
+  stream.next_out = compressed.data();
+  stream.avail_out = compressed.size();
+  deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return compressed;
+}
+
+/*
+* Downloads body as CheckForFirmwareUpdate() would, sending the given length of it a segment at a time with its full size
+* as the Content-Length. Returns whether the image was accepted as matching expectedHash.
+*/
+static bool Download(ContentEncoding encoding, const std::vector<uint8_t>& body, size_t length, const uint8_t* expectedHash, size_t updateSize = UPDATE_SIZE_UNKNOWN) {
+  TEST_ASSERT_TRUE(Update.begin(updateSize));
+  FirmwareWriter writer;
+  PayloadDecoder decoder(window, sizeof(window), &writer);
+  TEST_ASSERT_TRUE(decoder.begin(encoding, body.size()));
+  for (size_t sent = 0; sent < length; sent += TCP_SEGMENT) {
+    size_t segment = min((size_t) TCP_SEGMENT, length - sent);
+    if (decoder.write(body.data() + sent, segment) < segment) {
+      break;                                                                // writeToStream() gives up on a short write.
+    }
+  }
+
+  bool accepted = FinishFirmwareImage(decoder, writer, expectedHash);
+  TEST_ASSERT_EQUAL(Update.written.size(), writer.length());
+  return accepted;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/*
+* The SHA-256 of "abc", from FIPS 180-2, as a hash and as the ETag sent in If-None-Match.
+*/
+void test_hash_and_tag_of_known_image() {
+  Update.begin();
+  FirmwareWriter writer;
+  writer.write((const uint8_t*) "ab", 2);
+  writer.write('c');
+  uint8_t hash[32];
+  writer.digest(hash);
+
+  char text[65];
+  char tag[67];
+  FormatImageHash(hash, text);
+  FormatImageTag(hash, tag);
+  TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", text);
+  TEST_ASSERT_EQUAL_STRING("\"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad\"", tag);
+  TEST_ASSERT_EQUAL(3, writer.length());
+  TEST_ASSERT_EQUAL_MEMORY("abc", Update.written.data(), 3);
+}
+
+void test_parse_image_hash() {
+  uint8_t hash[32];
+  char text[65];
+  TEST_ASSERT_TRUE(ParseImageHash("BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD", hash));
+  FormatImageHash(hash, text);
+  TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", text);
+
+  TEST_ASSERT_FALSE(ParseImageHash("", hash));
+  TEST_ASSERT_FALSE(ParseImageHash("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015a", hash));     // 63 characters.
+  TEST_ASSERT_FALSE(ParseImageHash("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015add", hash));   // 65.
+  TEST_ASSERT_FALSE(ParseImageHash("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ag", hash));
+  TEST_ASSERT_FALSE(ParseImageHash(" a7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hash));
+  TEST_ASSERT_FALSE(ParseImageHash("+a7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hash));
+}
+
+void test_compressed_image_is_flashed_and_matches() {
+  const int windowBits[] = { 31, 15, -15 };
+  const ContentEncoding encodings[] = { EncodingGzip, EncodingDeflate, EncodingDeflate };
+  for (int e = 0; e < 3; e++) {
+    std::vector<uint8_t> body = Compress(image, windowBits[e]);
+    TEST_ASSERT_TRUE(Download(encodings[e], body, body.size(), imageHash));
+    TEST_ASSERT_TRUE(Update.written == image);
+    TEST_ASSERT_TRUE(Update.end(true));
+  }
+  TEST_ASSERT_TRUE(Download(EncodingIdentity, image, image.size(), imageHash));
+}
+
+void test_hash_mismatch_is_rejected() {
+  uint8_t otherHash[32];
+  memcpy(otherHash, imageHash, sizeof(otherHash));
+  otherHash[31] ^= 1;
+  std::vector<uint8_t> body = Compress(image, 31);
+  TEST_ASSERT_FALSE(Download(EncodingGzip, body, body.size(), otherHash));
+  TEST_ASSERT_TRUE(Update.written == image);                                // Flashed, but never booted.
+}
+
+/*
+* A connection dropped part way, at the end of a segment or not, leaves an image that must not be booted.
+*/
+void test_truncated_image_is_rejected() {
+  std::vector<uint8_t> body = Compress(image, 31);
+  const size_t lengths[] = { 0, 10, TCP_SEGMENT, body.size() / 2, body.size() - 8, body.size() - 1 };
+  for (size_t length : lengths) {
+    TEST_ASSERT_FALSE(Download(EncodingGzip, body, length, imageHash));
+  }
+  TEST_ASSERT_FALSE(Download(EncodingIdentity, image, image.size() - 1, imageHash));
+}
+
+void test_image_larger_than_partition_is_rejected() {
+  std::vector<uint8_t> body = Compress(image, 31);
+  TEST_ASSERT_FALSE(Download(EncodingGzip, body, body.size(), imageHash, image.size() / 2));
+  TEST_ASSERT_EQUAL(image.size() / 2, Update.written.size());
+  TEST_ASSERT_TRUE(Update.hasError());
+}
+
+int main(int argc, char** argv) {
+  uint32_t seed = 93;                                                       // Partly random so deflate has work to do, partly repeated so it has references to make.
+  while (image.size() < TINFL_LZ_DICT_SIZE * 6) {
+    seed = seed * 1103515245 + 12345;
+    if (seed % 4 == 0 && image.size() > 20000) {
+      size_t start = image.size() - 20000 + (seed >> 8) % 10000;           // References across much of the window.
+      image.insert(image.end(), image.begin() + start, image.begin() + start + 300);
+    }
+    else {
+      image.push_back(seed >> 16);
+    }
+  }
+  mbedtls_sha256_ret(image.data(), image.size(), imageHash, 0);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_hash_and_tag_of_known_image);
+  RUN_TEST(test_parse_image_hash);
+  RUN_TEST(test_compressed_image_is_flashed_and_matches);
+  RUN_TEST(test_hash_mismatch_is_rejected);
+  RUN_TEST(test_truncated_image_is_rejected);
+  RUN_TEST(test_image_larger_than_partition_is_rejected);
+  return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <unity.h>
+
+#include "globals_t93.h"
+#include "payload_t93.h"
+
+// Runs payloads through validation as ProcessAPIPolling() does, including those the mock API serves when asked for a malformed
+// response: an empty body, only delimiters, binary garbage and an HTML error page served as a 200.
+
+static char buffer[RESPONSE_BUFFER_SIZE];
+
+void setUp() {}
+
+void tearDown() {}
+
+/*
+* Copies the given bytes into the response buffer and terminates them, as the HTTP client would.
+*/
+static void LoadBuffer(const char* payload, int length) {
+  memcpy(buffer, payload, length);
+  buffer[length] = '\0';
+}
+
+static bool Validate(const char* payload) {
+  LoadBuffer(payload, strlen(payload));
+  return ValidatePayloadFormat(buffer);
+}
+
+void test_values_accepted() {
+  TEST_ASSERT_TRUE(Validate("1234"));
+  TEST_ASSERT_TRUE(Validate("1234|5678|90"));
+  TEST_ASSERT_TRUE(Validate("12,345|-6.78|Closed for maintenance"));
+  TEST_ASSERT_TRUE(Validate("|1234|"));
+}
+
+/*
+* The asterisk the API adds for another project is removed before validation, and the values either side are kept.
+*/
+void test_asterisk_removed_before_validation() {
+  LoadBuffer("12*34|5678", 10);
+  RemoveAsteriskNotation(buffer);
+  TEST_ASSERT_EQUAL_STRING("1234|5678", buffer);
+  TEST_ASSERT_TRUE(ValidatePayloadFormat(buffer));
+}
+
+void test_empty_payload_rejected() {
+  TEST_ASSERT_FALSE(Validate(""));
+}
+
+void test_delimiters_only_rejected() {
+  TEST_ASSERT_FALSE(Validate("|||"));
+  TEST_ASSERT_FALSE(Validate("|"));
+}
+
+/*
+* 64 random bytes, as the mock serves, over several seeds. Zero bytes are skipped, as the buffer would otherwise end before the garbage does.
+*/
+void test_binary_garbage_rejected() {
+  for (uint32_t seed = 1; seed <= 50; seed++) {
+    char payload[64];
+    uint32_t state = seed;
+    for (int i = 0; i < LEN(payload); i++) {
+      do {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+      } while ((state & 0xff) == 0);
+      payload[i] = state & 0xff;
+    }
+    LoadBuffer(payload, LEN(payload));
+    TEST_ASSERT_FALSE_MESSAGE(ValidatePayloadFormat(buffer), "Garbage payload accepted");
+  }
+}
+
+void test_html_error_page_rejected() {
+  TEST_ASSERT_FALSE(Validate("<html><body>502 Bad Gateway</body></html>"));
+  TEST_ASSERT_FALSE(Validate("1234|5678\n"));
+  TEST_ASSERT_FALSE(Validate("1234\t5678"));
+}
+
+/*
+* A buffer filled to the end without a terminator is rejected rather than read past.
+*/
+void test_unterminated_payload_rejected() {
+  memset(buffer, '1', sizeof(buffer));
+  TEST_ASSERT_FALSE(ValidatePayloadFormat(buffer));
+}
+
+/*
+* The first count is taken as it is. A different count is rejected until VALUE_COUNT_POLLS payloads in a row have had it,
+* and one that changes back before then leaves the count as it was.
+*/
+void test_value_count_changes_once_repeated() {
+  TEST_ASSERT_EQUAL(2, VALUE_COUNT_POLLS);
+  TEST_ASSERT_TRUE(AcceptPayloadValueCount(3));
+  TEST_ASSERT_TRUE(AcceptPayloadValueCount(3));
+  TEST_ASSERT_FALSE(AcceptPayloadValueCount(1));
+  TEST_ASSERT_TRUE(AcceptPayloadValueCount(3));
+  TEST_ASSERT_FALSE(AcceptPayloadValueCount(1));
+  TEST_ASSERT_FALSE(AcceptPayloadValueCount(5));
+  TEST_ASSERT_TRUE(AcceptPayloadValueCount(5));
+  TEST_ASSERT_FALSE(AcceptPayloadValueCount(3));
+  TEST_ASSERT_TRUE(AcceptPayloadValueCount(3));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_values_accepted);
+  RUN_TEST(test_asterisk_removed_before_validation);
+  RUN_TEST(test_empty_payload_rejected);
+  RUN_TEST(test_delimiters_only_rejected);
+  RUN_TEST(test_binary_garbage_rejected);
+  RUN_TEST(test_html_error_page_rejected);
+  RUN_TEST(test_unterminated_payload_rejected);
+  RUN_TEST(test_value_count_changes_once_repeated);
+  return UNITY_END();
+}
\ No newline at end of file
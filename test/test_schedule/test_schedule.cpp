@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <WiFi.h>
+#include <math.h>
+
+#include "globals_t93.h"
+#include "schedule_t93.h"
+
+// Works out when a fleet of counters powered up together would poll, with the firmware's own HashMacAddress() and GetSlotDelay(),
+// to check polls are spread evenly across POLL_INTERVAL_SECONDS. Polling every interval from boot (lockstep) is the comparison.
+
+#define FLEET_SIZE            200
+#define BOOT_SPREAD_MS        2000  // Power returns for all at once, boot times differ slightly.
+#define FLEET_EPOCH_MS        1700000000000ULL
+#define BIN_MS                1000
+
+static const uint64_t interval = POLL_INTERVAL_SECONDS * 1000ULL;
+static uint32_t seed;
+
+static uint32_t NextRandom() {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+static void NextMac(uint8_t* mac, int device, bool randomMacs) {
+  static const uint8_t base[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, 0x00 };   // Consecutive from here, as a batch of boards has.
+  uint64_t address = 0;
+  for (int i = 0; i < 6; i++) {
+    address = (address << 8) | (randomMacs ? NextRandom() & 0xFF : base[i]);
+  }
+  address += randomMacs ? 0 : device;
+  for (int i = 5; i >= 0; i--, address >>= 8) {
+    mac[i] = address & 0xFF;
+  }
+}
+
+/*
+* Returns the most first polls that land in any BIN_MS of the interval, and writes the mean to mean.
+*/
+static int PeakPollsPerBin(int devices, bool randomMacs, bool lockstep, double* mean) {
+  static int bins[(POLL_INTERVAL_SECONDS * 1000 + BIN_MS - 1) / BIN_MS];
+  memset(bins, 0, sizeof(bins));
+  seed = 93;
+  for (int device = 0; device < devices; device++) {
+    uint8_t mac[6];
+    NextMac(mac, device, randomMacs);
+    uint64_t now = FLEET_EPOCH_MS + NextRandom() % BOOT_SPREAD_MS;
+    uint64_t poll = lockstep ? now : now + GetSlotDelay(now, 0, HashMacAddress(mac) % interval);
+    bins[(poll % interval) / BIN_MS]++;
+  }
+
+  int peak = 0;
+  for (int count : bins) {
+    peak = max(peak, count);
+  }
+  *mean = (double) devices / LEN(bins);
+  return peak;
+}
+
+/*
+* A uniform spread puts a Poisson-like count in each bin. Generous headroom over the mean is allowed before calling it uneven.
+*/
+static void CheckEvenSpread(int devices, bool randomMacs) {
+  double mean;
+  int peak = PeakPollsPerBin(devices, randomMacs, false, &mean);
+  double limit = mean + 4 * sqrt(mean) + 2;
+  char message[96];
+  snprintf(message, sizeof(message), "%d counters, %s MACs: peak %d per %d ms (mean %.1f, limit %.1f)",
+    devices, randomMacs ? "random" : "consecutive", peak, BIN_MS, mean, limit);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE_MESSAGE(peak <= limit, message);
+
+  int lockstepPeak = PeakPollsPerBin(devices, randomMacs, true, &mean);    // The check can tell an uneven fleet.
+  TEST_ASSERT_TRUE(lockstepPeak > limit);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_consecutive_macs_spread_evenly() {
+  CheckEvenSpread(FLEET_SIZE, false);
+}
+
+void test_random_macs_spread_evenly() {
+  CheckEvenSpread(FLEET_SIZE * 5, true);
+}
+
+/*
+* Follows one counter through scheduled polls and refreshes at random times, as StartPoll() and ProcessRefreshRequest() would.
+* Its scheduled polls must never come within half an interval of the poll before, refresh or not.
+*/
+void test_scheduled_polls_at_least_half_an_interval_apart() {
+  seed = 93;
+  uint32_t offset = NextRandom() % interval;
+  uint64_t now = FLEET_EPOCH_MS + GetSlotDelay(FLEET_EPOCH_MS, 0, offset);   // The first poll.
+  uint64_t last = now;
+  uint64_t nextPoll = now + GetSlotDelay(now, interval / 2, offset);
+  for (int i = 0; i < 10000; i++) {
+    uint64_t refresh = now + NextRandom() % (2 * interval);
+    bool refreshed = refresh < nextPoll && nextPoll - refresh > REFRESH_COALESCE_MS && refresh - last > REFRESH_COALESCE_MS;
+    now = refreshed ? refresh : nextPoll;
+    if (!refreshed) {
+      TEST_ASSERT_TRUE(now - last >= interval / 2);
+      TEST_ASSERT_EQUAL(offset, now % interval);
+    }
+    last = now;
+    nextPoll = now + GetSlotDelay(now, interval / 2, offset);
+  }
+}
+
+void test_slot_delay_bounds() {
+  for (uint64_t now = FLEET_EPOCH_MS; now < FLEET_EPOCH_MS + interval * 2; now += 997) {
+    for (unsigned long earliest : { 0UL, 1UL, (unsigned long) interval / 2, (unsigned long) interval }) {
+      unsigned long delay = GetSlotDelay(now, earliest, 12345);
+      TEST_ASSERT_TRUE(delay >= earliest && delay < earliest + interval);
+      TEST_ASSERT_EQUAL(12345, (now + delay) % interval);
+    }
+  }
+}
+
+/*
+* Distance between two phases in the interval, either way round.
+*/
+static uint64_t PhaseDistance(uint64_t a, uint64_t b) {
+  uint64_t difference = (a + interval - b) % interval;
+  return min(difference, interval - difference);
+}
+
+/*
+* Until the clock is set, polls keep to one offset counted from boot. After, to the offset hashed from the MAC, counted from the epoch.
+*/
+void test_firmware_schedule_moves_onto_mac_offset_once_clock_set() {
+  InitializeSchedule();
+  uint64_t bootPhase = (millis() + GetPollSlotDelay(0)) % interval;
+  for (int i = 0; i < 5; i++) {
+    AdvanceMillis(7919);
+    TEST_ASSERT_TRUE(PhaseDistance(bootPhase, (millis() + GetPollSlotDelay(0)) % interval) <= 2);
+  }
+
+  IsPollDue();                                                              // The host's clock is already set, so this syncs the schedule.
+  TEST_ASSERT_TRUE(IsTimeSynced());
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  uint64_t macPhase = HashMacAddress(mac) % interval;
+  unsigned long delay = GetPollSlotDelay(interval / 2);
+  TEST_ASSERT_TRUE(delay >= interval / 2 && delay < interval * 3 / 2);
+  TEST_ASSERT_TRUE(PhaseDistance(macPhase, (GetEpochMillis() + delay) % interval) <= 2);
+}
+
+/*
+* FNV-1a's published test vector for "foobar", which is conveniently 6 bytes, and consecutive MACs hashing far apart.
+*/
+void test_hash_mac_address() {
+  TEST_ASSERT_EQUAL_UINT32(0xBF9CF968UL, HashMacAddress((const uint8_t*) "foobar"));
+
+  uint8_t first[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01 };
+  uint8_t second[6] = { 0x24, 0x0A, 0xC4, 0x00, 0x00, 0x02 };
+  TEST_ASSERT_TRUE(PhaseDistance(HashMacAddress(first) % interval, HashMacAddress(second) % interval) > BIN_MS);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_consecutive_macs_spread_evenly);
+  RUN_TEST(test_random_macs_spread_evenly);
+  RUN_TEST(test_scheduled_polls_at_least_half_an_interval_apart);
+  RUN_TEST(test_slot_delay_bounds);
+  RUN_TEST(test_firmware_schedule_moves_onto_mac_offset_once_clock_set);
+  RUN_TEST(test_hash_mac_address);
+  return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include <unity.h>
+#include <LittleFS.h>
+
+#include "globals_t93.h"
+#include "series_t93.h"
+
+// Drives the series store with samples at chosen times over the LittleFS shim, which mounts a fresh filesystem after LittleFS.end().
+// Values rise by a random amount each sample, as SeriesNoisy in the benchmark does, so chunks fill in a few hours rather than days.
+
+#define START_TIME            1700000000
+
+static uint32_t seed;
+static uint32_t sampleTime[SERIES_MAX_SLOTS];
+static int32_t sampleValue[SERIES_MAX_SLOTS];
+static SeriesSample samples[20000];
+
+void setUp() {
+  LittleFS.end();
+  InitializeSeries();
+  seed = 93;
+  for (int i = 0; i < SERIES_MAX_SLOTS; i++) {
+    sampleTime[i] = START_TIME;
+    sampleValue[i] = 1000 * i;
+  }
+}
+
+void tearDown() {
+  LittleFS.end();
+}
+
+/*
+* Adds a sample to each of the first slots, a SERIES_SAMPLE_SECONDS on from the last.
+*/
+static void AddSamples(int slots) {
+  for (int i = 0; i < slots; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    sampleTime[i] += SERIES_SAMPLE_SECONDS;
+    sampleValue[i] += seed % 2000;
+    TEST_ASSERT_TRUE(AddSeriesSample(i, sampleTime[i], sampleValue[i]));
+  }
+}
+
+static int CountFiles() {
+  int files = 0;
+  File directory = LittleFS.open(SERIES_PATH);
+  File entry = directory.openNextFile();
+  while (entry) {
+    files++;
+    entry = directory.openNextFile();
+  }
+  return files;
+}
+
+/*
+* Queries the whole of a slot's history, checking it is in order and on schedule and ends with the last sample added.
+*/
+static int CheckSlot(int index) {
+  int count = QuerySeries(index, 0, UINT32_MAX, samples, LEN(samples));
+  TEST_ASSERT_TRUE(count > 0);
+  for (int s = 1; s < count; s++) {
+    TEST_ASSERT_EQUAL(samples[s - 1].time + SERIES_SAMPLE_SECONDS, samples[s].time);
+    TEST_ASSERT_TRUE(samples[s].value >= samples[s - 1].value);
+  }
+  TEST_ASSERT_EQUAL(sampleTime[index], samples[count - 1].time);
+  TEST_ASSERT_EQUAL_INT32(sampleValue[index], samples[count - 1].value);
+  return count;
+}
+
+/*
+* Nothing is written until a sample has waited longer than SERIES_SEAL_MINUTES, then everything held, of every slot, goes in a single file.
+*/
+void test_held_samples_written_together_once_due() {
+  int due = SERIES_SEAL_MINUTES * 60 / SERIES_SAMPLE_SECONDS + 1;          // Samples until the first has waited exactly SERIES_SEAL_MINUTES.
+  for (int s = 0; s < due; s++) {
+    AddSamples(3);
+  }
+  TEST_ASSERT_EQUAL(0, nativeFileWrites.load());
+
+  AddSamples(1);
+  TEST_ASSERT_EQUAL(1, nativeFileWrites.load());
+  TEST_ASSERT_EQUAL(1, CountFiles());
+  TEST_ASSERT_EQUAL(due + 1, CheckSlot(0));
+  TEST_ASSERT_EQUAL(due, CheckSlot(1));
+  TEST_ASSERT_EQUAL(due, CheckSlot(2));
+}
+
+/*
+* Each file is opened for writing once, never appended to, and a query finds every sample whether it is in a file,
+* waiting to be written or in a chunk being filled.
+*/
+void test_files_written_once_and_queried_with_ram() {
+  for (int s = 0; s < 3000; s++) {
+    AddSamples(4);
+  }
+  TEST_ASSERT_TRUE(CountFiles() > 1);
+  TEST_ASSERT_EQUAL(CountFiles(), nativeFileWrites.load());
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(3000, CheckSlot(i));
+  }
+
+  SeriesSample last;
+  TEST_ASSERT_EQUAL(1, QuerySeries(2, sampleTime[2], sampleTime[2], &last, 1));
+  TEST_ASSERT_EQUAL_INT32(sampleValue[2], last.value);
+  TEST_ASSERT_EQUAL(0, QuerySeries(5, 0, UINT32_MAX, samples, LEN(samples)));
+}
+
+/*
+* Samples flushed ahead of a restart are found again afterwards, and later files carry on from the last number rather than replacing it.
+*/
+void test_history_kept_across_restart() {
+  for (int s = 0; s < 500; s++) {
+    AddSamples(2);
+  }
+  FlushSeries();
+  int files = CountFiles();
+
+  InitializeSeries();
+  TEST_ASSERT_EQUAL(500, CheckSlot(0));
+  TEST_ASSERT_EQUAL(500, CheckSlot(1));
+
+  for (int s = 0; s < 500; s++) {
+    AddSamples(2);
+  }
+  FlushSeries();
+  TEST_ASSERT_TRUE(CountFiles() > files);
+  TEST_ASSERT_EQUAL(CountFiles() - files, nativeFileWrites.load());
+  TEST_ASSERT_EQUAL(1000, CheckSlot(0));
+  TEST_ASSERT_EQUAL(1000, CheckSlot(1));
+}
+
+/*
+* Once the filesystem fills, the oldest files go first and SERIES_RESERVE_BYTES stays free. What's left still runs up to the newest sample.
+*/
+void test_oldest_files_deleted_when_full() {
+  for (int s = 0; s < 12000; s++) {
+    AddSamples(SERIES_MAX_SLOTS);
+    TEST_ASSERT_TRUE(LittleFS.totalBytes() - LittleFS.usedBytes() >= SERIES_RESERVE_BYTES);
+  }
+
+  for (int i = 0; i < SERIES_MAX_SLOTS; i++) {
+    int count = CheckSlot(i);
+    TEST_ASSERT_TRUE(count < 12000);
+    TEST_ASSERT_TRUE(samples[0].time > START_TIME + SERIES_SAMPLE_SECONDS);
+  }
+}
+
+/*
+* A second sample within three quarters of SERIES_SAMPLE_SECONDS of the last is skipped.
+*/
+void test_close_samples_skipped() {
+  TEST_ASSERT_TRUE(AddSeriesSample(0, START_TIME, 1));
+  TEST_ASSERT_FALSE(AddSeriesSample(0, START_TIME + SERIES_SAMPLE_SECONDS / 2, 2));
+  TEST_ASSERT_TRUE(AddSeriesSample(0, START_TIME + SERIES_SAMPLE_SECONDS * 3 / 4, 3));
+  TEST_ASSERT_FALSE(AddSeriesSample(SERIES_MAX_SLOTS, START_TIME, 1));
+  TEST_ASSERT_EQUAL(2, QuerySeries(0, 0, UINT32_MAX, samples, LEN(samples)));
+  TEST_ASSERT_EQUAL_INT32(3, samples[1].value);
+}
+
+/*
+* Buckets are summarised across files and RAM alike.
+*/
+void test_summary_spans_files_and_ram() {
+  for (int s = 0; s < 1000; s++) {
+    AddSamples(2);
+  }
+  TEST_ASSERT_TRUE(CountFiles() > 0);
+
+  int32_t lowest[4];
+  int32_t highest[4];
+  uint32_t from = START_TIME + SERIES_SAMPLE_SECONDS;
+  TEST_ASSERT_EQUAL(4, SummariseSeries(1, from, sampleTime[1], lowest, highest, 4));
+  TEST_ASSERT_EQUAL_INT32(sampleValue[1], highest[3]);
+  int count = QuerySeries(1, from, sampleTime[1], samples, LEN(samples));
+  TEST_ASSERT_EQUAL_INT32(samples[0].value, lowest[0]);
+  TEST_ASSERT_EQUAL(1000, count);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_held_samples_written_together_once_due);
+  RUN_TEST(test_files_written_once_and_queried_with_ram);
+  RUN_TEST(test_history_kept_across_restart);
+  RUN_TEST(test_oldest_files_deleted_when_full);
+  RUN_TEST(test_close_samples_skipped);
+  RUN_TEST(test_summary_spans_files_and_ram);
+  return UNITY_END();
+}
\ No newline at end of file
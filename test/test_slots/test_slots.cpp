@@ -0,0 +1,247 @@
+#include <unity.h>
+#include <string>
+
+#include "globals_t93.h"
+
+#include "../../src/slots_t93.cpp"
+
+// slots_t93 is built with the globals it shares with the rest of the firmware defined below. It isn't in the native build_src_filter,
+// as test_fleet fakes GetSlotCount() and SetSlotCount(). Labels come from test/shims/secrets_t93.h, three of them as in secrets.h.sample.
+
+bool _currentValueUpdated[MAX_VALUE_SLOTS];
+unsigned long _currentValueFetchedAt[MAX_VALUE_SLOTS];
+bool _currentValueStale[MAX_VALUE_SLOTS];
+int _selectedValueIndex;
+
+void setUp() {
+  memset(_currentValueUpdated, 0, sizeof(_currentValueUpdated));
+  memset(_currentValueFetchedAt, 0, sizeof(_currentValueFetchedAt));
+  memset(_currentValueStale, 0, sizeof(_currentValueStale));
+  _selectedValueIndex = 0;
+  InitializeSlots();
+}
+
+void tearDown() {}
+
+/*
+* The label a slot should have: the secrets file's for those it covers, generated for the rest.
+*/
+static std::string ExpectedLabel(int index) {
+  return index < LEN(_valueLabel) ? _valueLabel[index] : "Value " + std::to_string(index + 1);
+}
+
+/*
+* Checks every slot's label, and that the arena holds exactly the labels and values and nothing else.
+*/
+static void CheckArena() {
+  int used = 0;
+  for (int i = 0; i < GetSlotCount(); i++) {
+    TEST_ASSERT_EQUAL_STRING(ExpectedLabel(i).c_str(), GetSlotLabel(i));
+    used += strlen(GetSlotLabel(i)) + 1 + strlen(GetSlotValue(i)) + 1;
+  }
+  TEST_ASSERT_EQUAL(used, GetSlotArenaUsed());
+  TEST_ASSERT_TRUE(GetSlotArenaUsed() <= SLOT_ARENA_SIZE);
+}
+
+/*
+* Sets each of the first slots to a value made from its index, e.g. "v2-2222" for the third.
+*/
+static void FillValues(int count) {
+  for (int i = 0; i < count; i++) {
+    SetSlotValue(i, ("v" + std::to_string(i) + "-" + std::string(4, '0' + i % 10)).c_str());
+  }
+}
+
+static void CheckValues(int count) {
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_EQUAL_STRING(("v" + std::to_string(i) + "-" + std::string(4, '0' + i % 10)).c_str(), GetSlotValue(i));
+  }
+}
+
+void test_initial_slots_labelled_from_secrets() {
+  TEST_ASSERT_EQUAL(LEN(_valueLabel), GetSlotCount());
+  for (int i = 0; i < GetSlotCount(); i++) {
+    TEST_ASSERT_EQUAL_STRING("", GetSlotValue(i));
+  }
+  TEST_ASSERT_EQUAL_STRING("A description", GetSlotSummary(0, 0));
+  CheckArena();
+}
+
+/*
+* A selection restored beyond the labelled slots is kept, with slots made up to it.
+*/
+void test_initial_slots_cover_restored_selection() {
+  _selectedValueIndex = 5;
+  InitializeSlots();
+  TEST_ASSERT_EQUAL(6, GetSlotCount());
+  TEST_ASSERT_EQUAL(5, _selectedValueIndex);
+  TEST_ASSERT_EQUAL_STRING("Value 6", GetSlotSummary(5, 0));
+  TEST_ASSERT_EQUAL_STRING("", GetSlotSummary(5, 1));
+  CheckArena();
+}
+
+/*
+* New labels go in after the existing ones, moving the values along without changing them.
+*/
+void test_grow_keeps_values() {
+  FillValues(3);
+  TEST_ASSERT_TRUE(SetSlotCount(5));
+  TEST_ASSERT_EQUAL(5, GetSlotCount());
+  TEST_ASSERT_EQUAL_STRING("Value 4", GetSlotLabel(3));
+  TEST_ASSERT_EQUAL_STRING("Value 5", GetSlotLabel(4));
+  CheckValues(3);
+  TEST_ASSERT_EQUAL_STRING("", GetSlotValue(3));
+  TEST_ASSERT_EQUAL_STRING("", GetSlotValue(4));
+  CheckArena();
+
+  FillValues(5);
+  CheckValues(5);
+  CheckArena();
+  TEST_ASSERT_FALSE(SetSlotCount(5));
+}
+
+/*
+* Shrinking drops the last slots' labels and values, and moves the selection to the first slot if it was on one of them.
+*/
+void test_shrink_resets_selection() {
+  SetSlotCount(6);
+  FillValues(6);
+  int used = GetSlotArenaUsed();
+  _selectedValueIndex = 4;
+
+  TEST_ASSERT_TRUE(SetSlotCount(2));
+  TEST_ASSERT_EQUAL(2, GetSlotCount());
+  TEST_ASSERT_EQUAL(0, _selectedValueIndex);
+  TEST_ASSERT_TRUE(_currentValueUpdated[0]);
+  TEST_ASSERT_TRUE(GetSlotArenaUsed() < used);
+  CheckValues(2);
+  CheckArena();
+
+  _selectedValueIndex = 1;
+  _currentValueUpdated[0] = false;
+  TEST_ASSERT_TRUE(SetSlotCount(1));
+  TEST_ASSERT_EQUAL(0, _selectedValueIndex);
+  CheckValues(1);
+  CheckArena();
+}
+
+/*
+* A slot dropped and added back starts with an empty value but keeps its fetch time and stale flag, and the selection is left alone.
+*/
+void test_regrow_keeps_slot_state() {
+  SetSlotCount(4);
+  FillValues(4);
+  _currentValueFetchedAt[3] = 12345;
+  _currentValueStale[3] = true;
+  _selectedValueIndex = 2;
+
+  SetSlotCount(3);
+  TEST_ASSERT_EQUAL(2, _selectedValueIndex);
+  TEST_ASSERT_TRUE(SetSlotCount(4));
+  TEST_ASSERT_EQUAL_STRING("Value 4", GetSlotLabel(3));
+  TEST_ASSERT_EQUAL_STRING("", GetSlotValue(3));
+  TEST_ASSERT_EQUAL(12345, _currentValueFetchedAt[3]);
+  TEST_ASSERT_TRUE(_currentValueStale[3]);
+  TEST_ASSERT_EQUAL(2, _selectedValueIndex);
+  CheckValues(3);
+  CheckArena();
+}
+
+/*
+* A value changing size in the middle of the arena moves those after it, and leaves them as they were.
+*/
+void test_value_resized_in_middle() {
+  SetSlotCount(5);
+  FillValues(5);
+  SetSlotValue(2, "a much longer value than before");
+  TEST_ASSERT_EQUAL_STRING("a much longer value than before", GetSlotValue(2));
+  TEST_ASSERT_EQUAL_STRING("v3-3333", GetSlotValue(3));
+  TEST_ASSERT_EQUAL_STRING("v4-4444", GetSlotValue(4));
+  CheckArena();
+
+  SetSlotValue(2, "");
+  TEST_ASSERT_EQUAL_STRING("", GetSlotValue(2));
+  TEST_ASSERT_EQUAL_STRING("v1-1111", GetSlotValue(1));
+  TEST_ASSERT_EQUAL_STRING("v3-3333", GetSlotValue(3));
+  CheckArena();
+}
+
+void test_value_truncated_to_max_length() {
+  std::string value(MAX_VALUE_LENGTH + 10, 'x');
+  SetSlotValue(1, value.c_str());
+  TEST_ASSERT_EQUAL(MAX_VALUE_LENGTH - 1, strlen(GetSlotValue(1)));
+  TEST_ASSERT_EQUAL_STRING("", GetSlotValue(2));
+  CheckArena();
+}
+
+/*
+* With values at their longest, the arena fills before every slot is in use. The value that fills it is cut to the space left,
+* no more slots can be added after it, and the arena is usable again once values shrink.
+*/
+void test_full_arena_truncates_values() {
+  std::string value(MAX_VALUE_LENGTH - 1, 'x');
+  for (int i = 0; i < GetSlotCount(); i++) {
+    SetSlotValue(i, value.c_str());
+  }
+  while (AddSlot()) {
+    SetSlotValue(GetSlotCount() - 1, value.c_str());
+    CheckArena();
+  }
+  int last = GetSlotCount() - 1;
+  TEST_ASSERT_TRUE(GetSlotCount() < MAX_VALUE_SLOTS);
+  TEST_ASSERT_EQUAL(SLOT_ARENA_SIZE, GetSlotArenaUsed());
+  TEST_ASSERT_TRUE(strlen(GetSlotValue(last)) < value.length());
+  TEST_ASSERT_EQUAL_STRING(value.c_str(), GetSlotValue(last - 1));
+  CheckArena();
+
+  SetSlotValue(0, "1");
+  SetSlotValue(last, value.c_str());
+  TEST_ASSERT_EQUAL_STRING(value.c_str(), GetSlotValue(last));
+  TEST_ASSERT_EQUAL_STRING(value.c_str(), GetSlotValue(last - 1));
+  CheckArena();
+
+  TEST_ASSERT_TRUE(SetSlotCount(3));
+  TEST_ASSERT_EQUAL_STRING("1", GetSlotValue(0));
+  TEST_ASSERT_EQUAL_STRING(value.c_str(), GetSlotValue(2));
+  CheckArena();
+}
+
+/*
+* Every slot can be in use while values are short, and no more can be added once they are.
+*/
+void test_every_slot_in_use() {
+  TEST_ASSERT_TRUE(SetSlotCount(MAX_VALUE_SLOTS));
+  TEST_ASSERT_EQUAL(MAX_VALUE_SLOTS, GetSlotCount());
+  TEST_ASSERT_FALSE(AddSlot());
+  TEST_ASSERT_EQUAL(MAX_VALUE_SLOTS, GetSlotCount());
+  FillValues(MAX_VALUE_SLOTS);
+  CheckValues(MAX_VALUE_SLOTS);
+  CheckArena();
+}
+
+void test_count_clamped() {
+  TEST_ASSERT_TRUE(SetSlotCount(0));
+  TEST_ASSERT_EQUAL(1, GetSlotCount());
+  CheckArena();
+  TEST_ASSERT_TRUE(SetSlotCount(100));
+  TEST_ASSERT_EQUAL(MAX_VALUE_SLOTS, GetSlotCount());
+  CheckArena();
+  TEST_ASSERT_TRUE(SetSlotCount(-5));
+  TEST_ASSERT_EQUAL(1, GetSlotCount());
+  CheckArena();
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_initial_slots_labelled_from_secrets);
+  RUN_TEST(test_initial_slots_cover_restored_selection);
+  RUN_TEST(test_grow_keeps_values);
+  RUN_TEST(test_shrink_resets_selection);
+  RUN_TEST(test_regrow_keeps_slot_state);
+  RUN_TEST(test_value_resized_in_middle);
+  RUN_TEST(test_value_truncated_to_max_length);
+  RUN_TEST(test_full_arena_truncates_values);
+  RUN_TEST(test_every_slot_in_use);
+  RUN_TEST(test_count_clamped);
+  return UNITY_END();
+}
\ No newline at end of file